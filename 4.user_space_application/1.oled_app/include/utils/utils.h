@@ -1,10 +1,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-/* definition declare*/
-#define PRINTF_DEBUG(...)    printf("[DEBUG]: " __VA_ARGS__);
-#define PRINTF_ERROR(...)    printf("[ERROR]: " __VA_ARGS__);
-#define PRINTF_INFO(...)     printf("[INFO]: " __VA_ARGS__);
+/* Logging: LOG_ERROR/WARN/INFO/DEBUG and their _RATELIMIT forms */
+#include "log.h"
 
 /* Enum declare */
 typedef enum  {
@@ -23,13 +23,13 @@ void app_run(void)
     fd = ssd1306_init();
     if( fd < 0 )
     {
-        PRINTF_ERROR("SSD1306 initialize failed\n ");
+        LOG_ERROR("SSD1306 initialize failed");
         return;
     }
     init_game(5);
     if ( button_init(20) < 0) // HARD coded button GPIO 20
     {
-        printf("[ERROR]: Cannot initialize button GPIO %d !\n", 20);
+        LOG_ERROR("Cannot initialize button GPIO %d !", 20);
         return;
     }
     pthread_create(&input_thread, NULL, input_thread_func, NULL);
@@ -21,7 +21,7 @@ uint8_t game_speed = 5;
 
 void *game_logic_thread_func(void *arg)
 {
-    PRINTF_INFO("Game logic thread started!\n");
+    LOG_INFO("Game logic thread started!");
     bool render_flag_local;
     uint8_t game_state_local = -1;
     uint8_t stop_count = 10;
@@ -30,13 +30,13 @@ void *game_logic_thread_func(void *arg)
     while (1)
     {
         get_render_flag_and_state(&render_flag_local, &game_state_local);
-        PRINTF_INFO("game_state_local = %d\n", game_state_local);
+        LOG_DEBUG_RATELIMIT(1000, "game_state_local = %d", game_state_local);
         if (game_state_local == GAME_STATE_READY)
         {
             // Wait for user input to start the game
             if (button_is_pressed(BUTTON_LINE_OFFSET))
             {
-                PRINTF_INFO("Game started by button press!\n");
+                LOG_INFO("Game started by button press!");
                 game_state_local = GAME_STATE_PLAYING;
                 render_flag_local = true;
             }
@@ -45,13 +45,13 @@ void *game_logic_thread_func(void *arg)
         {
             // Update bird position
             pthread_mutex_lock(&mutex_game_logic);
-            PRINTF_INFO("Start playing!\n");
+            LOG_INFO("Start playing!");
             if (button_is_pressed(BUTTON_LINE_OFFSET))
             {
                 if (move_up(&bird) == APP_RET_ERR_INVALID_BUFFER_INDEX)
                 {
                     game_state_local = GAME_STATE_OVER;
-                    PRINTF_INFO("Out boundary!\n");
+                    LOG_INFO("Out boundary!");
                     stop_count = 5;
                 }
                 check_move = true;
@@ -73,14 +73,14 @@ void *game_logic_thread_func(void *arg)
                 if (col_top_info.column_x > 90 + game_speed)
                 {
                     increase_point(&game_info);
-                    PRINTF_INFO("Point increased: %d\n", game_info.points);
+                    LOG_INFO("Point increased: %d", game_info.points);
                 }
                 if (!check_move)
                 {
                     if (move_down(&bird) == APP_RET_ERR_INVALID_BUFFER_INDEX)
                     {
                         game_state_local = GAME_STATE_OVER;
-                        PRINTF_INFO("Out boundary!\n");
+                        LOG_INFO("Out boundary!");
                         stop_count = 5;
                     }
                 }
@@ -92,7 +92,7 @@ void *game_logic_thread_func(void *arg)
                 check_bird_collision(&bird, &col_top_info) != 0)
             {
                 game_state_local = GAME_STATE_OVER;
-                PRINTF_INFO("COLLISION CHECK!\n");
+                LOG_INFO("COLLISION CHECK!");
                 delay_ms(2000);
                 stop_count = 5;
             }
@@ -210,7 +210,7 @@ void init_game_info(struct stGameInfo *game_info)
 
 void init_game(uint8_t game_speed)
 {
-    PRINTF_INFO("Initialize game with speed: %d\n", game_speed);
+    LOG_INFO("Initialize game with speed: %d", game_speed);
     // Init bird
     bird = init_bird(20, 30, 10, 15, 5);
 
@@ -220,7 +220,7 @@ void init_game(uint8_t game_speed)
 
     // Init game status
     init_game_info(&game_info);
-    PRINTF_INFO("Game initialized successfully!\n");
+    LOG_INFO("Game initialized successfully!");
 }
 
 void update_game_play(int fd)
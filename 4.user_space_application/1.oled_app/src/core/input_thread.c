@@ -11,7 +11,7 @@ static uint8_t button_gpio;
 
 void *thread_read_button(void* arg)
 {
-    PRINTF_INFO("Input thread started!\n");
+    LOG_INFO("Input thread started!");
     int*val = (int*)arg;
     while(1)
     {
@@ -32,7 +32,7 @@ int initial_input_thread(int button_gpio_input)
 
     if(pthread_create(&pid1, NULL, thread_read_button, &button_gpio) != 0)
     {
-        perror("[ERROR]: Cannot create thread1!\n");
+        LOG_ERROR("Cannot create thread1!");
         return -1;
     }
 
@@ -17,7 +17,7 @@ extern struct stGameInfo game_info;
 
 void *render_thread_func(void *arg)
 {
-    PRINTF_INFO("Render thread started\n");
+    LOG_INFO("Render thread started");
     int *fd_ptr = (int*)arg;
     int fd = *fd_ptr;
     bool render_flag_local;
@@ -3,6 +3,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
 #include "utils.h"
 
 /* mutex declare */
@@ -20,16 +22,16 @@ int button_init(int gpio)
     {
         btn_fd = open("/dev/etx_device", O_RDONLY);
         if (btn_fd < 0) {
-            perror("[ERROR]: Open device failed");
+            LOG_ERROR("Open device failed: %s", strerror(errno));
             return -1;
         }
         btn_20 = (stButtonInfo*) malloc(sizeof(stButtonInfo));
         if (btn_20 == NULL) {
-            perror("[ERROR]: Failed to allocate memory for btn_20");
+            LOG_ERROR("Failed to allocate memory for btn_20");
             close(btn_fd);
             return -1;
         }
-        printf("[INFO]: Button %d init success!\n", gpio);
+        LOG_INFO("Button %d init success!", gpio);
     }
     return 0;
 }
@@ -50,12 +52,12 @@ void button_read_state(int gpio)
     pthread_mutex_lock(&mutex_button);
     if(btn_fd<0)
     {
-        PRINTF_DEBUG("read btn_%d failed - not initial button!\n", gpio);
+        LOG_DEBUG("read btn_%d failed - not initial button!", gpio);
     }
     int read_btn = read(btn_fd, &btn_state_3, 1); // read 1 byte from device
     if(read_btn < 0)
     {
-        printf("[DEBUG]: read btn_%d failed, return: %d!\n", gpio, read_btn);
+        LOG_DEBUG("read btn_%d failed, return: %d!", gpio, read_btn);
     }
     else if(btn_state_3 == 1)
     {
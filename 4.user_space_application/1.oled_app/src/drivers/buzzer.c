@@ -41,11 +41,11 @@ e_app_return_t buzzer_init(uint8_t buzzer_gpio)
     int ret = pwm_init("/dev/pwm_device");
     if( ret == APP_RET_OK)
     {
-        PRINTF_INFO("buzzer initialize success!\n");
+        LOG_INFO("buzzer initialize success!");
     }
     else
     {
-        PRINTF_ERROR("buzzer init failed!\n");
+        LOG_ERROR("buzzer init failed!");
     }
     return ret;
 }
@@ -123,11 +123,11 @@ e_app_return_t buzzer_deinit(uint8_t buzzer_gpio)
     int ret = pwm_deinit();
     if( ret == APP_RET_OK)
     {
-        PRINTF_INFO("buzzer deinit success!\n");
+        LOG_INFO("buzzer deinit success!");
     }
     else
     {
-        PRINTF_ERROR("buzzer deinit failed!\n");
+        LOG_ERROR("buzzer deinit failed!");
     }
     return ret;
 }
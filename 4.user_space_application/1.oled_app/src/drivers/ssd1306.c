@@ -104,7 +104,7 @@ int ssd1306_init(void)
         perror("Failed to open i2c device");
         return -1;
     }
-    PRINTF_INFO("SSD1306 i2c device opened successfully\n");
+    LOG_INFO("SSD1306 i2c device opened successfully");
 
     set_brightness(i2c_fd, 200);
 
@@ -117,21 +117,21 @@ int ssd1306_init(void)
             buffer[i%8 * 128 + j] = 0xFF;
         }
     }
-    PRINTF_INFO("Write display buffer test data\n");
+    LOG_INFO("Write display buffer test data");
 
     // if(write_display_buffer(fd, (uint8_t *)buffer, 8*128) == -1)
     if(write_display_buffer(i2c_fd, &buffer[0], 8*128) == -1)
     {
         ssd1306_close(i2c_fd);
-        PRINTF_ERROR("Write display buffer failed\n");
+        LOG_ERROR("Write display buffer failed");
         return 1;
     }
-    PRINTF_INFO("Write display buffer successfully!\n");
+    LOG_INFO("Write display buffer successfully!");
 
     // uint8_t read_buf[8*128];
     // if(read_display_buffer(i2c_fd, read_buf, sizeof(read_buf)) > 0)
     // {
-    //     PRINTF_INFO("Read display buffer successfully!\n");
+    //     LOG_INFO("Read display buffer successfully!");
     // }
 
     oled_clear_display(i2c_fd);
@@ -153,7 +153,7 @@ unsigned char* scale_bitmap_array(const unsigned char* old_buffer, uint8_t old_w
     unsigned char* new_buffer = (unsigned char*)malloc((new_width * new_height) / 8);
     if(new_buffer == NULL)
     {
-        perror("[ERROR]: malloc new display buffer failed");
+        LOG_ERROR("malloc new display buffer failed");
         return NULL;
     }
     memset(new_buffer, 0, (new_width * new_height) / 8);
@@ -177,7 +177,7 @@ void draw_pixel(uint8_t x, uint8_t y, uint8_t bit_mask)
     uint8_t page = y/8;
     if(page*128 + x > COL_NUM*PAGE_NUM)
     {
-        PRINTF_ERROR("ERROR INDEX BUFFER!\n");
+        LOG_ERROR("ERROR INDEX BUFFER!");
         return;
         // return APP_RET_ERR_INVALID_BUFFER_INDEX;
     }
@@ -502,7 +502,7 @@ void oled_print_str(int fd, const char *str, uint8_t cursor_x, uint8_t cursor_y,
 {
     if(str == NULL)
     {
-        PRINTF_ERROR("Str is NULL!\n");
+        LOG_ERROR("Str is NULL!");
     }
     uint8_t max_string_len = (COL_NUM - cursor_x) / 10;
     char *str_write = malloc(strlen(str) + 1);
@@ -511,7 +511,7 @@ void oled_print_str(int fd, const char *str, uint8_t cursor_x, uint8_t cursor_y,
 
     if(strlen(str_write) > max_string_len)
     {
-        PRINTF_INFO("String length over %d, truncate to %d\n", (COL_NUM - cursor_x) / 10, (COL_NUM - cursor_x) / 10);
+        LOG_INFO("String length over %d, truncate to %d", (COL_NUM - cursor_x) / 10, (COL_NUM - cursor_x) / 10);
         str_write[max_string_len] = '\0';
     }
 
@@ -524,7 +524,7 @@ void oled_print_str(int fd, const char *str, uint8_t cursor_x, uint8_t cursor_y,
         char c = *p++;
         is_special_char = false;
         unsigned char *bitmap = get_bit_map(c, &is_special_char, &char_width, &char_height);
-        PRINTF_INFO("c = %c, is_special char = %d, char width = %d \n", c, is_special_char, char_width);
+        LOG_DEBUG("c = %c, is_special char = %d, char width = %d", c, is_special_char, char_width);
         if(bitmap == NULL) {
             continue; // Bỏ qua ký tự không hợp lệ
         }
@@ -26,9 +26,9 @@ void *thread_check_button_test(void *arg)
     {
         if(button_is_pressed(*val) == 1)
         {
-            printf("[INFO]: button is pressed! \n");
+            LOG_INFO("button is pressed!");
         } else {
-            printf("[INFO]: button is not pressed! \n");
+            LOG_INFO("button is not pressed!");
         }
         delay_ms(1000);
     }
@@ -41,19 +41,19 @@ int main()
     int btn_gpio = 20;
     if ( button_init(btn_gpio) < 0)
     {
-        printf("[ERROR]: Cannot initialize button GPIO %d !\n", btn_gpio);
+        LOG_ERROR("Cannot initialize button GPIO %d !", btn_gpio);
         return -1;
     }
 
     if(pthread_create(&pid1, NULL, thread_read_button_test, &btn_gpio) != 0)
     {
-        perror("[ERROR]: Cannot create thread1!\n");
+        LOG_ERROR("Cannot create thread1!");
         return 1;
     }
 
     if(pthread_create(&pid2, NULL, thread_check_button_test, &btn_gpio) != 0)
     {
-        perror("[ERROR]: Cannot create thread2!\n");
+        LOG_ERROR("Cannot create thread2!");
         return 1;
     }
 
@@ -108,21 +108,21 @@ void test_column_and_bird(int fd)
         update_oled_display(fd);
         if(check_bird_collision(&bird, &column_bottom))
         {
-            PRINTF_ERROR("Collision detected at Bird bottom (X=%d, Y=%d) and Column(X=%d, Top Y=%d, Bottom Y=%d)\n", 
+            LOG_ERROR("Collision detected at Bird bottom (X=%d, Y=%d) and Column(X=%d, Top Y=%d, Bottom Y=%d)", 
                 bird.bird_x, bird.bird_y, column_bottom.column_x, 
                 column_bottom.column_top_y, column_bottom.column_bottom_y);
             break;
         }
         else if (check_bird_collision(&bird, &column_top))
         {
-            PRINTF_ERROR("Collision detected at Bird top (X=%d, Y=%d) and Column(X=%d, Top Y=%d, Bottom Y=%d)\n", 
+            LOG_ERROR("Collision detected at Bird top (X=%d, Y=%d) and Column(X=%d, Top Y=%d, Bottom Y=%d)", 
                 bird.bird_x, bird.bird_y, column_top.column_x, column_top.column_top_y, column_top.column_bottom_y);
             break;
         }
         
         else 
         {
-            printf("[INFO]: No collision!\n");
+            LOG_INFO("No collision!");
         }
         usleep(200000); // Pause for 0.2 second
     }
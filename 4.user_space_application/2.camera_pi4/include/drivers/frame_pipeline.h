@@ -0,0 +1,178 @@
+// frame_pipeline.h - SPMC frame queue with an eventfd wakeup (C++ only)
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_ring.h"
+#include "rpi_camera.h"
+
+/* Frames on their way from a producer thread (libcamera completion, encoder)
+ * to the consumers. The two sides share no lock: frames go through a
+ * lock-free single-producer/multi-consumer ring and consumers sleep on an
+ * eventfd, which the producer only writes when the ring was empty. Any
+ * thread may pop, wait or discard; only one may push. T is a frame
+ * pointer. */
+template <typename T>
+class FramePipeline {
+public:
+    FramePipeline(size_t max, rpi_overflow_policy_t policy)
+        : ring(policy == RPI_OVERFLOW_LATEST ? 1 : max), policy(policy),
+          efd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+
+    ~FramePipeline() {
+        if (efd >= 0)
+            close(efd);
+    }
+
+    /* Queue 'f'. Returns the frame the overflow policy rejected, which the
+     * caller must give back to the sensor, or nullptr. */
+    T push(T f) {
+        bool was_empty = false;
+        T rejected = nullptr;
+
+        if (policy == RPI_OVERFLOW_DROP_NEWEST) {
+            if (!ring.push(f, &was_empty)) {
+                dropped_newest.fetch_add(1, std::memory_order_relaxed);
+                return f; // DROP
+            }
+        } else if (ring.push_evict(f, rejected, &was_empty)) {
+            dropped_oldest.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (was_empty)
+            signal();
+        return rejected;
+    }
+
+    /* Wait until a frame is queued without taking it. timeout_ms < 0 waits
+     * forever. Returns 0, -ETIMEDOUT, or -EPIPE once stopped. */
+    int wait_ready(int timeout_ms) {
+        uint64_t deadline = 0;
+        if (timeout_ms >= 0)
+            deadline = now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+        for (;;) {
+            if (!ring.empty())
+                return 0;
+            if (stopped.load(std::memory_order_acquire))
+                return -EPIPE;
+
+            /* Re-check after the fence so a push racing with us is either
+             * seen here or has written the eventfd */
+            ring.consumer_fence();
+            if (!ring.empty())
+                return 0;
+
+            int remaining = -1;
+            if (timeout_ms >= 0) {
+                uint64_t now = now_ns();
+                if (now >= deadline)
+                    return -ETIMEDOUT;
+                remaining = (int)((deadline - now + 999999) / 1000000);
+            }
+
+            struct pollfd pfd = { efd, POLLIN, 0 };
+            if (poll(&pfd, 1, remaining) > 0)
+                rearm();
+        }
+    }
+
+    int pop(T &out, int timeout_ms) {
+        for (;;) {
+            if (ring.pop(out))
+                return 0;
+
+            int ret = wait_ready(timeout_ms);
+            if (ret)
+                return ret;
+        }
+    }
+
+    bool try_pop(T &out) {
+        if (ring.pop(out))
+            return true;
+
+        /* Empty: clear a stale wakeup so the fd only polls readable while a
+         * frame is queued, then look once more for a racing push */
+        drain();
+        ring.consumer_fence();
+        return ring.pop(out);
+    }
+
+    /* Readable while frames are queued (and after stop) */
+    int fd() const { return efd; }
+
+    void stop() {
+        stopped.store(true, std::memory_order_release);
+        signal();
+    }
+
+    /* Hand queued frames to 'fn' and drop them, staying stopped until the
+     * next reset(). Leaves the eventfd alone, so a consumer woken by stop()
+     * still sees it. */
+    template <typename Fn>
+    void discard(Fn fn) {
+        T v;
+        while (ring.pop(v))
+            fn(v);
+    }
+
+    void reset()
+    {
+        ring.clear();
+        drain();
+        stopped.store(false, std::memory_order_release);
+    }
+
+    size_t occupancy() const { return ring.size(); }
+    rpi_overflow_policy_t overflow_policy() const { return policy; }
+    /* New frames refused by DROP_NEWEST */
+    uint64_t dropped_newest_count() const { return dropped_newest.load(std::memory_order_relaxed); }
+    /* Queued frames evicted by DROP_OLDEST / LATEST */
+    uint64_t dropped_oldest_count() const { return dropped_oldest.load(std::memory_order_relaxed); }
+    uint64_t dropped_count() const { return dropped_newest_count() + dropped_oldest_count(); }
+
+private:
+    void signal() {
+        uint64_t one = 1;
+        ssize_t n = write(efd, &one, sizeof(one));
+        (void)n;
+    }
+
+    void drain() {
+        uint64_t v;
+        ssize_t n = read(efd, &v, sizeof(v));
+        (void)n;
+    }
+
+    /* Consume the wakeup, but keep the fd readable if frames remain for
+     * callers that poll it */
+    void rearm() {
+        drain();
+        ring.consumer_fence();
+        if (!ring.empty())
+            signal();
+    }
+
+    static uint64_t now_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    FrameRing<T> ring;
+    const rpi_overflow_policy_t policy;
+    int efd;
+    std::atomic<bool> stopped{false};
+
+    std::atomic<uint64_t> dropped_newest{0};
+    std::atomic<uint64_t> dropped_oldest{0};
+};
+
+#endif // FRAME_PIPELINE_H
@@ -0,0 +1,67 @@
+// frame_pool.h - Preallocated frame-sized buffers for the copy path (C++ only)
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/* Whatever backs rpi_frame_t::data. rpi_camera_release_frame() hands the
+ * frame back through it. */
+struct FrameOwner {
+    virtual void release() = 0;
+
+protected:
+    ~FrameOwner() = default;
+};
+
+class FramePool;
+
+struct PoolBuffer : FrameOwner {
+    FramePool *pool;
+    uint32_t index;
+    uint8_t *data;
+
+    void release() override;
+};
+
+/* Fixed set of equally sized buffers carved out of one anonymous mapping.
+ * get() may run on the consumer thread while put() runs on any thread that
+ * releases a frame, so the free list is a lock-free tagged-index stack. */
+class FramePool {
+public:
+    FramePool() = default;
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    /* Reserve 'count' buffers of 'size' bytes. With 'lock' the memory is
+     * mlock'ed; it is always prefaulted so the first frames do not fault. */
+    int init(size_t count, size_t size, bool lock);
+
+    PoolBuffer *get();
+    void put(uint32_t index);
+
+    size_t buffer_size() const { return block_size; }
+    size_t count() const { return num_blocks; }
+    bool locked() const { return is_locked; }
+    uint64_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    void *region = nullptr;
+    size_t region_size = 0;
+    size_t block_size = 0;
+    size_t num_blocks = 0;
+    bool is_locked = false;
+
+    std::unique_ptr<PoolBuffer[]> blocks;
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    std::atomic<uint64_t> top{NONE}; /* tag << 32 | index */
+    std::atomic<uint64_t> miss_count{0};
+};
+
+#endif // FRAME_POOL_H
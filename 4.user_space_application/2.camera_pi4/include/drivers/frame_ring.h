@@ -0,0 +1,120 @@
+// frame_ring.h - Lock-free single-producer/multi-consumer ring (C++ only)
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#define FRAME_RING_CACHELINE 64
+
+/* Fixed-capacity ring of trivially copyable values (slot pointers, indices).
+ * Exactly one thread may push; any number of threads may pop at once (user
+ * threads sharing a camera, and stop draining it). Slots are allocated once
+ * in the constructor; head and tail live on their own cache lines so
+ * producer and consumers never share a line they write.
+ *
+ * Consumers, and the producer when it evicts the oldest entry (push_evict),
+ * advance head with a CAS. Slots are atomics, so a side that loses the race
+ * reads a whole, if stale, value and retries; head only grows, so a lost
+ * CAS cannot succeed later on a reused index. */
+template <typename T>
+class FrameRing {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "FrameRing stores values by plain copy");
+
+public:
+    explicit FrameRing(size_t capacity)
+        : cap(capacity ? capacity : 1), slots(new Slot[cap]) {}
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    /* Producer. Returns false when full. 'was_empty' tells the caller the
+     * consumer may be asleep and needs a wakeup. */
+    bool push(const T &v, bool *was_empty = nullptr) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= cap)
+            return false;
+
+        slots[t % cap].value.store(v, std::memory_order_relaxed);
+        tail.store(t + 1, std::memory_order_release);
+
+        if (was_empty) {
+            /* Pairs with the fence in consumer_fence(): either we see the
+             * consumer's last head, or it sees our tail */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            *was_empty = head.load(std::memory_order_relaxed) == t;
+        }
+        return true;
+    }
+
+    /* Producer. Never fails: when full, the oldest entry is taken out and
+     * returned through 'evicted' so the caller can recycle it. */
+    bool push_evict(const T &v, T &evicted, bool *was_empty = nullptr) {
+        bool did_evict = false;
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+
+        if (t - h >= cap) {
+            T old = slots[h % cap].value.load(std::memory_order_relaxed);
+            /* Losing means the consumer just popped it and there is room */
+            if (head.compare_exchange_strong(h, h + 1, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                evicted = old;
+                did_evict = true;
+            }
+        }
+
+        push(v, was_empty);
+        return did_evict;
+    }
+
+    /* Consumer, from any thread. Returns false when empty. */
+    bool pop(T &out) {
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (;;) {
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+
+            out = slots[h % cap].value.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel,
+                                           std::memory_order_acquire))
+                return true;
+        }
+    }
+
+    /* Consumer, before going to sleep on an empty ring */
+    void consumer_fence() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /* Drop everything queued. Only while the producer is idle. */
+    void clear() {
+        head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t size() const {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        uint64_t h = head.load(std::memory_order_acquire);
+        return t >= h ? (size_t)(t - h) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return cap; }
+
+private:
+    struct alignas(FRAME_RING_CACHELINE) Slot {
+        std::atomic<T> value;
+    };
+
+    const size_t cap;
+    std::unique_ptr<Slot[]> slots;
+
+    alignas(FRAME_RING_CACHELINE) std::atomic<uint64_t> head{0}; /* consumers */
+    alignas(FRAME_RING_CACHELINE) std::atomic<uint64_t> tail{0}; /* producer */
+};
+
+#endif // FRAME_RING_H
@@ -0,0 +1,125 @@
+// jpeg_encoder.h - Parallel JPEG encoder stage behind RPI_FMT_MJPEG (C++ only)
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "rpi_camera.h"
+#include "frame_pool.h"
+#include "frame_pipeline.h"
+#include "pixel_convert.h"
+
+class JpegEncoder;
+
+/* One encoded frame. 'data' is a buffer of the encoder's pool, which the
+ * frame owns until rpi_camera_release_frame(). */
+struct JpegFrame : FrameOwner {
+    JpegEncoder *enc;
+    PoolBuffer *buf;
+    size_t size;
+    uint64_t timestamp;
+    uint32_t sequence;
+    rpi_frame_meta_t meta;
+    uint64_t encode_ns; /* wall time of this frame's encode */
+    uint32_t worker;
+
+    void release() override;
+};
+
+/* Encodes every frame of one subscriber on a small worker pool and hands
+ * the results out in sequence order.
+ *
+ * Workers take frames from the input subscriber one at a time, so the
+ * order they take them in is the capture order; each is given a ticket.
+ * Encoding runs in parallel, and a finished frame waits in a reorder window
+ * until every earlier ticket is done. A worker does not take a frame more
+ * than a window ahead of the oldest unfinished one.
+ *
+ * Each worker keeps its libjpeg state, its row pointers and a staging frame
+ * for input the encoder cannot read directly, all set up in init(). Output
+ * buffers come from a preallocated pool. */
+class JpegEncoder {
+public:
+    struct Config {
+        int width;
+        int height;
+        rpi_format_t input_format; /* what the subscriber delivers */
+        int quality;              /* 1..100 */
+        unsigned int workers;
+        unsigned int out_buffers; /* encoded frames the consumer may hold */
+        rpi_overflow_policy_t policy;
+        bool lock;                /* mlock the output pool */
+    };
+
+    JpegEncoder();
+    ~JpegEncoder();
+
+    JpegEncoder(const JpegEncoder &) = delete;
+    JpegEncoder &operator=(const JpegEncoder &) = delete;
+
+    /* Take ownership of 'in' (even on failure) and allocate everything the
+     * workers need */
+    int init(rpi_subscriber_t *in, const Config &cfg);
+
+    /* Start the workers; the input subscriber must be running */
+    void start();
+    /* Join the workers and drop encoded frames nobody took. The input
+     * subscriber must already be stopped. */
+    void stop();
+
+    int get(rpi_frame_t *out, int timeout_ms);
+    int try_get(rpi_frame_t *out);
+    int fd() const { return out ? out->fd() : -1; }
+    int wait_ready(int timeout_ms) { return out->wait_ready(timeout_ms); }
+
+    /* Frames lost because the output pool was empty or encoding failed */
+    uint64_t dropped() const { return drop_count.load(std::memory_order_relaxed); }
+    /* Of those, encoded frames the output queue's policy refused or evicted */
+    uint64_t dropped_newest() const { return out ? out->dropped_newest_count() : 0; }
+    uint64_t dropped_oldest() const { return out ? out->dropped_oldest_count() : 0; }
+    int quality() const { return cfg.quality; }
+
+    void put(JpegFrame *f);
+
+private:
+    struct Worker;
+
+    void run(Worker *w);
+    JpegFrame *encode(Worker *w, const rpi_frame_t *src);
+    void deliver(uint64_t ticket, JpegFrame *f);
+    void lease(JpegFrame *f, rpi_frame_t *out);
+
+    Config cfg{};
+    rpi_subscriber_t *in = nullptr;
+    FramePool pool;
+    std::unique_ptr<JpegFrame[]> frames; /* one per pool buffer */
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::unique_ptr<FramePipeline<JpegFrame *>> out;
+
+    /* Intake: held while taking a ready frame from 'in' and numbering it,
+     * never while waiting for the camera */
+    std::mutex in_mtx;
+    uint64_t next_ticket = 0;
+
+    /* Reorder window, indexed by ticket modulo its size */
+    struct Pending {
+        bool done;
+        JpegFrame *frame; /* null if the frame was dropped */
+    };
+    std::mutex out_mtx;
+    std::condition_variable out_cv;
+    std::vector<Pending> pending;
+    uint64_t next_out = 0;
+    bool stopping = false;
+
+    std::atomic<uint64_t> drop_count{0};
+};
+
+#endif // JPEG_ENCODER_H
@@ -10,25 +10,229 @@ extern "C" {
 #include <stddef.h>
 
 typedef struct rpi_camera_t rpi_camera_t;
+typedef struct rpi_subscriber_t rpi_subscriber_t;
 
 typedef enum {
     RPI_FMT_YUV420,
     RPI_FMT_RGB888,
-    RPI_FMT_MJPEG /* MJPEG is not natively supported by libcamera on Raspberry Pi */
+    RPI_FMT_MJPEG, /* captured as YUV420, JPEG-encoded in software (get_frame only) */
+    RPI_FMT_RAW10, /* sensor Bayer, CSI-2 packed 10-bit; unpack with raw_unpack.h */
+    RPI_FMT_RAW12, /* sensor Bayer, CSI-2 packed 12-bit */
+    RPI_FMT_NV12,  /* Y plane + interleaved UV plane */
+    RPI_FMT_YUYV,  /* packed 4:2:2 */
+    RPI_FMT_BGRA,  /* B,G,R,A bytes, converted in software (get_frame only) */
+    RPI_FMT_GRAY8  /* luma only, converted in software (get_frame only) */
 } rpi_format_t;
 
+#define RPI_FRAME_MAX_PLANES 3
+
+/* One image plane (Y, U, V for YUV420; a single plane for packed formats).
+ * Rows are 'stride' bytes apart, of which 'width' * bytes-per-pixel are
+ * image data and the rest is padding. */
+typedef struct {
+    void *data;
+    size_t size;     /* bytes including stride padding */
+    uint32_t stride; /* bytes per row */
+    size_t offset;   /* from the start of the frame 'data' */
+} rpi_plane_t;
+
+/* RPI_META_* bits: which fields of rpi_frame_meta_t the pipeline reported */
+#define RPI_META_EXPOSURE           (1u << 0)
+#define RPI_META_ANALOGUE_GAIN      (1u << 1)
+#define RPI_META_COLOUR_TEMPERATURE (1u << 2)
+#define RPI_META_LUX                (1u << 3)
+#define RPI_META_SENSOR_TIMESTAMP   (1u << 4)
+#define RPI_META_FRAME_DURATION     (1u << 5)
+
+/* What the camera applied to one frame, from its request metadata */
+typedef struct {
+    uint32_t valid;             /* RPI_META_* */
+    int32_t exposure_us;
+    float analogue_gain;
+    int32_t colour_temperature; /* kelvin */
+    float lux;
+    int64_t sensor_timestamp;   /* ns, start of exposure of the first row */
+    int64_t frame_duration_us;
+    uint64_t control_ticket;    /* controls this frame's request carried, 0 = none */
+    uint64_t applied_ticket;    /* newest queued controls seen in effect, see
+                                 * rpi_camera_queue_controls() */
+} rpi_frame_meta_t;
+
 typedef struct {
     void *data;
     size_t size;
     uint64_t timestamp;
     uint32_t sequence;
+    int width;
+    int height;
+    rpi_format_t format; /* layout of 'data'; may differ from the one requested, see create */
+    uint32_t num_planes;
+    rpi_plane_t planes[RPI_FRAME_MAX_PLANES];
+    rpi_frame_meta_t meta;
+    void *priv; /* internal: owner of 'data', set by get/acquire, do not modify */
 } rpi_frame_t;
 
+/* Streams of one camera. The analysis stream is an ISP-scaled copy of the
+ * main stream, captured in the same request: same sequence and timestamp.
+ * The still stream only has a buffer in the requests that
+ * rpi_camera_capture_still() asks for. */
+typedef enum {
+    RPI_STREAM_MAIN,
+    RPI_STREAM_ANALYSIS,
+    RPI_STREAM_STILL,
+    RPI_STREAM_COUNT
+} rpi_stream_t;
+
+#define RPI_CAMERA_DEFAULT_POOL_BUFFERS 4
+#define RPI_CAMERA_DEFAULT_QUEUE_DEPTH 4
+#define RPI_CAMERA_DEFAULT_JPEG_QUALITY 85
+#define RPI_CAMERA_DEFAULT_JPEG_WORKERS 2
+#define RPI_CAMERA_MAX_SUBSCRIBERS 8
+
+/* What happens when a frame completes while the queue is full */
+typedef enum {
+    RPI_OVERFLOW_DROP_NEWEST, /* keep what is queued, drop the new frame (recorders) */
+    RPI_OVERFLOW_DROP_OLDEST, /* evict the oldest queued frame (bounded latency) */
+    RPI_OVERFLOW_LATEST       /* single-slot mailbox, always the newest frame (preview) */
+} rpi_overflow_policy_t;
+
+/* Creation parameters. Fill with rpi_camera_config_init() and override the
+ * fields you need before rpi_camera_create_ex(). */
+typedef struct {
+    int width;
+    int height;
+    rpi_format_t format;
+    unsigned int pool_buffers; /* frame-sized buffers for get_frame(), 0 = none */
+    int pool_lock;             /* mlock the pool so it can never be paged out */
+    rpi_overflow_policy_t overflow_policy;
+    unsigned int buffer_count; /* camera buffers (one request each), 0 = libcamera default */
+    unsigned int queue_depth;  /* get/acquire queue, 0 = RPI_CAMERA_DEFAULT_QUEUE_DEPTH */
+    int64_t frame_duration_min_us; /* FrameDurationLimits, 0 = sensor default; */
+    int64_t frame_duration_max_us; /* min == max fixes the frame rate */
+    int camera_index;          /* which camera to open, see rpi_camera_count() */
+    const char *camera_id;     /* libcamera id; overrides camera_index when set */
+    int analysis_width;        /* analysis stream size, 0 = no analysis stream */
+    int analysis_height;
+    rpi_format_t analysis_format;
+    int still_width;           /* still stream size, 0 = no still stream */
+    int still_height;
+    rpi_format_t still_format;
+    int jpeg_quality;          /* MJPEG: 1..100 */
+    unsigned int jpeg_workers; /* MJPEG: encoder threads */
+    int worker_cpu;            /* pin the frame worker thread to this CPU, -1 = any */
+    int worker_priority;       /* its SCHED_FIFO priority (1..99), 0 = normal scheduling */
+} rpi_camera_config_t;
+
+/* How one MJPEG frame was made; its JPEG size is the frame 'size' */
+typedef struct {
+    uint64_t encode_ns; /* time spent encoding this frame */
+    uint32_t worker;    /* encoder thread that made it */
+    int quality;
+} rpi_jpeg_info_t;
+
+/* RPI_CTRL_* bits: which fields of rpi_controls_t to apply */
+#define RPI_CTRL_BRIGHTNESS (1u << 0)
+#define RPI_CTRL_CONTRAST   (1u << 1)
+#define RPI_CTRL_EXPOSURE   (1u << 2)
+#define RPI_CTRL_GAIN       (1u << 3)
+#define RPI_CTRL_AE_ENABLE  (1u << 4)
+#define RPI_CTRL_FRAME_DURATION (1u << 5)
+
+typedef struct {
+    uint32_t set;        /* RPI_CTRL_* */
+    float brightness;    /* -1.0 to 1.0 */
+    float contrast;      /* 0.0 to 2.0 */
+    int exposure_us;
+    float analogue_gain; /* 1.0 to 16.0 */
+    int ae_enable;
+    int64_t frame_duration_min_us; /* FrameDurationLimits */
+    int64_t frame_duration_max_us;
+} rpi_controls_t;
+
+/* Latency histograms are log2 buckets of microseconds: bucket 0 counts
+ * under 2 us, bucket i counts [2^i, 2^(i+1)) us, the last one everything
+ * longer. */
+#define RPI_STATS_LATENCY_BUCKETS 32
+
+/* Counters since the camera was created. Each field is read on its own, so
+ * a snapshot taken while frames flow may be off by the frame in flight. */
+typedef struct {
+    uint64_t frames_completed;  /* requests the camera handed back */
+    uint64_t frames_delivered;  /* frames taken from a queue, counted once
+                                   per subscriber (the MJPEG encoder is one) */
+    uint64_t dropped_pipeline;  /* frames a full queue rejected or evicted,
+                                   plus MJPEG frames the encoder lost */
+    uint64_t dropped_newest;    /* of those, new frames DROP_NEWEST refused */
+    uint64_t dropped_oldest;    /* ...and queued frames DROP_OLDEST or LATEST
+                                   evicted; encode failures count in neither */
+    uint64_t dropped_sensor;    /* gaps in the sensor sequence while running */
+    uint32_t queue_high_water;  /* deepest any subscriber queue has been */
+    uint64_t start_to_first_frame_ns; /* last rpi_camera_start() to the first
+                                         request it completed, 0 until then */
+    uint64_t stills;            /* requests that carried a still buffer */
+    uint64_t still_video_lost;  /* sensor gaps before each still and the
+                                   frame after it (already in dropped_sensor) */
+    /* Start of frame (SensorTimestamp, else the buffer timestamp) to
+     * request completion */
+    uint64_t sensor_to_complete[RPI_STATS_LATENCY_BUCKETS];
+    /* Request completion to a consumer taking the frame from its queue */
+    uint64_t complete_to_consumer[RPI_STATS_LATENCY_BUCKETS];
+    /* Calls made by the whole process, counted only by a library built with
+     * -DRPI_CAMERA_INSTRUMENT=ON ('instrumented' is 0 and these stay 0
+     * otherwise). Diff two snapshots and divide by frames_completed for the
+     * per-frame cost of the steady state. */
+    int instrumented;
+    uint64_t allocs;            /* malloc/calloc/realloc/memalign, C++ new */
+    uint64_t frees;
+    uint64_t mmaps;
+    uint64_t munmaps;
+    uint64_t ioctls;
+} rpi_camera_stats_t;
+
+/* Where opening a camera spent its time, ns. The first four phases are
+ * rpi_camera_create_ex(); manager is near zero when the shared
+ * CameraManager was already up (another camera, or rpi_camera_prewarm()). */
+typedef struct {
+    uint64_t manager_ns;     /* start the CameraManager: enumerate, load IPAs */
+    uint64_t acquire_ns;     /* find and acquire the camera */
+    uint64_t configure_ns;   /* generate, validate and apply the configuration */
+    uint64_t allocate_ns;    /* buffers, mappings, requests, pool, encoder */
+    uint64_t first_frame_ns; /* first rpi_camera_start() to its first completed
+                                request, 0 until then */
+} rpi_camera_startup_t;
+
+/* How one rpi_camera_capture_still() went */
+typedef struct {
+    uint64_t latency_ns;        /* call to the still being ready */
+    uint32_t video_frames_lost; /* sensor gap just before the still's frame */
+} rpi_still_info_t;
+
 // // Callback khi có frame mới
 // typedef void (*rpi_frame_callback_t)(rpi_frame_t *frame, void *userdata);
 
 // API functions
+int rpi_camera_count(void);
+int rpi_camera_get_id(int index, char *buf, size_t len);
+/* Start the process-wide CameraManager on a background thread, so the
+ * first rpi_camera_create() finds the cameras enumerated and the IPA
+ * modules loaded. Call it early at process start; a create() that comes
+ * while it runs waits for it. The manager then stays up with no camera
+ * open until rpi_camera_prewarm_release(), which also waits for the
+ * thread; exit() releases it if the caller did not. */
+void rpi_camera_prewarm(void);
+void rpi_camera_prewarm_release(void);
 rpi_camera_t* rpi_camera_create(int width, int height, rpi_format_t format);
+void rpi_camera_config_init(rpi_camera_config_t *cfg, int width, int height,
+                            rpi_format_t format);
+/* Latency/throughput presets, applied on top of an initialised config:
+ *   "default"     - libcamera buffer count, queue of 4
+ *   "low-latency" - 2 buffers, single-slot mailbox, frame rate fixed at
+ *                   CAMERA_FRAME_RATE so exposure cannot stretch frames
+ *   "throughput"  - 6 buffers, queue of 16 that drops nothing while it
+ *                   has room
+ * Returns -EINVAL for an unknown name. */
+int rpi_camera_config_profile(rpi_camera_config_t *cfg, const char *profile);
+rpi_camera_t* rpi_camera_create_ex(const rpi_camera_config_t *cfg);
 int rpi_camera_start(rpi_camera_t *cam);
 int rpi_camera_stop(rpi_camera_t *cam);
 void rpi_camera_destroy(rpi_camera_t *cam);
@@ -38,10 +242,103 @@ int rpi_camera_set_brightness(rpi_camera_t *cam, float value); // -1.0 to 1.0
 int rpi_camera_set_contrast(rpi_camera_t *cam, float value);   // 0.0 to 2.0
 int rpi_camera_set_exposure(rpi_camera_t *cam, int microseconds);
 int rpi_camera_set_gain(rpi_camera_t *cam, float value);       // 1.0 to 16.0
-/* API for user */
+int rpi_camera_set_fps(rpi_camera_t *cam, float fps);          // fixed frame duration
+/* Queue controls for the next request handed to the camera; values are
+ * clamped to what the camera supports. Controls queued before the next
+ * request goes out are merged, later values winning. '*ticket' (optional)
+ * identifies the batch: frames whose request carried it report it as
+ * meta.control_ticket, and the first frame whose exposure and gain match
+ * the batch (within sensor rounding) reports it as meta.applied_ticket.
+ * Batches without exposure or gain count as applied when their request
+ * completes. A value the sensor cannot reach, such as an exposure longer
+ * than the frame, is never confirmed. The set_* calls above queue too. */
+int rpi_camera_queue_controls(rpi_camera_t *cam, const rpi_controls_t *ctrls,
+                              uint64_t *ticket);
+/* Burst / exposure bracketing: 'count' frames, the i-th taken with
+ * brackets[i] (typically AE off plus exposure and gain). Each bracket
+ * rides on its own request, queued back to back, so the sensor sees them
+ * on consecutive frames. frames[i] is the first frame whose metadata shows
+ * brackets[i] (within sensor rounding), so the sensor's control delay costs
+ * transition frames but no bracket; frames[i].meta holds what was applied.
+ * Release every frame with rpi_camera_release_frame(). The kept frames are
+ * out of circulation until then, so buffer_count must be at least
+ * count + 2, plus whatever subscriber queues hold meanwhile. The last
+ * bracket stays in effect; queue AE back on if wanted.
+ * Returns -EAGAIN while not started, -EBUSY during another burst,
+ * -ETIMEDOUT, or -EPIPE when the camera stops first. */
+int rpi_camera_capture_burst(rpi_camera_t *cam, const rpi_controls_t *brackets,
+                             unsigned int count, rpi_frame_t *frames, int timeout_ms);
+/* API for user. With RPI_FMT_MJPEG these return encoded frames, in
+ * sequence order, and the fd below polls readable while one is ready. */
 int rpi_camera_get_frame(rpi_camera_t *cam, rpi_frame_t *out);
 int rpi_camera_try_get_frame(rpi_camera_t *cam, rpi_frame_t *out);
+/* timeout_ms < 0 blocks; returns -ETIMEDOUT when nothing arrived in time */
+int rpi_camera_get_frame_timeout(rpi_camera_t *cam, rpi_frame_t *out, int timeout_ms);
 void rpi_camera_release_frame(rpi_frame_t *f);
+/* Encode details of a frame from an MJPEG camera's get_frame(); -EINVAL
+ * for any other frame */
+int rpi_frame_get_jpeg_info(const rpi_frame_t *f, rpi_jpeg_info_t *info);
+/* Zero-copy API: 'data' points straight into the camera buffer, which stays
+ * out of the sensor queue until rpi_camera_release_frame(). A frame held
+ * across rpi_camera_stop() stays valid, and its buffer sits out the next
+ * run until released. Frames are in the format the ISP wrote ('format'),
+ * which for BGRA/GRAY8/MJPEG is YUV420; get_frame() converts or encodes.
+ * The get/acquire queue is a subscriber attached on first use; -ENOSPC if
+ * all RPI_CAMERA_MAX_SUBSCRIBERS are taken then. */
+int rpi_camera_acquire_frame(rpi_camera_t *cam, rpi_frame_t *out);
+int rpi_camera_try_acquire_frame(rpi_camera_t *cam, rpi_frame_t *out);
+int rpi_camera_acquire_frame_timeout(rpi_camera_t *cam, rpi_frame_t *out, int timeout_ms);
+/* Event-loop integration: the fd polls readable (POLLIN) while a frame is
+ * ready. On wakeup, take frames with rpi_camera_try_acquire_frame() or
+ * rpi_camera_try_get_frame() until -EAGAIN; the fd must not be read. */
+int rpi_camera_get_fd(rpi_camera_t *cam);
+
+/* Fan-out: each subscriber gets every frame in its own queue. Subscribers
+ * share one reference-counted buffer, which goes back to the sensor when the
+ * last of them releases it. A subscriber that stops consuming holds up to
+ * 'queue_depth' buffers, so keep the total depth below the buffer count or
+ * use an evicting policy. The rpi_camera_get/acquire API is itself one
+ * subscriber, attached the first time it is called. Release frames with
+ * rpi_camera_release_frame(). */
+rpi_subscriber_t *rpi_camera_subscribe(rpi_camera_t *cam, unsigned int queue_depth,
+                                       rpi_overflow_policy_t policy);
+void rpi_camera_unsubscribe(rpi_subscriber_t *sub);
+int rpi_subscriber_acquire_frame(rpi_subscriber_t *sub, rpi_frame_t *out, int timeout_ms);
+int rpi_subscriber_try_acquire_frame(rpi_subscriber_t *sub, rpi_frame_t *out);
+int rpi_subscriber_get_fd(rpi_subscriber_t *sub);
+/* Subscriber on one stream. RPI_STREAM_ANALYSIS needs analysis_width/height
+ * in the config; its frames hold the same buffer as the main stream's, so
+ * either being held keeps the request from the sensor. */
+rpi_subscriber_t *rpi_camera_subscribe_stream(rpi_camera_t *cam, rpi_stream_t stream,
+                                              unsigned int queue_depth,
+                                              rpi_overflow_policy_t policy);
+/* libcamera name of a stream's pixel format, e.g. "SBGGR10_CSI2P" for raw
+ * capture, which tells the Bayer order */
+int rpi_camera_get_format_name(rpi_camera_t *cam, rpi_stream_t stream,
+                               char *buf, size_t len);
+/* Negotiated size of a stream; -ENODEV if it is not configured */
+int rpi_camera_get_stream_size(rpi_camera_t *cam, rpi_stream_t stream,
+                               int *width, int *height);
+/* Full-resolution still while video runs, from the still stream set up by
+ * still_width/height in the config. The still buffer rides on the next
+ * request that goes back to the camera, so video neither stops nor
+ * reconfigures; the frame carrying it also fills the main stream as usual.
+ * 'out' is a lease like rpi_camera_acquire_frame()'s: release it with
+ * rpi_camera_release_frame(), after which the next still can be taken.
+ * It waits behind the requests already queued, so the latency is about
+ * buffer_count frames; 'info' (optional) reports it and the video frames
+ * the larger frame cost. Returns -ENODEV without a still stream, -EAGAIN while not
+ * started, -EBUSY while a still is pending or held, -ETIMEDOUT, or -EPIPE
+ * when the camera stops first. The sensor runs in a mode big enough for
+ * the still, which may cap the video frame rate. The Pi ISP has two
+ * outputs, so unless the main stream is raw the still excludes the
+ * analysis stream. */
+int rpi_camera_capture_still(rpi_camera_t *cam, rpi_frame_t *out, int timeout_ms,
+                             rpi_still_info_t *info);
+/* Snapshot of the runtime counters. Reading them takes no lock and does
+ * not stall the capture path. */
+int rpi_camera_get_stats(rpi_camera_t *cam, rpi_camera_stats_t *stats);
+int rpi_camera_get_startup(rpi_camera_t *cam, rpi_camera_startup_t *out);
 void WaitForFirstFrame(rpi_camera_t *cam);
 #ifdef __cplusplus
 } // EXTERN C
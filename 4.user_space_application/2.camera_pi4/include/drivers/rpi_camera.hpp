@@ -0,0 +1,432 @@
+// rpi_camera.hpp - C++20 front-end over the C API (header only)
+#ifndef RPI_CAMERA_HPP
+#define RPI_CAMERA_HPP
+
+#if __cplusplus < 202002L
+#error "rpi_camera.hpp needs C++20 (coroutines, std::span)"
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "rpi_camera.h"
+
+/* RAII over the C API: a Camera destroys its rpi_camera_t, a FrameHandle
+ * releases its frame, a Subscription unsubscribes, so an early return or an
+ * exception cannot leak any of them. next_frame() is awaitable: a coroutine
+ * suspends on the camera's event fd in an EventLoop instead of blocking a
+ * thread, so one thread can drive several cameras and sockets.
+ *
+ * Like the C API, calls return 0 or -errno, and a frame must be released
+ * (its handle destroyed or reset) before the camera it came from is
+ * destroyed; one kept across stop() holds its buffer out of the next run.
+ * Nothing here is thread-safe beyond what the C API is. */
+namespace rpi {
+
+/* One plane of a frame: 'bytes' spans all rows, 'stride' apart */
+struct Plane {
+    std::span<const std::uint8_t> bytes;
+    std::uint32_t stride = 0;
+
+    std::span<const std::uint8_t> row(std::size_t y) const
+    {
+        std::size_t at = y * stride;
+        return bytes.subspan(at, std::min<std::size_t>(stride, bytes.size() - at));
+    }
+};
+
+/* Owns one frame from get/acquire; releases it when destroyed. An empty
+ * handle keeps the error that left it empty. */
+class FrameHandle {
+public:
+    FrameHandle() = default;
+    explicit FrameHandle(int error) : error_(error) {}
+    explicit FrameHandle(const rpi_frame_t &frame) : frame_(frame), held_(true) {}
+    ~FrameHandle() { reset(); }
+
+    FrameHandle(FrameHandle &&o) noexcept
+        : frame_(o.frame_), held_(std::exchange(o.held_, false)), error_(o.error_) {}
+    FrameHandle &operator=(FrameHandle &&o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            frame_ = o.frame_;
+            held_ = std::exchange(o.held_, false);
+            error_ = o.error_;
+        }
+        return *this;
+    }
+    FrameHandle(const FrameHandle &) = delete;
+    FrameHandle &operator=(const FrameHandle &) = delete;
+
+    explicit operator bool() const { return held_; }
+    int error() const { return held_ ? 0 : error_; }
+
+    void reset()
+    {
+        if (held_)
+            rpi_camera_release_frame(&frame_);
+        held_ = false;
+    }
+
+    const rpi_frame_t &raw() const { return frame_; }
+    const rpi_frame_meta_t &meta() const { return frame_.meta; }
+    std::uint32_t sequence() const { return frame_.sequence; }
+    std::uint64_t timestamp() const { return frame_.timestamp; }
+    int width() const { return frame_.width; }
+    int height() const { return frame_.height; }
+    rpi_format_t format() const { return frame_.format; }
+
+    std::span<const std::uint8_t> data() const
+    {
+        return { static_cast<const std::uint8_t *>(frame_.data), frame_.size };
+    }
+    std::size_t num_planes() const { return frame_.num_planes; }
+    Plane plane(std::size_t i) const
+    {
+        if (i >= frame_.num_planes)
+            return {};
+        const rpi_plane_t &p = frame_.planes[i];
+        return { { static_cast<const std::uint8_t *>(p.data), p.size }, p.stride };
+    }
+
+private:
+    rpi_frame_t frame_ = {};
+    bool held_ = false;
+    int error_ = -ENODATA;
+};
+
+/* Single-threaded epoll loop. Watches are level-triggered; coroutines are
+ * resumed from run(), never from inside a watch callback, so a resumed
+ * coroutine may watch the same fd again. */
+class EventLoop {
+public:
+    EventLoop() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~EventLoop()
+    {
+        if (epfd_ >= 0)
+            close(epfd_);
+    }
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    /* Call 'fn' each time 'fd' polls readable until it returns false. One
+     * watch per fd: -EEXIST if it already has one. */
+    int watch(int fd, std::function<bool()> fn)
+    {
+        if (epfd_ < 0 || fd < 0)
+            return -EBADF;
+        if ((std::size_t)fd >= watches_.size())
+            watches_.resize(fd + 1);
+        if (watches_[fd])
+            return -EEXIST;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+            return -errno;
+        watches_[fd] = std::move(fn);
+        watched_++;
+        return 0;
+    }
+
+    void unwatch(int fd)
+    {
+        if (fd < 0 || (std::size_t)fd >= watches_.size() || !watches_[fd])
+            return;
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        watches_[fd] = nullptr;
+        watched_--;
+    }
+
+    /* Resume 'h' on the next turn of the loop */
+    void post(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+    /* Until stop(), or nothing is left to watch or resume */
+    void run()
+    {
+        stopping_ = false;
+        std::vector<std::coroutine_handle<>> resume;
+        while (!stopping_ && (watched_ || !ready_.empty())) {
+            resume.swap(ready_);
+            for (auto h : resume)
+                h.resume();
+            resume.clear();
+            if (stopping_ || !watched_)
+                continue;
+
+            struct epoll_event events[16];
+            int n = epoll_wait(epfd_, events, 16, ready_.empty() ? -1 : 0);
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if ((std::size_t)fd < watches_.size() && watches_[fd] && !watches_[fd]())
+                    unwatch(fd);
+            }
+        }
+    }
+
+    void stop() { stopping_ = true; }
+
+private:
+    int epfd_;
+    std::vector<std::function<bool()>> watches_; /* by fd */
+    std::size_t watched_ = 0;
+    std::vector<std::coroutine_handle<>> ready_;
+    bool stopping_ = false;
+};
+
+/* Fire-and-forget coroutine: runs at once up to its first suspension and
+ * frees itself when it returns. An exception escaping it terminates, as one
+ * escaping a thread would. */
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+class Camera;
+class Subscription;
+
+/* What next_frame() returns: takes a frame at once if one is queued, else
+ * suspends until the fd says one is. Resumes with an empty handle holding
+ * -EPIPE if the camera is stopped meanwhile. */
+class FrameAwaiter {
+public:
+    bool await_ready()
+    {
+        result_ = take();
+        return result_ || result_.error() != -EAGAIN;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        handle_ = h;
+        int ret = loop_.watch(fd_, [this] { return on_ready(); });
+        if (ret < 0)
+            finish(FrameHandle(ret));
+        else if (pending_)
+            *pending_ = this;
+    }
+
+    FrameHandle await_resume() { return std::move(result_); }
+
+private:
+    friend class Camera;
+    friend class Subscription;
+
+    FrameAwaiter(EventLoop &loop, rpi_camera_t *cam, rpi_subscriber_t *sub, bool copy,
+                 FrameAwaiter **pending)
+        : loop_(loop), cam_(cam), sub_(sub), copy_(copy), pending_(pending),
+          fd_(sub ? rpi_subscriber_get_fd(sub) : rpi_camera_get_fd(cam)) {}
+
+    FrameHandle take()
+    {
+        rpi_frame_t frame;
+        int ret = sub_    ? rpi_subscriber_try_acquire_frame(sub_, &frame)
+                  : copy_ ? rpi_camera_try_get_frame(cam_, &frame)
+                          : rpi_camera_try_acquire_frame(cam_, &frame);
+        return ret ? FrameHandle(ret) : FrameHandle(frame);
+    }
+
+    /* Watch callback: false once there is something to resume with */
+    bool on_ready()
+    {
+        FrameHandle f = take();
+        if (!f && f.error() == -EAGAIN)
+            return true;
+        result_ = std::move(f);
+        if (pending_)
+            *pending_ = nullptr;
+        loop_.post(handle_);
+        return false;
+    }
+
+    void finish(FrameHandle f)
+    {
+        result_ = std::move(f);
+        if (pending_ && *pending_ == this)
+            *pending_ = nullptr;
+        loop_.post(handle_);
+    }
+
+    /* Camera stop: the fd may never fire again */
+    void cancel()
+    {
+        loop_.unwatch(fd_);
+        finish(FrameHandle(-EPIPE));
+    }
+
+    EventLoop &loop_;
+    rpi_camera_t *cam_;
+    rpi_subscriber_t *sub_;
+    bool copy_;
+    FrameAwaiter **pending_;
+    int fd_;
+    std::coroutine_handle<> handle_;
+    FrameHandle result_;
+};
+
+/* Owns an rpi_camera_t. Empty (false) if creation failed. */
+class Camera {
+public:
+    Camera() = default;
+    explicit Camera(const rpi_camera_config_t &cfg) : cam_(rpi_camera_create_ex(&cfg)) {}
+    Camera(int width, int height, rpi_format_t format)
+        : cam_(rpi_camera_create(width, height, format)) {}
+    ~Camera() { reset(); }
+
+    /* A coroutine suspended in next_frame() keeps a pointer to its camera's
+     * slot, so a camera with one pending is not moved */
+    Camera(Camera &&o) noexcept : cam_(std::exchange(o.cam_, nullptr)) {}
+    Camera &operator=(Camera &&o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            cam_ = std::exchange(o.cam_, nullptr);
+        }
+        return *this;
+    }
+    Camera(const Camera &) = delete;
+    Camera &operator=(const Camera &) = delete;
+
+    explicit operator bool() const { return cam_ != nullptr; }
+    rpi_camera_t *get() const { return cam_; }
+
+    void reset()
+    {
+        if (!cam_)
+            return;
+        cancel_pending();
+        rpi_camera_destroy(std::exchange(cam_, nullptr));
+    }
+
+    int start() { return rpi_camera_start(cam_); }
+    int stop()
+    {
+        cancel_pending();
+        return rpi_camera_stop(cam_);
+    }
+
+    int queue_controls(const rpi_controls_t &ctrls, std::uint64_t *ticket = nullptr)
+    {
+        return rpi_camera_queue_controls(cam_, &ctrls, ticket);
+    }
+    int stats(rpi_camera_stats_t &out) const { return rpi_camera_get_stats(cam_, &out); }
+    int fd() const { return rpi_camera_get_fd(cam_); }
+
+    /* Blocking and non-blocking takes; timeout_ms < 0 waits forever.
+     * acquire is zero-copy, get converts (BGRA, GRAY8) or encodes (MJPEG). */
+    FrameHandle acquire_frame(int timeout_ms = -1)
+    {
+        rpi_frame_t f;
+        int ret = rpi_camera_acquire_frame_timeout(cam_, &f, timeout_ms);
+        return ret ? FrameHandle(ret) : FrameHandle(f);
+    }
+    FrameHandle get_frame(int timeout_ms = -1)
+    {
+        rpi_frame_t f;
+        int ret = rpi_camera_get_frame_timeout(cam_, &f, timeout_ms);
+        return ret ? FrameHandle(ret) : FrameHandle(f);
+    }
+    FrameHandle try_acquire_frame()
+    {
+        rpi_frame_t f;
+        int ret = rpi_camera_try_acquire_frame(cam_, &f);
+        return ret ? FrameHandle(ret) : FrameHandle(f);
+    }
+
+    /* co_await cam.next_frame(loop): the next frame, acquired, or with
+     * 'copy' taken through get_frame(). One awaiter per camera at a time. */
+    FrameAwaiter next_frame(EventLoop &loop, bool copy = false)
+    {
+        return FrameAwaiter(loop, cam_, nullptr, copy, &pending_);
+    }
+
+private:
+    void cancel_pending()
+    {
+        if (pending_)
+            pending_->cancel();
+    }
+
+    rpi_camera_t *cam_ = nullptr;
+    FrameAwaiter *pending_ = nullptr;
+};
+
+/* Owns a subscriber (see rpi_camera_subscribe_stream()); unsubscribes when
+ * destroyed. Destroy it before its camera. */
+class Subscription {
+public:
+    Subscription() = default;
+    Subscription(Camera &cam, unsigned int queue_depth, rpi_overflow_policy_t policy,
+                 rpi_stream_t stream = RPI_STREAM_MAIN)
+        : sub_(rpi_camera_subscribe_stream(cam.get(), stream, queue_depth, policy)) {}
+    ~Subscription() { reset(); }
+
+    Subscription(Subscription &&o) noexcept : sub_(std::exchange(o.sub_, nullptr)) {}
+    Subscription &operator=(Subscription &&o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            sub_ = std::exchange(o.sub_, nullptr);
+        }
+        return *this;
+    }
+    Subscription(const Subscription &) = delete;
+    Subscription &operator=(const Subscription &) = delete;
+
+    explicit operator bool() const { return sub_ != nullptr; }
+    rpi_subscriber_t *get() const { return sub_; }
+
+    void reset()
+    {
+        if (!sub_)
+            return;
+        if (pending_)
+            pending_->cancel();
+        rpi_camera_unsubscribe(std::exchange(sub_, nullptr));
+    }
+
+    int fd() const { return rpi_subscriber_get_fd(sub_); }
+
+    FrameHandle acquire_frame(int timeout_ms = -1)
+    {
+        rpi_frame_t f;
+        int ret = rpi_subscriber_acquire_frame(sub_, &f, timeout_ms);
+        return ret ? FrameHandle(ret) : FrameHandle(f);
+    }
+    FrameHandle try_acquire_frame()
+    {
+        rpi_frame_t f;
+        int ret = rpi_subscriber_try_acquire_frame(sub_, &f);
+        return ret ? FrameHandle(ret) : FrameHandle(f);
+    }
+
+    /* Stopping the camera does not wake a subscription's awaiter; it
+     * resumes with the first frame after the next start */
+    FrameAwaiter next_frame(EventLoop &loop)
+    {
+        return FrameAwaiter(loop, nullptr, sub_, false, &pending_);
+    }
+
+private:
+    rpi_subscriber_t *sub_ = nullptr;
+    FrameAwaiter *pending_ = nullptr;
+};
+
+} // namespace rpi
+
+#endif // RPI_CAMERA_HPP
@@ -0,0 +1,29 @@
+// instrument.h - Allocation and syscall counters for the steady-state checks
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Process-wide calls since the library was loaded */
+typedef struct {
+    uint64_t allocs;  /* malloc, calloc, realloc, memalign family, C++ new */
+    uint64_t frees;
+    uint64_t mmaps;
+    uint64_t munmaps;
+    uint64_t ioctls;
+} instrument_counts_t;
+
+/* Built with RPI_CAMERA_INSTRUMENT, the library interposes malloc/free and
+ * mmap/munmap/ioctl for the whole process and counts every call. Fills 'c'
+ * and returns 1 in such a build; otherwise zeroes it and returns 0. */
+int instrument_read(instrument_counts_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,53 @@
+// pixel_convert.h - Pixel format conversion between rpi_frame_t layouts
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rpi_camera.h"
+
+/* YCbCr to RGB matrix. Limited-range BT.601/BT.709 for video streams,
+ * full-range BT.601 for JPEG/sYCC. */
+typedef enum {
+    PIXCONV_BT601,
+    PIXCONV_BT709,
+    PIXCONV_JPEG
+} pixconv_matrix_t;
+
+typedef enum {
+    PIXCONV_IMPL_AUTO,   /* best the CPU supports */
+    PIXCONV_IMPL_SCALAR,
+    PIXCONV_IMPL_SSE2,
+    PIXCONV_IMPL_AVX2,
+    PIXCONV_IMPL_NEON
+} pixconv_impl_t;
+
+/* Supported conversions ('src' -> 'dst'):
+ *   YUV420, NV12, YUYV -> YUV420, NV12, RGB888, BGRA, GRAY8
+ * and a plain copy when both formats are the same. RGB888 follows the
+ * libcamera/DRM fourcc and is B,G,R in memory; BGRA is B,G,R,A with A = 255. YUYV needs an even width.
+ * 'dst' must have format, width, height and planes filled in, e.g. by
+ * pixconv_frame_init(). Returns 0, or -EINVAL for an unsupported pair. */
+int pixconv_convert(const rpi_frame_t *src, rpi_frame_t *dst, pixconv_matrix_t matrix);
+
+/* Bytes a tightly packed frame of this format needs, 0 if unknown */
+size_t pixconv_frame_size(rpi_format_t format, int width, int height);
+
+/* Describe a tightly packed frame in 'buf' (pixconv_frame_size() bytes) */
+int pixconv_frame_init(rpi_frame_t *frame, rpi_format_t format, int width, int height,
+                       void *buf, size_t size);
+
+/* Pick the kernels used by every later call (benchmarks, tests). Returns 0,
+ * or -1 if the CPU cannot run that implementation. */
+int pixconv_select(pixconv_impl_t impl);
+const char *pixconv_impl_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIXEL_CONVERT_H
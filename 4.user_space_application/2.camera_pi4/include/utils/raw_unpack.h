@@ -0,0 +1,39 @@
+// raw_unpack.h - Unpack MIPI CSI-2 packed Bayer data to 16-bit samples
+#ifndef RAW_UNPACK_H
+#define RAW_UNPACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rpi_camera.h"
+
+/* CSI-2 RAW10: 4 pixels in 5 bytes, bytes 0-3 hold bits 9:2, byte 4 holds
+ * bits 1:0 of each pixel, pixel 0 in the lowest bits.
+ * CSI-2 RAW12: 2 pixels in 3 bytes, bytes 0-1 hold bits 11:4, byte 2 holds
+ * bits 3:0, pixel 0 in the low nibble.
+ * Output samples are right-aligned (0..1023 / 0..4095). A row is padded to
+ * a whole group, so 'src' must hold the full group of the last pixel. */
+void raw_unpack10(const uint8_t *src, uint16_t *dst, size_t pixels);
+void raw_unpack12(const uint8_t *src, uint16_t *dst, size_t pixels);
+
+/* Reference versions, also used for the tail the vector kernels leave */
+void raw_unpack10_scalar(const uint8_t *src, uint16_t *dst, size_t pixels);
+void raw_unpack12_scalar(const uint8_t *src, uint16_t *dst, size_t pixels);
+
+/* Unpack a whole frame into 'dst', 'dst_stride' bytes per row (at least
+ * width * 2). Returns 0, or -EINVAL unless frame->format is RPI_FMT_RAW10
+ * or RPI_FMT_RAW12. */
+int raw_unpack_frame(const rpi_frame_t *frame, uint16_t *dst, size_t dst_stride);
+
+/* Kernel selected on this CPU: "neon" (AArch64, and ARMv7 built with
+ * NEON), "ssse3" or "scalar" */
+const char *raw_unpack_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_UNPACK_H
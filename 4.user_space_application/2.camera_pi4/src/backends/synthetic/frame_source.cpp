@@ -0,0 +1,340 @@
+// ============================================================================
+// frame_source.cpp - Test pattern / file replay and per-stream rendering
+// ============================================================================
+
+#include "frame_source.h"
+#include "log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace synthetic {
+
+/* 75% colour bars in limited-range BT.601: white, yellow, cyan, green,
+ * magenta, red, blue, black */
+static const uint8_t k_bars[8][3] = {
+    { 180, 128, 128 }, { 162, 44, 142 }, { 131, 156, 44 }, { 112, 72, 58 },
+    { 84, 184, 198 },  { 65, 100, 212 }, { 35, 212, 114 }, { 16, 128, 128 },
+};
+
+/* Frames the moving block takes to cross the frame once */
+#define BLOCK_CROSSING_FRAMES 90
+/* Peak luma of the fixed-pattern grain. Flat bars compress far better than
+ * a real scene; the grain keeps JPEG sizes and encode times realistic. */
+#define GRAIN_AMPLITUDE 3
+
+FrameSource::~FrameSource()
+{
+    if (map_)
+        munmap((void *)map_, map_size_);
+}
+
+std::shared_ptr<FrameSource> FrameSource::open(const std::string &spec, int width, int height)
+{
+    std::shared_ptr<FrameSource> src(new FrameSource());
+    if (spec.empty() || spec == "pattern") {
+        src->name_ = "pattern";
+        return src;
+    }
+
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1)) {
+        LOG_ERROR("Replay size %dx%d must be positive and even", width, height);
+        return nullptr;
+    }
+    int fd = ::open(spec.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open replay file %s: %s", spec.c_str(), strerror(errno));
+        return nullptr;
+    }
+    struct stat st;
+    size_t frame_size = (size_t)width * height * 3 / 2;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < frame_size) {
+        LOG_ERROR("%s holds no %dx%d YUV420 frame", spec.c_str(), width, height);
+        ::close(fd);
+        return nullptr;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Cannot map replay file %s", spec.c_str());
+        return nullptr;
+    }
+
+    src->name_ = spec;
+    src->width_ = width;
+    src->height_ = height;
+    src->map_ = (const uint8_t *)map;
+    src->map_size_ = st.st_size;
+    src->frame_size_ = frame_size;
+    src->frame_count_ = (uint32_t)(st.st_size / frame_size);
+    if ((size_t)st.st_size % frame_size)
+        LOG_WARN("%s: %zu trailing bytes ignored", spec.c_str(),
+                 (size_t)st.st_size % frame_size);
+    LOG_INFO("Replaying %u frame(s) of %dx%d from %s", src->frame_count_, width, height,
+             spec.c_str());
+    return src;
+}
+
+const uint8_t *FrameSource::frame(uint32_t index) const
+{
+    return map_ + (size_t)(index % frame_count_) * frame_size_;
+}
+
+int StreamRenderer::configure(std::shared_ptr<const FrameSource> source, rpi_format_t format,
+                              int width, int height, uint32_t stride,
+                              pixconv_matrix_t matrix)
+{
+    if (!source || width <= 0 || height <= 0 || (width & 1) || (height & 1))
+        return -EINVAL;
+
+    source_ = std::move(source);
+    format_ = format;
+    width_ = width;
+    height_ = height;
+    stride_ = stride;
+    matrix_ = matrix;
+    lut_valid_ = false;
+
+    size_t luma = (size_t)width * height, chroma = luma / 4;
+    if (source_->is_replay()) {
+        pattern_.clear();
+        xmap_.resize(width);
+        ymap_.resize(height);
+        for (int x = 0; x < width; x++)
+            xmap_[x] = (int)((int64_t)x * source_->width() / width);
+        for (int y = 0; y < height; y++)
+            ymap_[y] = (int)((int64_t)y * source_->height() / height);
+    } else {
+        /* Bars over the top three quarters, a grey ramp below */
+        pattern_.resize(luma + 2 * chroma);
+        uint8_t *py = pattern_.data();
+        uint8_t *pu = py + luma, *pv = pu + chroma;
+        int ramp_top = height * 3 / 4 & ~1;
+        uint32_t seed = 0x2545f491;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int v = y < ramp_top ? k_bars[x * 8 / width][0] : 16 + x * 219 / width;
+                seed = seed * 1664525 + 1013904223;
+                v += (int)(seed >> 24) % (2 * GRAIN_AMPLITUDE + 1) - GRAIN_AMPLITUDE;
+                py[(size_t)y * width + x] = (uint8_t)std::clamp(v, 16, 235);
+            }
+        }
+        for (int y = 0; y < height / 2; y++) {
+            for (int x = 0; x < width / 2; x++) {
+                bool bars = 2 * y < ramp_top;
+                pu[(size_t)y * (width / 2) + x] = bars ? k_bars[2 * x * 8 / width][1] : 128;
+                pv[(size_t)y * (width / 2) + x] = bars ? k_bars[2 * x * 8 / width][2] : 128;
+            }
+        }
+    }
+    if (format == RPI_FMT_YUV420)
+        work_.clear();
+    else
+        work_.resize(luma + 2 * chroma);
+    return 0;
+}
+
+/* Exposure scales the scene, then brightness and contrast act around mid grey */
+void StreamRenderer::build_lut(const Look &look)
+{
+    for (int v = 0; v < 256; v++) {
+        float lin = v * look.scale;
+        float out = (lin - 128.0f) * look.contrast + 128.0f + look.brightness * 128.0f;
+        lut_[v] = (uint8_t)std::clamp(std::lround(out), 0L, 255L);
+    }
+    lut_look_ = look;
+    lut_valid_ = true;
+}
+
+void StreamRenderer::describe(rpi_frame_t &frame, rpi_format_t format, uint8_t *data,
+                              uint32_t stride) const
+{
+    memset(&frame, 0, sizeof(frame));
+    frame.data = data;
+    frame.width = width_;
+    frame.height = height_;
+    frame.format = format;
+
+    size_t luma = (size_t)stride * height_;
+    frame.planes[0].data = data;
+    frame.planes[0].stride = stride;
+    frame.planes[0].size = luma;
+    frame.num_planes = 1;
+    if (format == RPI_FMT_YUV420) {
+        for (int i = 1; i < 3; i++) {
+            rpi_plane_t &p = frame.planes[i];
+            p.stride = stride / 2;
+            p.size = (size_t)p.stride * (height_ / 2);
+            p.offset = luma + (i - 1) * p.size;
+            p.data = data + p.offset;
+        }
+        frame.num_planes = 3;
+    } else if (format == RPI_FMT_NV12) {
+        rpi_plane_t &p = frame.planes[1];
+        p.stride = stride;
+        p.size = luma / 2;
+        p.offset = luma;
+        p.data = data + luma;
+        frame.num_planes = 2;
+    }
+    const rpi_plane_t &last = frame.planes[frame.num_planes - 1];
+    frame.size = last.offset + last.size;
+}
+
+void StreamRenderer::draw_luma(const rpi_frame_t &work, uint32_t sequence)
+{
+    const rpi_plane_t &dst = work.planes[0];
+    if (!source_->is_replay()) {
+        for (int y = 0; y < height_; y++) {
+            const uint8_t *s = pattern_.data() + (size_t)y * width_;
+            uint8_t *d = (uint8_t *)dst.data + (size_t)y * dst.stride;
+            for (int x = 0; x < width_; x++)
+                d[x] = lut_[s[x]];
+        }
+        return;
+    }
+
+    const uint8_t *frame = source_->frame(sequence);
+    int sw = source_->width();
+    for (int y = 0; y < height_; y++) {
+        const uint8_t *s = frame + (size_t)ymap_[y] * sw;
+        uint8_t *d = (uint8_t *)dst.data + (size_t)y * dst.stride;
+        for (int x = 0; x < width_; x++)
+            d[x] = lut_[s[xmap_[x]]];
+    }
+}
+
+void StreamRenderer::draw_chroma(const rpi_frame_t &work, uint32_t sequence)
+{
+    int cw = width_ / 2, ch = height_ / 2;
+    for (int i = 1; i < 3; i++) {
+        const rpi_plane_t &dst = work.planes[i];
+        if (!source_->is_replay()) {
+            const uint8_t *plane = pattern_.data() + (size_t)width_ * height_ +
+                                   (size_t)(i - 1) * cw * ch;
+            for (int y = 0; y < ch; y++)
+                memcpy((uint8_t *)dst.data + (size_t)y * dst.stride, plane + (size_t)y * cw, cw);
+            continue;
+        }
+
+        int sw = source_->width(), sh = source_->height();
+        const uint8_t *plane = source_->frame(sequence) + (size_t)sw * sh +
+                               (size_t)(i - 1) * (sw / 2) * (sh / 2);
+        for (int y = 0; y < ch; y++) {
+            const uint8_t *s = plane + (size_t)(ymap_[2 * y] / 2) * (sw / 2);
+            uint8_t *d = (uint8_t *)dst.data + (size_t)y * dst.stride;
+            for (int x = 0; x < cw; x++)
+                d[x] = s[xmap_[2 * x] / 2];
+        }
+    }
+}
+
+/* A white block bouncing left and right, so consecutive frames differ */
+void StreamRenderer::draw_block(const rpi_frame_t &work, uint32_t sequence)
+{
+    int size = std::max(2, height_ / 6) & ~1;
+    int travel = std::max(2, width_ - size) & ~1;
+    int phase = (int)(sequence % (2 * BLOCK_CROSSING_FRAMES));
+    int pos = phase < BLOCK_CROSSING_FRAMES ? phase : 2 * BLOCK_CROSSING_FRAMES - phase;
+    int x0 = pos * travel / BLOCK_CROSSING_FRAMES & ~1;
+    int y0 = (height_ * 3 / 8 - size / 2) & ~1;
+    size = std::min(size, width_ - x0);
+
+    for (int y = y0; y < y0 + size; y++)
+        memset((uint8_t *)work.planes[0].data + (size_t)y * work.planes[0].stride + x0, lut_[235],
+               size);
+    for (int i = 1; i < 3; i++) {
+        for (int y = y0 / 2; y < (y0 + size) / 2; y++)
+            memset((uint8_t *)work.planes[i].data + (size_t)y * work.planes[i].stride + x0 / 2,
+                   128, size / 2);
+    }
+}
+
+void StreamRenderer::pack_yuyv(const rpi_frame_t &work, uint8_t *dst) const
+{
+    for (int y = 0; y < height_; y++) {
+        const uint8_t *py = (const uint8_t *)work.planes[0].data + (size_t)y * work.planes[0].stride;
+        const uint8_t *pu = (const uint8_t *)work.planes[1].data + (size_t)(y / 2) * work.planes[1].stride;
+        const uint8_t *pv = (const uint8_t *)work.planes[2].data + (size_t)(y / 2) * work.planes[2].stride;
+        uint8_t *d = dst + (size_t)y * stride_;
+        for (int x = 0; x < width_ / 2; x++) {
+            d[4 * x] = py[2 * x];
+            d[4 * x + 1] = pu[x];
+            d[4 * x + 2] = py[2 * x + 1];
+            d[4 * x + 3] = pv[x];
+        }
+    }
+}
+
+/* A grey scene: every Bayer site carries the luma, widened to 10 or 12 bits
+ * and packed the CSI-2 way */
+void StreamRenderer::pack_raw(const rpi_frame_t &work, uint8_t *dst) const
+{
+    bool raw10 = format_ == RPI_FMT_RAW10;
+    int group = raw10 ? 4 : 2;
+    for (int y = 0; y < height_; y++) {
+        const uint8_t *py = (const uint8_t *)work.planes[0].data + (size_t)y * work.planes[0].stride;
+        uint8_t *d = dst + (size_t)y * stride_;
+        for (int x = 0; x < width_; x += group, d += group + 1) {
+            uint8_t low = 0;
+            for (int k = 0; k < group; k++) {
+                uint8_t v = x + k < width_ ? py[x + k] : 0;
+                d[k] = v;
+                low |= raw10 ? (v >> 6) << (2 * k) : (v >> 4) << (4 * k);
+            }
+            d[group] = low;
+        }
+    }
+}
+
+float StreamRenderer::render(uint32_t sequence, const Look &look, uint8_t *dst)
+{
+    if (!lut_valid_ || !(look == lut_look_))
+        build_lut(look);
+
+    /* YUV420 streams are drawn in place, the rest from a YUV420 frame */
+    rpi_frame_t work;
+    if (format_ == RPI_FMT_YUV420)
+        describe(work, RPI_FMT_YUV420, dst, stride_);
+    else
+        describe(work, RPI_FMT_YUV420, work_.data(), width_);
+
+    draw_luma(work, sequence);
+    draw_chroma(work, sequence);
+    if (!source_->is_replay())
+        draw_block(work, sequence);
+
+    uint64_t sum = 0, samples = 0;
+    for (int y = 0; y < height_; y += 8) {
+        const uint8_t *row = (const uint8_t *)work.planes[0].data + (size_t)y * work.planes[0].stride;
+        for (int x = 0; x < width_; x += 8, samples++)
+            sum += row[x];
+    }
+
+    switch (format_) {
+        case RPI_FMT_NV12:
+        case RPI_FMT_RGB888: {
+            rpi_frame_t out;
+            describe(out, format_, dst, stride_);
+            pixconv_convert(&work, &out, matrix_);
+            break;
+        }
+        case RPI_FMT_YUYV:
+            pack_yuyv(work, dst);
+            break;
+        case RPI_FMT_RAW10:
+        case RPI_FMT_RAW12:
+            pack_raw(work, dst);
+            break;
+        default:
+            break;
+    }
+    return samples ? (float)sum / samples : 0.0f;
+}
+
+} // namespace synthetic
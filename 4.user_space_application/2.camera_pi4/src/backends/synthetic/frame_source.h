@@ -0,0 +1,96 @@
+// frame_source.h - Images the synthetic camera outputs
+#ifndef SYNTHETIC_FRAME_SOURCE_H
+#define SYNTHETIC_FRAME_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rpi_camera.h"
+#include "pixel_convert.h"
+
+namespace synthetic {
+
+/* What the sensor looks at: colour bars with a block moving across them,
+ * or the frames of a raw YUV420 file played in a loop */
+class FrameSource {
+public:
+    ~FrameSource();
+
+    /* 'spec' is "pattern" or the path of a YUV420 file holding frames of
+     * width x height. Returns null if the file cannot be used. */
+    static std::shared_ptr<FrameSource> open(const std::string &spec, int width, int height);
+
+    bool is_replay() const { return map_ != nullptr; }
+    const std::string &name() const { return name_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    /* Replay only: tightly packed YUV420 frame, looping over the file */
+    const uint8_t *frame(uint32_t index) const;
+
+private:
+    FrameSource() = default;
+
+    std::string name_;
+    int width_ = 0;
+    int height_ = 0;
+    const uint8_t *map_ = nullptr;
+    size_t map_size_ = 0;
+    size_t frame_size_ = 0;
+    uint32_t frame_count_ = 0;
+};
+
+/* Settings the synthetic sensor and ISP apply to one frame */
+struct Look {
+    float scale = 1.0f;      /* exposure x gain over the nominal 10 ms at x1 */
+    float brightness = 0.0f; /* -1..1, 0 = unchanged */
+    float contrast = 1.0f;   /* 1 = unchanged */
+
+    bool operator==(const Look &o) const
+    {
+        return scale == o.scale && brightness == o.brightness && contrast == o.contrast;
+    }
+};
+
+/* Draws a source into the buffers of one stream. Everything a frame needs
+ * is allocated by configure(), so render() never allocates. */
+class StreamRenderer {
+public:
+    /* 'format' is the stream's layout: YUV420, NV12, YUYV, RGB888, RAW10 or
+     * RAW12, rows 'stride' bytes apart */
+    int configure(std::shared_ptr<const FrameSource> source, rpi_format_t format, int width,
+                  int height, uint32_t stride, pixconv_matrix_t matrix);
+
+    /* Draw frame 'sequence' into 'dst'; returns the mean luma (0..255) */
+    float render(uint32_t sequence, const Look &look, uint8_t *dst);
+
+private:
+    void build_lut(const Look &look);
+    void draw_luma(const rpi_frame_t &work, uint32_t sequence);
+    void draw_chroma(const rpi_frame_t &work, uint32_t sequence);
+    void draw_block(const rpi_frame_t &work, uint32_t sequence);
+    void describe(rpi_frame_t &frame, rpi_format_t format, uint8_t *data,
+                  uint32_t stride) const;
+    void pack_yuyv(const rpi_frame_t &work, uint8_t *dst) const;
+    void pack_raw(const rpi_frame_t &work, uint8_t *dst) const;
+
+    std::shared_ptr<const FrameSource> source_;
+    rpi_format_t format_ = RPI_FMT_YUV420;
+    int width_ = 0;
+    int height_ = 0;
+    uint32_t stride_ = 0;
+    pixconv_matrix_t matrix_ = PIXCONV_BT601;
+
+    std::vector<uint8_t> pattern_; /* YUV420 bars at the stream size */
+    std::vector<uint8_t> work_;    /* YUV420 frame before packing, unless
+                                    * the stream is YUV420 itself */
+    std::vector<int> xmap_, ymap_; /* replay: stream pixel -> source pixel */
+    uint8_t lut_[256];
+    Look lut_look_;
+    bool lut_valid_ = false;
+};
+
+} // namespace synthetic
+
+#endif // SYNTHETIC_FRAME_SOURCE_H
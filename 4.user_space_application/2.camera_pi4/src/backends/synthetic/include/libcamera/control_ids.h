@@ -0,0 +1,37 @@
+// control_ids.h - Controls the synthetic camera accepts or reports
+#ifndef SYNTHETIC_LIBCAMERA_CONTROL_IDS_H
+#define SYNTHETIC_LIBCAMERA_CONTROL_IDS_H
+
+#include <libcamera/controls.h>
+
+namespace libcamera {
+namespace controls {
+
+enum {
+    AE_ENABLE = 1,
+    EXPOSURE_TIME,
+    ANALOGUE_GAIN,
+    BRIGHTNESS,
+    CONTRAST,
+    LUX,
+    COLOUR_TEMPERATURE,
+    SENSOR_TIMESTAMP,
+    FRAME_DURATION,
+    FRAME_DURATION_LIMITS,
+};
+
+extern const Control<bool> AeEnable;
+extern const Control<int32_t> ExposureTime;
+extern const Control<float> AnalogueGain;
+extern const Control<float> Brightness;
+extern const Control<float> Contrast;
+extern const Control<float> Lux;
+extern const Control<int32_t> ColourTemperature;
+extern const Control<int64_t> SensorTimestamp;
+extern const Control<int64_t> FrameDuration;
+extern const Control<Span<const int64_t, 2>> FrameDurationLimits;
+
+} // namespace controls
+} // namespace libcamera
+
+#endif // SYNTHETIC_LIBCAMERA_CONTROL_IDS_H
@@ -0,0 +1,188 @@
+// controls.h - Control values, ids and lists of the synthetic libcamera
+//
+// Same names and semantics as the libcamera classes rpi_camera.cpp uses, so
+// the wrapper compiles against either. A ControlValue holds one typed value
+// (or an int64 array); reading it as another type gives a default value.
+#ifndef SYNTHETIC_LIBCAMERA_CONTROLS_H
+#define SYNTHETIC_LIBCAMERA_CONTROLS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace libcamera {
+
+static constexpr size_t dynamic_extent = SIZE_MAX;
+
+/* View of contiguous elements, as libcamera::Span */
+template <typename T, size_t Extent = dynamic_extent>
+class Span {
+    struct NoArray {};
+    using Array = std::conditional_t<Extent == dynamic_extent, NoArray,
+                                     std::array<std::remove_const_t<T>, Extent>>;
+
+public:
+    constexpr Span() = default;
+    constexpr Span(T *data, size_t size) : data_(data), size_(size) {}
+    constexpr Span(const Array &a) : data_(a.data()), size_(Extent) {}
+    template <typename C, typename = decltype(std::declval<C &>().data())>
+    constexpr Span(C &c) : data_(c.data()), size_(c.size()) {}
+
+    constexpr T *data() const { return data_; }
+    constexpr size_t size() const { return size_; }
+    constexpr bool empty() const { return size_ == 0; }
+    constexpr T *begin() const { return data_; }
+    constexpr T *end() const { return data_ + size_; }
+    constexpr T &operator[](size_t i) const { return data_[i]; }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+struct Size {
+    Size() = default;
+    Size(unsigned int w, unsigned int h) : width(w), height(h) {}
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    bool isNull() const { return !width && !height; }
+    std::string toString() const
+    {
+        return std::to_string(width) + "x" + std::to_string(height);
+    }
+};
+
+class ControlValue {
+public:
+    ControlValue() = default;
+    ControlValue(bool v) : v_(v) {}
+    ControlValue(int32_t v) : v_(v) {}
+    ControlValue(int64_t v) : v_(v) {}
+    ControlValue(float v) : v_(v) {}
+    ControlValue(const std::string &v) : v_(v) {}
+    ControlValue(const Size &v) : v_(v) {}
+    template <size_t E>
+    ControlValue(Span<const int64_t, E> v) : v_(std::vector<int64_t>(v.begin(), v.end())) {}
+
+    bool isNone() const { return v_.index() == 0; }
+    bool isArray() const { return std::holds_alternative<std::vector<int64_t>>(v_); }
+
+    template <typename T>
+    T get() const
+    {
+        if constexpr (IsSpan<T>::value) {
+            const auto *a = std::get_if<std::vector<int64_t>>(&v_);
+            return a ? T(a->data(), a->size()) : T();
+        } else {
+            const T *v = std::get_if<T>(&v_);
+            return v ? *v : T();
+        }
+    }
+
+private:
+    template <typename T> struct IsSpan : std::false_type {};
+    template <typename T, size_t E> struct IsSpan<Span<T, E>> : std::true_type {};
+
+    std::variant<std::monostate, bool, int32_t, int64_t, float, std::string, Size,
+                 std::vector<int64_t>> v_;
+};
+
+class ControlId {
+public:
+    ControlId(unsigned int id, const char *name) : id_(id), name_(name) {}
+
+    unsigned int id() const { return id_; }
+    const std::string &name() const { return name_; }
+
+private:
+    unsigned int id_;
+    std::string name_;
+};
+
+template <typename T>
+class Control : public ControlId {
+public:
+    using type = T;
+    Control(unsigned int id, const char *name) : ControlId(id, name) {}
+};
+
+class ControlInfo {
+public:
+    ControlInfo() = default;
+    ControlInfo(const ControlValue &min, const ControlValue &max,
+                const ControlValue &def = ControlValue())
+        : min_(min), max_(max), def_(def) {}
+
+    const ControlValue &min() const { return min_; }
+    const ControlValue &max() const { return max_; }
+    const ControlValue &def() const { return def_; }
+
+private:
+    ControlValue min_, max_, def_;
+};
+
+/* Ranges a camera accepts, keyed by control */
+class ControlInfoMap : public std::map<const ControlId *, ControlInfo> {};
+
+/* A handful of controls per request: a flat list that keeps its storage
+ * across clear(), so a reused request does not allocate */
+class ControlList {
+public:
+    template <typename T, typename V>
+    void set(const Control<T> &ctrl, const V &value)
+    {
+        ControlValue v(static_cast<T>(value));
+        for (auto &entry : values_) {
+            if (entry.first == ctrl.id()) {
+                entry.second = v;
+                return;
+            }
+        }
+        values_.emplace_back(ctrl.id(), v);
+    }
+
+    template <typename T>
+    std::optional<T> get(const Control<T> &ctrl) const
+    {
+        for (const auto &entry : values_) {
+            if (entry.first == ctrl.id())
+                return entry.second.template get<T>();
+        }
+        return std::nullopt;
+    }
+
+    bool contains(unsigned int id) const
+    {
+        for (const auto &entry : values_) {
+            if (entry.first == id)
+                return true;
+        }
+        return false;
+    }
+    bool empty() const { return values_.empty(); }
+    size_t size() const { return values_.size(); }
+    void clear() { values_.clear(); }
+    /* Add the controls of 'other' this list does not have yet */
+    void merge(const ControlList &other)
+    {
+        for (const auto &entry : other.values_) {
+            if (!contains(entry.first))
+                values_.push_back(entry);
+        }
+    }
+
+private:
+    std::vector<std::pair<unsigned int, ControlValue>> values_;
+};
+
+} // namespace libcamera
+
+#endif // SYNTHETIC_LIBCAMERA_CONTROLS_H
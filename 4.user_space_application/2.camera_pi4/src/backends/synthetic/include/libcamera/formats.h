@@ -0,0 +1,70 @@
+// formats.h - Pixel formats of the synthetic libcamera
+//
+// DRM fourccs as in libcamera; the packed CSI-2 Bayer formats carry the
+// MIPI packed modifier.
+#ifndef SYNTHETIC_LIBCAMERA_FORMATS_H
+#define SYNTHETIC_LIBCAMERA_FORMATS_H
+
+#include <cstdint>
+#include <string>
+
+namespace libcamera {
+
+class PixelFormat {
+public:
+    constexpr PixelFormat() = default;
+    explicit constexpr PixelFormat(uint32_t fourcc, uint64_t modifier = 0)
+        : fourcc_(fourcc), modifier_(modifier) {}
+
+    bool operator==(const PixelFormat &o) const
+    {
+        return fourcc_ == o.fourcc_ && modifier_ == o.modifier_;
+    }
+    bool operator!=(const PixelFormat &o) const { return !(*this == o); }
+    bool operator<(const PixelFormat &o) const
+    {
+        return fourcc_ < o.fourcc_ || (fourcc_ == o.fourcc_ && modifier_ < o.modifier_);
+    }
+
+    constexpr bool isValid() const { return fourcc_ != 0; }
+    constexpr uint32_t fourcc() const { return fourcc_; }
+    constexpr uint64_t modifier() const { return modifier_; }
+    /* libcamera name, e.g. "YUV420" or "SBGGR10_CSI2P" */
+    std::string toString() const;
+
+private:
+    uint32_t fourcc_ = 0;
+    uint64_t modifier_ = 0;
+};
+
+namespace formats {
+
+constexpr uint32_t fourcc(char a, char b, char c, char d)
+{
+    return (uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24;
+}
+constexpr uint64_t kCsi2Packed = (uint64_t)0x0b << 56 | 1; /* MIPI_FORMAT_MOD_CSI2_PACKED */
+
+constexpr PixelFormat R8{ fourcc('R', '8', ' ', ' ') };
+constexpr PixelFormat YUV420{ fourcc('Y', 'U', '1', '2') };
+constexpr PixelFormat NV12{ fourcc('N', 'V', '1', '2') };
+constexpr PixelFormat NV21{ fourcc('N', 'V', '2', '1') };
+constexpr PixelFormat YUYV{ fourcc('Y', 'U', 'Y', 'V') };
+constexpr PixelFormat RGB888{ fourcc('R', 'G', '2', '4') };
+constexpr PixelFormat BGR888{ fourcc('B', 'G', '2', '4') };
+constexpr PixelFormat XRGB8888{ fourcc('X', 'R', '2', '4') };
+constexpr PixelFormat MJPEG{ fourcc('M', 'J', 'P', 'G') };
+constexpr PixelFormat SBGGR10_CSI2P{ fourcc('B', 'G', '1', '0'), kCsi2Packed };
+constexpr PixelFormat SGBRG10_CSI2P{ fourcc('G', 'B', '1', '0'), kCsi2Packed };
+constexpr PixelFormat SGRBG10_CSI2P{ fourcc('B', 'A', '1', '0'), kCsi2Packed };
+constexpr PixelFormat SRGGB10_CSI2P{ fourcc('R', 'G', '1', '0'), kCsi2Packed };
+constexpr PixelFormat SBGGR12_CSI2P{ fourcc('B', 'G', '1', '2'), kCsi2Packed };
+constexpr PixelFormat SGBRG12_CSI2P{ fourcc('G', 'B', '1', '2'), kCsi2Packed };
+constexpr PixelFormat SGRBG12_CSI2P{ fourcc('B', 'A', '1', '2'), kCsi2Packed };
+constexpr PixelFormat SRGGB12_CSI2P{ fourcc('R', 'G', '1', '2'), kCsi2Packed };
+
+} // namespace formats
+
+} // namespace libcamera
+
+#endif // SYNTHETIC_LIBCAMERA_FORMATS_H
@@ -0,0 +1,334 @@
+// libcamera.h - Synthetic stand-in for the libcamera API subset rpi_camera uses
+//
+// Built instead of libcamera with -DRPI_CAMERA_BACKEND=synthetic. The classes
+// keep libcamera's names and behaviour (requests cycle through queueRequest()
+// and requestCompleted, buffers are dmabuf-like fds mapped by the caller), so
+// rpi_camera.cpp is compiled unchanged. Frames come from a test pattern or a
+// raw YUV420 file, paced like a sensor; see synthetic_camera.cpp.
+#ifndef SYNTHETIC_LIBCAMERA_H
+#define SYNTHETIC_LIBCAMERA_H
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <libcamera/controls.h>
+#include <libcamera/control_ids.h>
+#include <libcamera/formats.h>
+#include <libcamera/property_ids.h>
+
+namespace libcamera {
+
+class Camera;
+class Request;
+class Stream;
+class SyntheticSensor;
+
+/* File descriptor shared by every copy; closed with the last one */
+class SharedFD {
+public:
+    SharedFD() = default;
+    explicit SharedFD(int &&fd);
+
+    int get() const { return fd_ ? *fd_ : -1; }
+    bool isValid() const { return fd_ != nullptr; }
+
+private:
+    std::shared_ptr<const int> fd_;
+};
+
+class Fence {};
+
+struct FrameMetadata {
+    enum Status { FrameSuccess, FrameError, FrameCancelled };
+    struct Plane {
+        unsigned int bytesused;
+    };
+
+    Status status = FrameSuccess;
+    unsigned int sequence = 0;
+    uint64_t timestamp = 0; /* CLOCK_MONOTONIC ns, start of the frame */
+
+    Span<Plane> planes() { return Span<Plane>(planes_.data(), planes_.size()); }
+    Span<const Plane> planes() const { return Span<const Plane>(planes_.data(), planes_.size()); }
+
+private:
+    friend class FrameBuffer;
+    friend class SyntheticSensor;
+    std::vector<Plane> planes_;
+};
+
+class FrameBuffer {
+public:
+    struct Plane {
+        static constexpr unsigned int kInvalidOffset = ~0u;
+        SharedFD fd;
+        unsigned int offset;
+        unsigned int length;
+    };
+
+    FrameBuffer(const std::vector<Plane> &planes, unsigned int cookie = 0);
+    virtual ~FrameBuffer() = default;
+
+    const std::vector<Plane> &planes() const { return planes_; }
+    const FrameMetadata &metadata() const { return metadata_; }
+    Request *request() const { return request_; }
+    uint64_t cookie() const { return cookie_; }
+    void setCookie(uint64_t cookie) { cookie_ = cookie; }
+
+private:
+    friend class Request;
+    friend class SyntheticSensor;
+
+    std::vector<Plane> planes_;
+    FrameMetadata metadata_;
+    Request *request_ = nullptr;
+    uint64_t cookie_;
+};
+
+class ColorSpace {
+public:
+    enum class Primaries { Raw, Smpte170m, Rec709, Rec2020 };
+    enum class TransferFunction { Linear, Srgb, Rec709 };
+    enum class YcbcrEncoding { None, Rec601, Rec709, Rec2020 };
+    enum class Range { Full, Limited };
+
+    constexpr ColorSpace(Primaries p, TransferFunction t, YcbcrEncoding e, Range r)
+        : primaries(p), transferFunction(t), ycbcrEncoding(e), range(r) {}
+
+    static const ColorSpace Raw;
+    static const ColorSpace Sycc;
+    static const ColorSpace Smpte170m;
+    static const ColorSpace Rec709;
+
+    Primaries primaries;
+    TransferFunction transferFunction;
+    YcbcrEncoding ycbcrEncoding;
+    Range range;
+
+    bool operator==(const ColorSpace &o) const
+    {
+        return primaries == o.primaries && transferFunction == o.transferFunction &&
+               ycbcrEncoding == o.ycbcrEncoding && range == o.range;
+    }
+    bool operator!=(const ColorSpace &o) const { return !(*this == o); }
+    std::string toString() const;
+};
+
+enum class StreamRole { Raw, StillCapture, VideoRecording, Viewfinder };
+
+class StreamFormats {
+public:
+    StreamFormats() = default;
+    explicit StreamFormats(const std::map<PixelFormat, std::vector<Size>> &formats)
+        : formats_(formats) {}
+
+    std::vector<PixelFormat> pixelformats() const;
+    std::vector<Size> sizes(const PixelFormat &pixelformat) const;
+
+private:
+    std::map<PixelFormat, std::vector<Size>> formats_;
+};
+
+struct StreamConfiguration {
+    StreamConfiguration() = default;
+    explicit StreamConfiguration(const StreamFormats &formats) : formats_(formats) {}
+
+    PixelFormat pixelFormat;
+    Size size;
+    unsigned int stride = 0;
+    unsigned int frameSize = 0;
+    unsigned int bufferCount = 0;
+    std::optional<ColorSpace> colorSpace;
+
+    Stream *stream() const { return stream_; }
+    const StreamFormats &formats() const { return formats_; }
+    std::string toString() const { return size.toString() + "-" + pixelFormat.toString(); }
+
+private:
+    friend class Camera;
+    Stream *stream_ = nullptr;
+    StreamFormats formats_;
+};
+
+class Stream {
+public:
+    const StreamConfiguration &configuration() const { return configuration_; }
+
+private:
+    friend class Camera;
+    StreamConfiguration configuration_;
+};
+
+class CameraConfiguration {
+public:
+    enum Status { Valid, Adjusted, Invalid };
+
+    /* Fit every stream to what the synthetic sensor can output */
+    Status validate();
+
+    void addConfiguration(const StreamConfiguration &cfg) { config_.push_back(cfg); }
+    StreamConfiguration &at(unsigned int index) { return config_[index]; }
+    const StreamConfiguration &at(unsigned int index) const { return config_[index]; }
+    size_t size() const { return config_.size(); }
+    bool empty() const { return config_.empty(); }
+
+private:
+    std::vector<StreamConfiguration> config_;
+};
+
+class Request {
+public:
+    enum Status { RequestPending, RequestComplete, RequestCancelled };
+    enum ReuseFlag { Default = 0, ReuseBuffers = 1 };
+    using BufferMap = std::map<const Stream *, FrameBuffer *>;
+
+    ~Request();
+
+    ControlList &controls() { return controls_; }
+    const ControlList &metadata() const { return metadata_; }
+    const BufferMap &buffers() const { return bufferMap_; }
+    int addBuffer(const Stream *stream, FrameBuffer *buffer,
+                  std::unique_ptr<Fence> fence = nullptr);
+    FrameBuffer *findBuffer(const Stream *stream) const;
+
+    uint32_t sequence() const { return sequence_; }
+    uint64_t cookie() const { return cookie_; }
+    Status status() const { return status_; }
+    bool hasPendingBuffers() const { return status_ == RequestPending && !bufferMap_.empty(); }
+
+    /* Make a completed request queueable again; keeps the buffers with
+     * ReuseBuffers, always drops controls and metadata */
+    void reuse(ReuseFlag flags = Default);
+
+private:
+    friend class Camera;
+    friend class SyntheticSensor;
+
+    Request(Camera *camera, uint64_t cookie) : camera_(camera), cookie_(cookie) {}
+
+    Camera *camera_;
+    uint64_t cookie_;
+    ControlList controls_;
+    ControlList metadata_;
+    BufferMap bufferMap_;
+    uint32_t sequence_ = 0;
+    Status status_ = RequestPending;
+};
+
+/* Connect before the camera starts; slots run on the emitting thread */
+template <typename... Args>
+class Signal {
+public:
+    template <typename R>
+    void connect(R (*func)(Args...))
+    {
+        slots_.push_back({ reinterpret_cast<const void *>(func),
+                           [func](Args... args) { func(args...); } });
+    }
+    template <typename T, typename R>
+    void connect(T *obj, R (T::*func)(Args...))
+    {
+        slots_.push_back({ obj, [obj, func](Args... args) { (obj->*func)(args...); } });
+    }
+
+    void disconnect() { slots_.clear(); }
+    template <typename T>
+    void disconnect(T *obj)
+    {
+        for (auto it = slots_.begin(); it != slots_.end();)
+            it = it->first == obj ? slots_.erase(it) : it + 1;
+    }
+    template <typename R>
+    void disconnect(R (*func)(Args...))
+    {
+        disconnect(reinterpret_cast<const void *>(func));
+    }
+
+    void emit(Args... args)
+    {
+        for (auto &slot : slots_)
+            slot.second(args...);
+    }
+
+private:
+    std::vector<std::pair<const void *, std::function<void(Args...)>>> slots_;
+};
+
+class Camera {
+public:
+    ~Camera();
+
+    const std::string &id() const;
+    Signal<Request *> requestCompleted;
+
+    int acquire();
+    int release();
+
+    const ControlInfoMap &controls() const;
+    const ControlList &properties() const;
+
+    std::unique_ptr<CameraConfiguration> generateConfiguration(Span<const StreamRole> roles = {});
+    std::unique_ptr<CameraConfiguration> generateConfiguration(std::initializer_list<StreamRole> roles)
+    {
+        return generateConfiguration(Span<const StreamRole>(roles.begin(), roles.size()));
+    }
+    int configure(CameraConfiguration *config);
+
+    std::unique_ptr<Request> createRequest(uint64_t cookie = 0);
+    int queueRequest(Request *request);
+
+    int start(const ControlList *controls = nullptr);
+    int stop();
+
+private:
+    friend class CameraManager;
+    friend class FrameBufferAllocator;
+
+    explicit Camera(unsigned int index);
+
+    std::unique_ptr<SyntheticSensor> sensor_;
+    std::vector<std::unique_ptr<Stream>> streams_;
+};
+
+class CameraManager {
+public:
+    CameraManager() = default;
+    ~CameraManager();
+
+    /* Creates the synthetic cameras, RPI_CAMERA_COUNT of them (default 1) */
+    int start();
+    void stop();
+
+    std::vector<std::shared_ptr<Camera>> cameras() const { return cameras_; }
+    std::shared_ptr<Camera> get(const std::string &id);
+    static const std::string &version();
+
+private:
+    std::vector<std::shared_ptr<Camera>> cameras_;
+};
+
+/* Buffers backed by memfds, one per request, sized from the stream's
+ * negotiated stride and height */
+class FrameBufferAllocator {
+public:
+    explicit FrameBufferAllocator(std::shared_ptr<Camera> camera) : camera_(std::move(camera)) {}
+
+    int allocate(Stream *stream);
+    int free(Stream *stream);
+    bool allocated() const { return !buffers_.empty(); }
+    const std::vector<std::unique_ptr<FrameBuffer>> &buffers(Stream *stream) const;
+
+private:
+    std::shared_ptr<Camera> camera_;
+    std::map<const Stream *, std::vector<std::unique_ptr<FrameBuffer>>> buffers_;
+};
+
+} // namespace libcamera
+
+#endif // SYNTHETIC_LIBCAMERA_H
@@ -0,0 +1,21 @@
+// property_ids.h - Properties of a synthetic camera
+#ifndef SYNTHETIC_LIBCAMERA_PROPERTY_IDS_H
+#define SYNTHETIC_LIBCAMERA_PROPERTY_IDS_H
+
+#include <libcamera/controls.h>
+
+namespace libcamera {
+namespace properties {
+
+enum {
+    MODEL = 1,
+    PIXEL_ARRAY_SIZE,
+};
+
+extern const Control<std::string> Model;
+extern const Control<Size> PixelArraySize;
+
+} // namespace properties
+} // namespace libcamera
+
+#endif // SYNTHETIC_LIBCAMERA_PROPERTY_IDS_H
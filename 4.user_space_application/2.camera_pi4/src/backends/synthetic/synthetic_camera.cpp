@@ -0,0 +1,948 @@
+// ============================================================================
+// synthetic_camera.cpp - libcamera stand-in backed by a simulated sensor
+// ============================================================================
+//
+// Each camera runs a sensor thread that ticks once per frame duration. A
+// request queued before a tick is filled from the frame source and completes
+// one frame duration later; a tick with no request is a dropped frame and
+// shows up as a sequence gap, as on the real sensor. Exposure and gain reach
+// the sensor two frames after the request that carried them, brightness and
+// contrast (ISP controls) apply to that request's own frame.
+//
+// Environment, read when the CameraManager starts:
+//   RPI_CAMERA_SOURCE       "pattern" (default) or a raw YUV420 file to loop
+//   RPI_CAMERA_REPLAY_SIZE  frame size of that file, default 640x480
+//   RPI_CAMERA_FPS          frame rate without FrameDurationLimits, default 30
+//   RPI_CAMERA_COUNT        cameras to expose, default 1
+
+#include <libcamera/libcamera.h>
+#include "frame_source.h"
+#include "log.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace libcamera {
+
+namespace controls {
+const Control<bool> AeEnable(AE_ENABLE, "AeEnable");
+const Control<int32_t> ExposureTime(EXPOSURE_TIME, "ExposureTime");
+const Control<float> AnalogueGain(ANALOGUE_GAIN, "AnalogueGain");
+const Control<float> Brightness(BRIGHTNESS, "Brightness");
+const Control<float> Contrast(CONTRAST, "Contrast");
+const Control<float> Lux(LUX, "Lux");
+const Control<int32_t> ColourTemperature(COLOUR_TEMPERATURE, "ColourTemperature");
+const Control<int64_t> SensorTimestamp(SENSOR_TIMESTAMP, "SensorTimestamp");
+const Control<int64_t> FrameDuration(FRAME_DURATION, "FrameDuration");
+const Control<Span<const int64_t, 2>> FrameDurationLimits(FRAME_DURATION_LIMITS,
+                                                          "FrameDurationLimits");
+} // namespace controls
+
+namespace properties {
+const Control<std::string> Model(MODEL, "Model");
+const Control<Size> PixelArraySize(PIXEL_ARRAY_SIZE, "PixelArraySize");
+} // namespace properties
+
+/* Sensor limits */
+static const Size k_max_size(4056, 3040);
+static const Size k_min_size(64, 64);
+static const unsigned int k_stride_align = 64;
+static const unsigned int k_max_buffers = 32;
+static const int64_t k_line_ns = 10000;      /* exposure steps in whole lines */
+static const int64_t k_min_blank_lines = 4;  /* exposure <= frame length - this */
+static const int k_sensor_delay = 2;         /* frames until exposure/gain apply */
+static const uint32_t k_startup_frames = 2;  /* dropped while AE/AWB settle,
+                                               * first start after configure only */
+static const int32_t k_nominal_exposure_us = 10000;
+static const int32_t k_colour_temperature = 5000;
+static const float k_nominal_lux = 400.0f;
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int align_up(unsigned int v, unsigned int a)
+{
+    return (v + a - 1) / a * a;
+}
+
+// ============================================================================
+// Formats, colour spaces, small value types
+// ============================================================================
+namespace {
+
+struct FormatInfo {
+    PixelFormat format;
+    const char *name;
+    rpi_format_t layout;
+    bool raw;
+};
+
+const FormatInfo k_formats[] = {
+    { formats::YUV420, "YUV420", RPI_FMT_YUV420, false },
+    { formats::NV12, "NV12", RPI_FMT_NV12, false },
+    { formats::YUYV, "YUYV", RPI_FMT_YUYV, false },
+    { formats::RGB888, "RGB888", RPI_FMT_RGB888, false },
+    { formats::SBGGR10_CSI2P, "SBGGR10_CSI2P", RPI_FMT_RAW10, true },
+    { formats::SBGGR12_CSI2P, "SBGGR12_CSI2P", RPI_FMT_RAW12, true },
+};
+
+/* Names of formats the sensor does not output, for toString() */
+const std::pair<PixelFormat, const char *> k_other_names[] = {
+    { formats::R8, "R8" },
+    { formats::NV21, "NV21" },
+    { formats::BGR888, "BGR888" },
+    { formats::XRGB8888, "XRGB8888" },
+    { formats::MJPEG, "MJPEG" },
+    { formats::SGBRG10_CSI2P, "SGBRG10_CSI2P" },
+    { formats::SGRBG10_CSI2P, "SGRBG10_CSI2P" },
+    { formats::SRGGB10_CSI2P, "SRGGB10_CSI2P" },
+    { formats::SGBRG12_CSI2P, "SGBRG12_CSI2P" },
+    { formats::SGRBG12_CSI2P, "SGRBG12_CSI2P" },
+    { formats::SRGGB12_CSI2P, "SRGGB12_CSI2P" },
+};
+
+const FormatInfo *format_info(const PixelFormat &pf)
+{
+    for (const FormatInfo &f : k_formats) {
+        if (f.format == pf)
+            return &f;
+    }
+    return nullptr;
+}
+
+bool is_raw(const PixelFormat &pf)
+{
+    const FormatInfo *f = format_info(pf);
+    return f ? f->raw : pf.modifier() == formats::kCsi2Packed;
+}
+
+/* Bytes of one row of image data, before stride alignment */
+unsigned int row_bytes(rpi_format_t layout, unsigned int width)
+{
+    switch (layout) {
+        case RPI_FMT_YUYV:   return width * 2;
+        case RPI_FMT_RGB888: return width * 3;
+        case RPI_FMT_RAW10:  return (width + 3) / 4 * 5;
+        case RPI_FMT_RAW12:  return (width + 1) / 2 * 3;
+        default:             return width;
+    }
+}
+
+/* Image planes of a buffer: offsets and lengths from stride and height */
+unsigned int plane_sizes(rpi_format_t layout, unsigned int stride, unsigned int height,
+                         unsigned int sizes[3])
+{
+    unsigned int luma = stride * height;
+    switch (layout) {
+        case RPI_FMT_YUV420:
+            sizes[0] = luma;
+            sizes[1] = sizes[2] = stride / 2 * (height / 2);
+            return 3;
+        case RPI_FMT_NV12:
+            sizes[0] = luma;
+            sizes[1] = stride * (height / 2);
+            return 2;
+        default:
+            sizes[0] = luma;
+            return 1;
+    }
+}
+
+StreamFormats stream_formats(bool raw)
+{
+    std::map<PixelFormat, std::vector<Size>> m;
+    for (const FormatInfo &f : k_formats) {
+        if (f.raw == raw)
+            m[f.format] = { k_min_size, k_max_size };
+    }
+    return StreamFormats(m);
+}
+
+} // namespace
+
+std::string PixelFormat::toString() const
+{
+    if (const FormatInfo *f = format_info(*this))
+        return f->name;
+    for (const auto &n : k_other_names) {
+        if (n.first == *this)
+            return n.second;
+    }
+    char s[5] = { (char)(fourcc_ & 0xff), (char)(fourcc_ >> 8 & 0xff),
+                  (char)(fourcc_ >> 16 & 0xff), (char)(fourcc_ >> 24 & 0xff), 0 };
+    return s;
+}
+
+const ColorSpace ColorSpace::Raw(Primaries::Raw, TransferFunction::Linear,
+                                 YcbcrEncoding::None, Range::Full);
+const ColorSpace ColorSpace::Sycc(Primaries::Rec709, TransferFunction::Srgb,
+                                  YcbcrEncoding::Rec601, Range::Full);
+const ColorSpace ColorSpace::Smpte170m(Primaries::Smpte170m, TransferFunction::Rec709,
+                                       YcbcrEncoding::Rec601, Range::Limited);
+const ColorSpace ColorSpace::Rec709(Primaries::Rec709, TransferFunction::Rec709,
+                                    YcbcrEncoding::Rec709, Range::Limited);
+
+std::string ColorSpace::toString() const
+{
+    if (*this == Raw) return "RAW";
+    if (*this == Sycc) return "sYCC";
+    if (*this == Smpte170m) return "SMPTE170M";
+    if (*this == Rec709) return "Rec709";
+    return "Custom";
+}
+
+std::vector<PixelFormat> StreamFormats::pixelformats() const
+{
+    std::vector<PixelFormat> v;
+    for (const auto &f : formats_)
+        v.push_back(f.first);
+    return v;
+}
+
+std::vector<Size> StreamFormats::sizes(const PixelFormat &pixelformat) const
+{
+    auto it = formats_.find(pixelformat);
+    return it == formats_.end() ? std::vector<Size>() : it->second;
+}
+
+SharedFD::SharedFD(int &&fd)
+{
+    if (fd >= 0) {
+        fd_ = std::shared_ptr<const int>(new int(fd), [](const int *p) {
+            ::close(*p);
+            delete p;
+        });
+    }
+    fd = -1;
+}
+
+FrameBuffer::FrameBuffer(const std::vector<Plane> &planes, unsigned int cookie)
+    : planes_(planes), cookie_(cookie)
+{
+    metadata_.planes_.resize(planes.size());
+}
+
+// ============================================================================
+// Configuration
+// ============================================================================
+CameraConfiguration::Status CameraConfiguration::validate()
+{
+    /* As the Pi ISP: an optional raw stream first, then two outputs at most */
+    size_t outputs = config_.size() - (!config_.empty() && is_raw(config_[0].pixelFormat));
+    if (config_.empty() || outputs > 2)
+        return Invalid;
+
+    Status status = Valid;
+    auto adjust = [&](auto &field, auto value) {
+        if (field != value) {
+            field = value;
+            status = Adjusted;
+        }
+    };
+
+    for (size_t i = 0; i < config_.size(); i++) {
+        StreamConfiguration &sc = config_[i];
+
+        /* Only the first stream can be raw; the other is an ISP output */
+        bool raw = i == 0 && is_raw(sc.pixelFormat);
+        const FormatInfo *f = format_info(sc.pixelFormat);
+        if (raw && (!f || !f->raw)) {
+            /* Same depth in the sensor's Bayer order */
+            bool twelve = sc.pixelFormat.toString().find("12") != std::string::npos;
+            adjust(sc.pixelFormat, twelve ? formats::SBGGR12_CSI2P : formats::SBGGR10_CSI2P);
+        } else if (!raw && (!f || f->raw)) {
+            adjust(sc.pixelFormat, formats::YUV420);
+        }
+        f = format_info(sc.pixelFormat);
+
+        /* Even sizes within the sensor. The sensor mode fits the largest
+         * output, except that a raw first stream fixes it and the ISP
+         * cannot upscale past it. */
+        Size max = i > 0 && is_raw(config_[0].pixelFormat) ? config_[0].size : k_max_size;
+        adjust(sc.size.width, std::clamp(sc.size.width, k_min_size.width, max.width) & ~1u);
+        adjust(sc.size.height, std::clamp(sc.size.height, k_min_size.height, max.height) & ~1u);
+
+        unsigned int sizes[3];
+        unsigned int stride = align_up(row_bytes(f->layout, sc.size.width), k_stride_align);
+        unsigned int n = plane_sizes(f->layout, stride, sc.size.height, sizes);
+        unsigned int frame_size = 0;
+        for (unsigned int p = 0; p < n; p++)
+            frame_size += sizes[p];
+        sc.stride = stride;
+        sc.frameSize = frame_size;
+
+        if (!sc.bufferCount)
+            sc.bufferCount = 4;
+        adjust(sc.bufferCount, std::min(sc.bufferCount, k_max_buffers));
+
+        if (f->raw)
+            adjust(sc.colorSpace, std::optional<ColorSpace>(ColorSpace::Raw));
+        else if (!sc.colorSpace || (*sc.colorSpace != ColorSpace::Sycc &&
+                                    *sc.colorSpace != ColorSpace::Rec709))
+            adjust(sc.colorSpace, std::optional<ColorSpace>(ColorSpace::Smpte170m));
+    }
+    return status;
+}
+
+// ============================================================================
+// Requests
+// ============================================================================
+Request::~Request()
+{
+    for (auto &b : bufferMap_)
+        b.second->request_ = nullptr;
+}
+
+int Request::addBuffer(const Stream *stream, FrameBuffer *buffer, std::unique_ptr<Fence>)
+{
+    if (!stream || !buffer)
+        return -EINVAL;
+    if (bufferMap_.count(stream))
+        return -EEXIST;
+    bufferMap_[stream] = buffer;
+    buffer->request_ = this;
+    return 0;
+}
+
+FrameBuffer *Request::findBuffer(const Stream *stream) const
+{
+    auto it = bufferMap_.find(stream);
+    return it == bufferMap_.end() ? nullptr : it->second;
+}
+
+void Request::reuse(ReuseFlag flags)
+{
+    if (!(flags & ReuseBuffers)) {
+        for (auto &b : bufferMap_)
+            b.second->request_ = nullptr;
+        bufferMap_.clear();
+    }
+    controls_.clear();
+    metadata_.clear();
+    sequence_ = 0;
+    status_ = RequestPending;
+}
+
+// ============================================================================
+// Sensor
+// ============================================================================
+
+/* A buffer from FrameBufferAllocator: a memfd, also mapped for the sensor */
+class SyntheticFrameBuffer : public FrameBuffer {
+public:
+    SyntheticFrameBuffer(const std::vector<Plane> &planes, uint8_t *map, size_t length)
+        : FrameBuffer(planes), map_(map), length_(length) {}
+    ~SyntheticFrameBuffer() override { munmap(map_, length_); }
+
+    uint8_t *map() const { return map_; }
+
+private:
+    uint8_t *map_;
+    size_t length_;
+};
+
+class SyntheticSensor {
+public:
+    SyntheticSensor(Camera *camera, unsigned int index,
+                    std::shared_ptr<const synthetic::FrameSource> source, double fps);
+
+    Camera *camera;
+    std::string id;
+    ControlInfoMap control_info;
+    ControlList properties;
+    std::shared_ptr<const synthetic::FrameSource> source;
+
+    bool acquired = false;
+    bool configured = false;
+    bool settled = false; /* has streamed since configure() */
+    std::map<const Stream *, synthetic::StreamRenderer> renderers;
+
+    int start(const ControlList *controls);
+    void stop();
+    int queue(Request *request);
+
+private:
+    /* What the sensor and ISP are asked for; exposure 0 = automatic */
+    struct Settings {
+        bool ae_enable = true;
+        int32_t exposure_us = 0;
+        float gain = 0.0f;
+        float brightness = 0.0f;
+        float contrast = 1.0f;
+        int64_t duration_min_ns = 0;
+        int64_t duration_max_ns = 0;
+    };
+    /* Exposure and gain on their way to the sensor */
+    struct Pending {
+        uint32_t sequence;
+        int32_t exposure_us;
+        float gain;
+        bool valid;
+    };
+
+    void apply(const ControlList &controls);
+    void stage(uint32_t sequence);
+    int64_t frame_duration_ns() const;
+    void complete(Request *request, uint32_t sequence, uint64_t start_ns, int64_t duration_ns);
+    void run();
+
+    int64_t default_duration_ns_;
+    Settings settings_;
+    Pending pending_[k_sensor_delay + 2] = {};
+    int32_t exposure_us_ = k_nominal_exposure_us; /* in effect on the sensor */
+    float gain_ = 1.0f;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    std::vector<Request *> queue_; /* ring, grows only when more requests exist */
+    size_t head_ = 0, count_ = 0;
+    std::thread thread_;
+};
+
+SyntheticSensor::SyntheticSensor(Camera *cam, unsigned int index,
+                                 std::shared_ptr<const synthetic::FrameSource> src, double fps)
+    : camera(cam), source(std::move(src))
+{
+    id = "/base/synthetic/" + std::string(source->is_replay() ? "replay" : "pattern") + "@" +
+         std::to_string(index);
+    default_duration_ns_ = (int64_t)(1e9 / fps);
+
+    control_info[&controls::AeEnable] = ControlInfo(false, true, true);
+    control_info[&controls::ExposureTime] =
+        ControlInfo((int32_t)100, (int32_t)1000000, k_nominal_exposure_us);
+    control_info[&controls::AnalogueGain] = ControlInfo(1.0f, 16.0f, 1.0f);
+    control_info[&controls::Brightness] = ControlInfo(-1.0f, 1.0f, 0.0f);
+    control_info[&controls::Contrast] = ControlInfo(0.0f, 32.0f, 1.0f);
+    control_info[&controls::FrameDurationLimits] =
+        ControlInfo((int64_t)8333, (int64_t)1000000, default_duration_ns_ / 1000);
+
+    properties.set(properties::Model, source->is_replay() ? "synthetic-replay" : "synthetic");
+    properties.set(properties::PixelArraySize, k_max_size);
+}
+
+void SyntheticSensor::apply(const ControlList &c)
+{
+    if (auto v = c.get(controls::AeEnable)) {
+        settings_.ae_enable = *v;
+        if (*v)
+            settings_.exposure_us = 0, settings_.gain = 0.0f;
+    }
+    if (auto v = c.get(controls::ExposureTime))
+        settings_.exposure_us = std::clamp(*v, (int32_t)100, (int32_t)1000000);
+    if (auto v = c.get(controls::AnalogueGain))
+        settings_.gain = std::clamp(*v, 1.0f, 16.0f);
+    if (auto v = c.get(controls::Brightness))
+        settings_.brightness = std::clamp(*v, -1.0f, 1.0f);
+    if (auto v = c.get(controls::Contrast))
+        settings_.contrast = std::clamp(*v, 0.0f, 32.0f);
+    if (auto v = c.get(controls::FrameDurationLimits)) {
+        if (v->size() == 2) {
+            int64_t lo = std::clamp<int64_t>((*v)[0], 8333, 1000000) * 1000;
+            int64_t hi = std::clamp<int64_t>((*v)[1], 8333, 1000000) * 1000;
+            settings_.duration_min_ns = std::min(lo, hi);
+            settings_.duration_max_ns = std::max(lo, hi);
+        }
+    }
+}
+
+/* Send the requested exposure and gain to the sensor; they are in effect
+ * k_sensor_delay frames after 'sequence' */
+void SyntheticSensor::stage(uint32_t sequence)
+{
+    int32_t exposure = settings_.exposure_us;
+    float gain = settings_.gain;
+    if (!exposure && settings_.ae_enable)
+        exposure = k_nominal_exposure_us;
+    if (gain == 0.0f && settings_.ae_enable)
+        gain = 1.0f;
+
+    Pending &p = pending_[(sequence + k_sensor_delay) % (k_sensor_delay + 2)];
+    p.sequence = sequence + k_sensor_delay;
+    p.exposure_us = exposure ? exposure : exposure_us_;
+    p.gain = gain != 0.0f ? gain : gain_;
+    p.valid = true;
+
+    /* Adopt the latest values that have reached the sensor by this frame */
+    const Pending *latest = nullptr;
+    for (const Pending &q : pending_) {
+        if (q.valid && (int32_t)(sequence - q.sequence) >= 0 &&
+            (!latest || (int32_t)(q.sequence - latest->sequence) > 0))
+            latest = &q;
+    }
+    if (latest) {
+        exposure_us_ = latest->exposure_us;
+        gain_ = latest->gain;
+    }
+}
+
+/* Long enough for the exposure, within FrameDurationLimits */
+int64_t SyntheticSensor::frame_duration_ns() const
+{
+    int64_t lo = settings_.duration_min_ns ? settings_.duration_min_ns : default_duration_ns_;
+    int64_t hi = settings_.duration_max_ns ? settings_.duration_max_ns : default_duration_ns_;
+    int64_t needed = (int64_t)exposure_us_ * 1000 + k_min_blank_lines * k_line_ns;
+    return std::clamp(needed, lo, hi);
+}
+
+void SyntheticSensor::complete(Request *request, uint32_t sequence, uint64_t start_ns,
+                               int64_t duration_ns)
+{
+    /* The sensor cannot expose for longer than the frame, and only in lines */
+    int64_t exposure_ns = std::min<int64_t>((int64_t)exposure_us_ * 1000,
+                                            duration_ns - k_min_blank_lines * k_line_ns);
+    exposure_ns = std::max<int64_t>(k_line_ns, (exposure_ns + k_line_ns / 2) / k_line_ns * k_line_ns);
+    int32_t exposure_us = (int32_t)(exposure_ns / 1000);
+
+    synthetic::Look look;
+    look.scale = (float)exposure_us * gain_ / k_nominal_exposure_us;
+    look.brightness = settings_.brightness;
+    look.contrast = settings_.contrast;
+
+    float mean = 0.0f;
+    bool ok = true;
+    for (auto &entry : request->bufferMap_) {
+        FrameBuffer *buffer = entry.second;
+        auto *sb = dynamic_cast<SyntheticFrameBuffer *>(buffer);
+        auto it = renderers.find(entry.first);
+        if (!sb || it == renderers.end()) {
+            buffer->metadata_.status = FrameMetadata::FrameError;
+            ok = false;
+            continue;
+        }
+        float m = it->second.render(sequence, look, sb->map());
+        if (entry.first == request->bufferMap_.begin()->first)
+            mean = m;
+
+        FrameMetadata &md = buffer->metadata_;
+        md.status = FrameMetadata::FrameSuccess;
+        md.sequence = sequence;
+        md.timestamp = start_ns;
+        for (size_t i = 0; i < md.planes_.size(); i++)
+            md.planes_[i].bytesused = buffer->planes_[i].length;
+    }
+
+    /* What a light meter would make of this frame's exposure and level */
+    float lux = k_nominal_lux * (mean / 128.0f) / std::max(look.scale, 0.01f);
+    uint64_t boot_offset = clock_ns(CLOCK_BOOTTIME) - clock_ns(CLOCK_MONOTONIC);
+
+    ControlList &md = request->metadata_;
+    md.set(controls::ExposureTime, exposure_us);
+    md.set(controls::AnalogueGain, gain_);
+    md.set(controls::ColourTemperature, k_colour_temperature);
+    md.set(controls::Lux, lux);
+    md.set(controls::SensorTimestamp, (int64_t)(start_ns + boot_offset));
+    md.set(controls::FrameDuration, duration_ns / 1000);
+
+    request->sequence_ = sequence;
+    /* Like libcamera, a request with a failed buffer still completes; the
+     * buffer's own status says what went wrong */
+    if (!ok)
+        LOG_WARN_RATELIMIT(1000, "Synthetic frame %u: buffer not from FrameBufferAllocator",
+                           sequence);
+    request->status_ = Request::RequestComplete;
+    camera->requestCompleted.emit(request);
+}
+
+void SyntheticSensor::run()
+{
+    std::unique_lock<std::mutex> lk(mtx_);
+    /* Streaming starts with the first request */
+    cv_.wait(lk, [this] { return !running_ || count_ > 0; });
+
+    uint32_t sequence = 0;
+    uint64_t start_ns = clock_ns(CLOCK_MONOTONIC);
+    /* Like the Pi pipeline, the first frames after configure() never reach
+     * a request; a restart in the same mode keeps the converged AE/AWB */
+    uint32_t startup = settled ? 0 : k_startup_frames;
+    settled = true;
+    while (running_) {
+        /* The request waiting when the frame starts gets it; none = dropped */
+        Request *request = nullptr;
+        if (count_ && sequence >= startup) {
+            request = queue_[head_];
+            head_ = (head_ + 1) % queue_.size();
+            count_--;
+            apply(request->controls_);
+        }
+        stage(sequence);
+        int64_t duration_ns = frame_duration_ns();
+        uint64_t end_ns = start_ns + duration_ns;
+
+        auto deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(end_ns));
+        cv_.wait_until(lk, deadline, [this] { return !running_; });
+        if (!running_) {
+            /* Cancelled by stop() with the rest of the queue */
+            if (request) {
+                head_ = (head_ + queue_.size() - 1) % queue_.size();
+                queue_[head_] = request;
+                count_++;
+            }
+            break;
+        }
+
+        if (request) {
+            lk.unlock();
+            complete(request, sequence, start_ns, duration_ns);
+            lk.lock();
+        }
+
+        /* The sensor runs on its own clock: frames missed while this
+         * thread was late are gone */
+        sequence++;
+        start_ns = end_ns;
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        while (now >= start_ns + (uint64_t)duration_ns) {
+            start_ns += duration_ns;
+            sequence++;
+        }
+    }
+}
+
+int SyntheticSensor::start(const ControlList *controls)
+{
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (running_)
+        return -EBUSY;
+    if (controls)
+        apply(*controls);
+    for (auto &p : pending_)
+        p.valid = false;
+    if (settings_.exposure_us)
+        exposure_us_ = settings_.exposure_us;
+    if (settings_.gain != 0.0f)
+        gain_ = settings_.gain;
+
+    head_ = count_ = 0;
+    running_ = true;
+    thread_ = std::thread(&SyntheticSensor::run, this);
+    pthread_setname_np(thread_.native_handle(), "synthetic-sensor");
+    return 0;
+}
+
+void SyntheticSensor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_ && !thread_.joinable())
+            return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+
+    /* Everything still queued comes back cancelled, as libcamera does */
+    std::vector<Request *> cancelled;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (; count_; count_--, head_ = (head_ + 1) % queue_.size())
+            cancelled.push_back(queue_[head_]);
+    }
+    for (Request *request : cancelled) {
+        for (auto &entry : request->bufferMap_)
+            entry.second->metadata_.status = FrameMetadata::FrameCancelled;
+        request->status_ = Request::RequestCancelled;
+        camera->requestCompleted.emit(request);
+    }
+}
+
+int SyntheticSensor::queue(Request *request)
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!running_)
+            return -EACCES;
+        if (count_ == queue_.size()) {
+            /* First use, or more requests than ever before: unroll the ring */
+            std::vector<Request *> grown(std::max<size_t>(8, queue_.size() * 2));
+            for (size_t i = 0; i < count_; i++)
+                grown[i] = queue_[(head_ + i) % queue_.size()];
+            queue_.swap(grown);
+            head_ = 0;
+        }
+        queue_[(head_ + count_) % queue_.size()] = request;
+        count_++;
+    }
+    cv_.notify_all();
+    return 0;
+}
+
+// ============================================================================
+// Camera
+// ============================================================================
+Camera::Camera(unsigned int index)
+{
+    (void)index;
+}
+
+Camera::~Camera()
+{
+    if (sensor_)
+        sensor_->stop();
+}
+
+const std::string &Camera::id() const
+{
+    return sensor_->id;
+}
+
+int Camera::acquire()
+{
+    if (sensor_->acquired)
+        return -EBUSY;
+    sensor_->acquired = true;
+    return 0;
+}
+
+int Camera::release()
+{
+    sensor_->stop();
+    sensor_->acquired = false;
+    sensor_->configured = false;
+    return 0;
+}
+
+const ControlInfoMap &Camera::controls() const
+{
+    return sensor_->control_info;
+}
+
+const ControlList &Camera::properties() const
+{
+    return sensor_->properties;
+}
+
+std::unique_ptr<CameraConfiguration> Camera::generateConfiguration(Span<const StreamRole> roles)
+{
+    auto config = std::make_unique<CameraConfiguration>();
+    for (StreamRole role : roles) {
+        bool raw = role == StreamRole::Raw;
+        StreamConfiguration sc(stream_formats(raw));
+        switch (role) {
+            case StreamRole::Raw:
+                sc.pixelFormat = formats::SBGGR12_CSI2P;
+                sc.size = k_max_size;
+                sc.bufferCount = 2;
+                break;
+            case StreamRole::StillCapture:
+                sc.pixelFormat = formats::YUV420;
+                sc.size = k_max_size;
+                sc.bufferCount = 1;
+                break;
+            case StreamRole::VideoRecording:
+                sc.pixelFormat = formats::YUV420;
+                sc.size = Size(1920, 1080);
+                sc.bufferCount = 6; /* as the Pi pipeline: deeper than a consumer queue */
+                break;
+            case StreamRole::Viewfinder:
+                sc.pixelFormat = formats::YUV420;
+                sc.size = Size(800, 600);
+                sc.bufferCount = 4;
+                break;
+        }
+        config->addConfiguration(sc);
+    }
+    if (config->validate() == CameraConfiguration::Invalid)
+        return nullptr;
+    return config;
+}
+
+int Camera::configure(CameraConfiguration *config)
+{
+    if (!sensor_->acquired)
+        return -EACCES;
+    if (!config || config->validate() == CameraConfiguration::Invalid)
+        return -EINVAL;
+
+    sensor_->stop();
+    sensor_->renderers.clear();
+    streams_.clear();
+    for (size_t i = 0; i < config->size(); i++) {
+        StreamConfiguration &sc = config->at(i);
+        streams_.push_back(std::make_unique<Stream>());
+        Stream *stream = streams_.back().get();
+        sc.stream_ = stream;
+        stream->configuration_ = sc;
+
+        pixconv_matrix_t matrix = PIXCONV_BT601;
+        if (sc.colorSpace == ColorSpace::Rec709)
+            matrix = PIXCONV_BT709;
+        else if (sc.colorSpace == ColorSpace::Sycc)
+            matrix = PIXCONV_JPEG;
+        if (sensor_->renderers[stream].configure(sensor_->source,
+                                                 format_info(sc.pixelFormat)->layout,
+                                                 sc.size.width, sc.size.height, sc.stride,
+                                                 matrix) < 0)
+            return -EINVAL;
+    }
+    sensor_->configured = true;
+    sensor_->settled = false;
+    LOG_DEBUG("Synthetic camera %s configured, %zu stream(s)", id().c_str(), streams_.size());
+    return 0;
+}
+
+std::unique_ptr<Request> Camera::createRequest(uint64_t cookie)
+{
+    if (!sensor_->configured)
+        return nullptr;
+    return std::unique_ptr<Request>(new Request(this, cookie));
+}
+
+int Camera::queueRequest(Request *request)
+{
+    if (!request || request->camera_ != this)
+        return -EXDEV;
+    if (request->status_ != Request::RequestPending || request->bufferMap_.empty())
+        return -EINVAL;
+    return sensor_->queue(request);
+}
+
+int Camera::start(const ControlList *controls)
+{
+    if (!sensor_->configured)
+        return -EACCES;
+    return sensor_->start(controls);
+}
+
+int Camera::stop()
+{
+    sensor_->stop();
+    return 0;
+}
+
+// ============================================================================
+// Camera manager and buffer allocator
+// ============================================================================
+CameraManager::~CameraManager()
+{
+    stop();
+}
+
+int CameraManager::start()
+{
+    const char *spec = getenv("RPI_CAMERA_SOURCE");
+    const char *size = getenv("RPI_CAMERA_REPLAY_SIZE");
+    const char *fps_env = getenv("RPI_CAMERA_FPS");
+    const char *count_env = getenv("RPI_CAMERA_COUNT");
+
+    int width = 640, height = 480;
+    if (size && sscanf(size, "%dx%d", &width, &height) != 2) {
+        LOG_ERROR("RPI_CAMERA_REPLAY_SIZE must be WIDTHxHEIGHT, not '%s'", size);
+        return -EINVAL;
+    }
+    double fps = fps_env ? atof(fps_env) : 30.0;
+    if (fps < 1.0 || fps > 120.0) {
+        LOG_ERROR("RPI_CAMERA_FPS %s out of range (1..120)", fps_env);
+        return -EINVAL;
+    }
+    int count = count_env ? atoi(count_env) : 1;
+
+    std::shared_ptr<const synthetic::FrameSource> source =
+        synthetic::FrameSource::open(spec ? spec : "pattern", width, height);
+    if (!source)
+        return -ENOENT;
+
+    for (int i = 0; i < count; i++) {
+        std::shared_ptr<Camera> camera(new Camera(i));
+        camera->sensor_ = std::make_unique<SyntheticSensor>(camera.get(), i, source, fps);
+        cameras_.push_back(camera);
+    }
+    LOG_INFO("Synthetic camera backend: %d camera(s), %s, %.1f fps", count,
+             source->name().c_str(), fps);
+    return 0;
+}
+
+void CameraManager::stop()
+{
+    for (auto &camera : cameras_)
+        camera->stop();
+    cameras_.clear();
+}
+
+std::shared_ptr<Camera> CameraManager::get(const std::string &id)
+{
+    for (auto &camera : cameras_) {
+        if (camera->id() == id)
+            return camera;
+    }
+    return nullptr;
+}
+
+const std::string &CameraManager::version()
+{
+    static const std::string v = "synthetic";
+    return v;
+}
+
+int FrameBufferAllocator::allocate(Stream *stream)
+{
+    if (!stream || buffers_.count(stream))
+        return -EBUSY;
+
+    const StreamConfiguration &sc = stream->configuration();
+    const FormatInfo *f = format_info(sc.pixelFormat);
+    if (!f)
+        return -EINVAL;
+    unsigned int sizes[3];
+    unsigned int n = plane_sizes(f->layout, sc.stride, sc.size.height, sizes);
+
+    std::vector<std::unique_ptr<FrameBuffer>> &buffers = buffers_[stream];
+    for (unsigned int b = 0; b < sc.bufferCount; b++) {
+        int fd = memfd_create("synthetic-frame", MFD_CLOEXEC);
+        if (fd < 0 || ftruncate(fd, sc.frameSize) < 0) {
+            LOG_ERROR("Cannot allocate a %u byte frame buffer: %s", sc.frameSize,
+                      strerror(errno));
+            if (fd >= 0)
+                ::close(fd);
+            buffers_.erase(stream);
+            return -ENOMEM;
+        }
+        void *map = mmap(NULL, sc.frameSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            buffers_.erase(stream);
+            return -ENOMEM;
+        }
+
+        /* One fd for every plane, as the ISP hands them out */
+        SharedFD shared(std::move(fd));
+        std::vector<FrameBuffer::Plane> planes;
+        unsigned int offset = 0;
+        for (unsigned int p = 0; p < n; p++) {
+            planes.push_back({ shared, offset, sizes[p] });
+            offset += sizes[p];
+        }
+        buffers.push_back(std::make_unique<SyntheticFrameBuffer>(planes, (uint8_t *)map,
+                                                                 sc.frameSize));
+    }
+    return (int)buffers.size();
+}
+
+int FrameBufferAllocator::free(Stream *stream)
+{
+    return buffers_.erase(stream) ? 0 : -EINVAL;
+}
+
+const std::vector<std::unique_ptr<FrameBuffer>> &FrameBufferAllocator::buffers(Stream *stream) const
+{
+    static const std::vector<std::unique_ptr<FrameBuffer>> none;
+    auto it = buffers_.find(stream);
+    return it == buffers_.end() ? none : it->second;
+}
+
+} // namespace libcamera
@@ -0,0 +1,94 @@
+// ============================================================================
+// frame_pool.cpp - Preallocated frame buffers
+// ============================================================================
+
+#include "frame_pool.h"
+#include "log.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+void PoolBuffer::release() {
+    pool->put(index);
+}
+
+FramePool::~FramePool() {
+    if (region) {
+        if (is_locked)
+            munlock(region, region_size);
+        munmap(region, region_size);
+    }
+}
+
+int FramePool::init(size_t count, size_t size, bool lock) {
+    if (region || !count || !size)
+        return -1;
+
+    /* Cache-line aligned blocks so two frames never share a line */
+    block_size = (size + 63) & ~(size_t)63;
+    num_blocks = count;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    region_size = (block_size * count + page - 1) & ~(page - 1);
+
+    region = mmap(NULL, region_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (region == MAP_FAILED) {
+        region = nullptr;
+        return -1;
+    }
+
+    if (lock) {
+        if (mlock(region, region_size) == 0)
+            is_locked = true;
+        else
+            LOG_WARN("mlock frame pool: %s", strerror(errno));
+    }
+
+    /* MAP_POPULATE is only a hint; touch every page so they are resident */
+    for (size_t off = 0; off < region_size; off += page)
+        ((volatile uint8_t *)region)[off] = 0;
+
+    blocks.reset(new PoolBuffer[count]);
+    next.reset(new std::atomic<uint32_t>[count]);
+    for (size_t i = 0; i < count; i++) {
+        blocks[i].pool = this;
+        blocks[i].index = (uint32_t)i;
+        blocks[i].data = (uint8_t *)region + i * block_size;
+        next[i].store(i + 1 < count ? (uint32_t)(i + 1) : NONE,
+                      std::memory_order_relaxed);
+    }
+    top.store(0, std::memory_order_release);
+
+    return 0;
+}
+
+PoolBuffer *FramePool::get() {
+    uint64_t old = top.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t idx = (uint32_t)old;
+        if (idx == NONE) {
+            miss_count.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        /* The tag changes on every update, so a stale 'next' cannot win */
+        uint64_t tag = (old >> 32) + 1;
+        uint64_t want = (tag << 32) | next[idx].load(std::memory_order_relaxed);
+        if (top.compare_exchange_weak(old, want, std::memory_order_acquire,
+                                      std::memory_order_acquire))
+            return &blocks[idx];
+    }
+}
+
+void FramePool::put(uint32_t index) {
+    uint64_t old = top.load(std::memory_order_relaxed);
+    for (;;) {
+        next[index].store((uint32_t)old, std::memory_order_relaxed);
+        uint64_t want = (((old >> 32) + 1) << 32) | index;
+        if (top.compare_exchange_weak(old, want, std::memory_order_release,
+                                      std::memory_order_relaxed))
+            return;
+    }
+}
@@ -0,0 +1,402 @@
+// ============================================================================
+// jpeg_encoder.cpp - MJPEG encoding on a worker pool (libjpeg-turbo)
+// ============================================================================
+
+#include "jpeg_encoder.h"
+#include "log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <csetjmp>
+#include <poll.h>
+#include <time.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+/* 4:2:0 MCU: 16 luma rows and 8 rows of each chroma plane per call */
+#define JPEG_MCU_ROWS 16
+
+/* Room for the headers and Huffman tables on top of the raw frame size; a
+ * frame that still does not fit is dropped */
+#define JPEG_HEADER_SLACK (64 * 1024)
+
+/* How long a worker waits for input before looking at 'stopping' again */
+#define JPEG_INTAKE_POLL_MS 100
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct JpegError {
+    jpeg_error_mgr pub; /* first, libjpeg sees only this */
+    jmp_buf jump;
+};
+
+struct JpegEncoder::Worker {
+    uint32_t id;
+    jpeg_compress_struct cinfo;
+    JpegError err;
+    jpeg_destination_mgr dest;
+    bool created = false;
+    /* YUV420 copy of the input, padded to whole MCUs, when the input
+     * cannot be fed to libjpeg as it is */
+    std::vector<uint8_t> staging_mem;
+    rpi_frame_t staging;
+    JSAMPROW rows[3][JPEG_MCU_ROWS];
+};
+
+static void error_exit(j_common_ptr cinfo) {
+    JpegError *err = reinterpret_cast<JpegError *>(cinfo->err);
+    char msg[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, msg);
+    LOG_ERROR_RATELIMIT(1000, "JPEG encode: %s", msg);
+    longjmp(err->jump, 1);
+}
+
+/* The destination is a fixed pool buffer, set up before each frame */
+static void init_destination(j_compress_ptr) {}
+
+static boolean empty_output_buffer(j_compress_ptr cinfo) {
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+    return FALSE;
+}
+
+static void term_destination(j_compress_ptr) {}
+
+void JpegFrame::release() {
+    enc->put(this);
+}
+
+void JpegEncoder::put(JpegFrame *f) {
+    f->buf->release();
+}
+
+JpegEncoder::JpegEncoder() = default;
+
+JpegEncoder::~JpegEncoder() {
+    stop();
+    for (auto &w : workers) {
+        if (w->created)
+            jpeg_destroy_compress(&w->cinfo);
+    }
+    if (in)
+        rpi_camera_unsubscribe(in);
+}
+
+/* Stride and row count of the padded staging planes */
+static void staging_layout(int width, int height, uint32_t strides[3], uint32_t rows[3]) {
+    strides[0] = (uint32_t)(width + 15) & ~15u;
+    strides[1] = strides[2] = strides[0] / 2;
+    rows[0] = (uint32_t)height;
+    rows[1] = rows[2] = (uint32_t)(height + 1) / 2;
+}
+
+int JpegEncoder::init(rpi_subscriber_t *input, const Config &config) {
+    in = input;
+    if (!input || config.width <= 0 || config.height <= 0 || !config.workers)
+        return -EINVAL;
+    cfg = config;
+    cfg.quality = std::max(1, std::min(cfg.quality, 100));
+
+    /* A frame at any sane quality is smaller than its raw YUV420 size */
+    uint32_t strides[3], rows[3];
+    staging_layout(cfg.width, cfg.height, strides, rows);
+    size_t raw_size = 0;
+    for (int i = 0; i < 3; i++)
+        raw_size += (size_t)strides[i] * rows[i];
+
+    size_t count = cfg.workers + cfg.out_buffers;
+    if (pool.init(count, raw_size + JPEG_HEADER_SLACK, cfg.lock) < 0)
+        return -ENOMEM;
+    frames.reset(new JpegFrame[count]);
+    for (size_t i = 0; i < count; i++)
+        frames[i].enc = this;
+
+    /* Reorder window of two frames per worker, so one slow frame does not
+     * idle the others straight away */
+    pending.assign(cfg.workers * 2, Pending{false, nullptr});
+    out = std::make_unique<FramePipeline<JpegFrame *>>(
+        std::max(1u, cfg.out_buffers), cfg.policy);
+
+    /* libjpeg reads whole 8x8 blocks, so widths that are not a multiple of
+     * the 16-pixel MCU go through the padded staging copy */
+    bool direct = cfg.input_format == RPI_FMT_YUV420 && cfg.width % 16 == 0;
+
+    for (uint32_t i = 0; i < cfg.workers; i++) {
+        auto w = std::make_unique<Worker>();
+        w->id = i;
+
+        jpeg_compress_struct &ci = w->cinfo;
+        ci.err = jpeg_std_error(&w->err.pub);
+        w->err.pub.error_exit = error_exit;
+        if (setjmp(w->err.jump)) {
+            workers.push_back(std::move(w));
+            return -EIO;
+        }
+        jpeg_create_compress(&ci);
+        w->created = true;
+
+        w->dest.init_destination = init_destination;
+        w->dest.empty_output_buffer = empty_output_buffer;
+        w->dest.term_destination = term_destination;
+        ci.dest = &w->dest;
+
+        ci.image_width = cfg.width;
+        ci.image_height = cfg.height;
+        ci.input_components = 3;
+        ci.in_color_space = JCS_YCbCr;
+        jpeg_set_defaults(&ci);
+        jpeg_set_colorspace(&ci, JCS_YCbCr);
+        jpeg_set_quality(&ci, cfg.quality, TRUE);
+        /* Planes go straight to the DCT: no colour conversion, no
+         * downsampling */
+        ci.raw_data_in = TRUE;
+        ci.comp_info[0].h_samp_factor = 2;
+        ci.comp_info[0].v_samp_factor = 2;
+        for (int c = 1; c < 3; c++) {
+            ci.comp_info[c].h_samp_factor = 1;
+            ci.comp_info[c].v_samp_factor = 1;
+        }
+
+        if (!direct) {
+            w->staging_mem.resize(raw_size);
+            rpi_frame_t &s = w->staging;
+            memset(&s, 0, sizeof(s));
+            s.data = w->staging_mem.data();
+            s.size = raw_size;
+            s.width = cfg.width;
+            s.height = cfg.height;
+            s.format = RPI_FMT_YUV420;
+            s.num_planes = 3;
+            uint8_t *p = w->staging_mem.data();
+            for (int c = 0; c < 3; c++) {
+                s.planes[c].data = p;
+                s.planes[c].stride = strides[c];
+                s.planes[c].size = (size_t)strides[c] * rows[c];
+                s.planes[c].offset = p - w->staging_mem.data();
+                p += s.planes[c].size;
+            }
+        }
+        workers.push_back(std::move(w));
+    }
+    return 0;
+}
+
+void JpegEncoder::start() {
+    if (!threads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(out_mtx);
+        std::fill(pending.begin(), pending.end(), Pending{false, nullptr});
+        next_out = 0;
+        stopping = false;
+    }
+    next_ticket = 0;
+    out->reset();
+
+    for (auto &w : workers)
+        threads.emplace_back(&JpegEncoder::run, this, w.get());
+}
+
+void JpegEncoder::stop() {
+    if (threads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(out_mtx);
+        stopping = true;
+    }
+    out_cv.notify_all();
+    for (auto &t : threads)
+        t.join();
+    threads.clear();
+
+    /* Frames finished out of order, and frames nobody took */
+    for (auto &p : pending) {
+        if (p.frame)
+            put(p.frame);
+        p = Pending{false, nullptr};
+    }
+    out->stop();
+    JpegFrame *f;
+    while (out->try_pop(f))
+        put(f);
+}
+
+void JpegEncoder::run(Worker *w) {
+    for (;;) {
+        /* Wait for input without the intake lock, so an idle worker does
+         * not hold up the others */
+        struct pollfd pfd = { rpi_subscriber_get_fd(in), POLLIN, 0 };
+        poll(&pfd, 1, JPEG_INTAKE_POLL_MS);
+
+        rpi_frame_t src;
+        uint64_t ticket;
+        {
+            /* Take and number in one step, so tickets follow queue order */
+            std::lock_guard<std::mutex> intake(in_mtx);
+            {
+                std::unique_lock<std::mutex> lk(out_mtx);
+                out_cv.wait(lk, [&] {
+                    return stopping || next_ticket < next_out + pending.size();
+                });
+                if (stopping)
+                    return;
+            }
+            int ret = rpi_subscriber_try_acquire_frame(in, &src);
+            /* Another worker got there first, or the input subscriber is
+             * stopped (-EPIPE) */
+            if (ret == -EAGAIN)
+                ret = rpi_subscriber_acquire_frame(in, &src, 0);
+            if (ret == -ETIMEDOUT)
+                continue;
+            if (ret)
+                return;
+            ticket = next_ticket++;
+        }
+
+        JpegFrame *f = encode(w, &src);
+        rpi_camera_release_frame(&src);
+        if (!f)
+            drop_count.fetch_add(1, std::memory_order_relaxed);
+        deliver(ticket, f);
+    }
+}
+
+/* Replicate the last column into the MCU padding of each staging row */
+static void pad_columns(rpi_frame_t *s) {
+    for (int c = 0; c < 3; c++) {
+        int width = c ? (s->width + 1) / 2 : s->width;
+        int rows = c ? (s->height + 1) / 2 : s->height;
+        uint32_t stride = s->planes[c].stride;
+        if ((uint32_t)width == stride)
+            continue;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = (uint8_t *)s->planes[c].data + (size_t)y * stride;
+            memset(row + width, row[width - 1], stride - width);
+        }
+    }
+}
+
+JpegFrame *JpegEncoder::encode(Worker *w, const rpi_frame_t *src) {
+    uint64_t t0 = now_ns();
+
+    PoolBuffer *pb = pool.get();
+    if (!pb)
+        return nullptr;
+
+    const rpi_frame_t *yuv = src;
+    if (w->staging.data) {
+        if (pixconv_convert(src, &w->staging, PIXCONV_JPEG) != 0) {
+            pb->release();
+            return nullptr;
+        }
+        pad_columns(&w->staging);
+        yuv = &w->staging;
+    } else if (src->format != RPI_FMT_YUV420 || src->width != cfg.width ||
+               src->height != cfg.height) {
+        pb->release();
+        return nullptr;
+    }
+
+    jpeg_compress_struct &ci = w->cinfo;
+    w->dest.next_output_byte = pb->data;
+    w->dest.free_in_buffer = pool.buffer_size();
+
+    if (setjmp(w->err.jump)) {
+        jpeg_abort_compress(&ci);
+        pb->release();
+        return nullptr;
+    }
+
+    jpeg_start_compress(&ci, TRUE);
+    JSAMPARRAY planes[3] = { w->rows[0], w->rows[1], w->rows[2] };
+    int chroma_height = (cfg.height + 1) / 2;
+    while (ci.next_scanline < ci.image_height) {
+        int y0 = (int)ci.next_scanline;
+        for (int r = 0; r < JPEG_MCU_ROWS; r++) {
+            /* Rows past the bottom repeat the last one */
+            int y = std::min(y0 + r, cfg.height - 1);
+            w->rows[0][r] = (JSAMPROW)yuv->planes[0].data + (size_t)y * yuv->planes[0].stride;
+        }
+        for (int r = 0; r < JPEG_MCU_ROWS / 2; r++) {
+            int y = std::min(y0 / 2 + r, chroma_height - 1);
+            for (int c = 1; c < 3; c++)
+                w->rows[c][r] = (JSAMPROW)yuv->planes[c].data + (size_t)y * yuv->planes[c].stride;
+        }
+        jpeg_write_raw_data(&ci, planes, JPEG_MCU_ROWS);
+    }
+    jpeg_finish_compress(&ci);
+
+    JpegFrame *f = &frames[pb->index];
+    f->buf = pb;
+    f->size = pool.buffer_size() - w->dest.free_in_buffer;
+    f->timestamp = src->timestamp;
+    f->sequence = src->sequence;
+    f->meta = src->meta;
+    f->worker = w->id;
+    f->encode_ns = now_ns() - t0;
+    return f;
+}
+
+/* File a finished ticket and pass on every frame that is now in order */
+void JpegEncoder::deliver(uint64_t ticket, JpegFrame *f) {
+    {
+        std::lock_guard<std::mutex> lk(out_mtx);
+        pending[ticket % pending.size()] = Pending{true, f};
+
+        for (;;) {
+            Pending &p = pending[next_out % pending.size()];
+            if (!p.done)
+                break;
+            if (p.frame) {
+                JpegFrame *rejected = out->push(p.frame);
+                if (rejected) {
+                    put(rejected);
+                    drop_count.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            p = Pending{false, nullptr};
+            next_out++;
+        }
+    }
+    out_cv.notify_all();
+}
+
+void JpegEncoder::lease(JpegFrame *f, rpi_frame_t *o) {
+    memset(o, 0, sizeof(*o));
+    o->data = f->buf->data;
+    o->size = f->size;
+    o->timestamp = f->timestamp;
+    o->sequence = f->sequence;
+    o->width = cfg.width;
+    o->height = cfg.height;
+    o->format = RPI_FMT_MJPEG;
+    o->meta = f->meta;
+    o->num_planes = 1;
+    o->planes[0].data = o->data;
+    o->planes[0].size = f->size;
+    o->planes[0].stride = 0; /* not row based */
+    o->planes[0].offset = 0;
+    o->priv = static_cast<FrameOwner *>(f);
+}
+
+int JpegEncoder::get(rpi_frame_t *o, int timeout_ms) {
+    JpegFrame *f;
+    int ret = out->pop(f, timeout_ms);
+    if (ret)
+        return ret;
+    lease(f, o);
+    return 0;
+}
+
+int JpegEncoder::try_get(rpi_frame_t *o) {
+    JpegFrame *f;
+    if (!out->try_pop(f))
+        return -EAGAIN;
+    lease(f, o);
+    return 0;
+}
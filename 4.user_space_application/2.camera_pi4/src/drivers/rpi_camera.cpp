@@ -5,164 +5,1013 @@
 #include <libcamera/libcamera.h>
 #include <libcamera/control_ids.h>
 #include "rpi_camera.h"
+#include "camera_config.h"
 #include <sys/mman.h>
-#include <iostream>
+#include <string>
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <map>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
 #include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "frame_pipeline.h"
+#include "frame_pool.h"
+#include "pixel_convert.h"
+#include "jpeg_encoder.h"
+#include "instrument.h"
+#include "log.h"
 
 using namespace libcamera;
 
-struct InternalFrame {
-    std::vector<uint8_t> data;  // COPY
+struct MappedBuffer;
+
+/* One slot per Request. A completed request travels through the pipeline as
+ * a FrameSlot and goes back to the camera when the last reference is
+ * released, so the frame data never leaves the libcamera buffer. Every
+ * subscriber queue holding the slot and every lease on it is a reference. */
+struct FrameSlot : FrameOwner {
+    rpi_camera_t *cam;
+    Request *request;
+    const MappedBuffer *mapped[RPI_STREAM_COUNT]; /* null if the stream is off */
     uint64_t timestamp;
     uint32_t sequence;
+    uint32_t gap;         /* sensor frames lost just before this one */
+    uint64_t complete_ns; /* CLOCK_MONOTONIC when the request completed */
+    rpi_frame_meta_t meta;
+    rpi_controls_t ctrl;  /* controls the request carries... */
+    uint64_t ctrl_ticket; /* ...and their ticket, 0 = none */
+    bool bracket;         /* the request carries a burst bracket */
+    std::atomic<uint32_t> refs{0};
+
+    void release() override;
 };
 
-class FramePipeline {
-public:
-    explicit FramePipeline(size_t max)
-        : max_size(max) {}
-
-    bool push(InternalFrame &&f) {
-        std::lock_guard<std::mutex> lk(mtx);
+/* Persistent CPU view of one FrameBuffer. Every dmabuf behind the buffer is
+ * mapped once at create time and stays mapped until destroy. */
+struct MappedBuffer {
+    std::vector<std::pair<void *, size_t>> maps; /* one per distinct fd */
+    int width;
+    int height;
+    rpi_format_t format;
+    uint32_t num_planes;
+    rpi_plane_t planes[RPI_FRAME_MAX_PLANES];
+    void *data;  /* start of plane 0 */
+    size_t size; /* span of all planes when contiguous, else plane 0 */
+};
 
-        if (queue.size() >= max_size) {
-            dropped++;
-            return false; // DROP
-        }
+/* One consumer of a camera: its own queue depth, overflow policy and fd.
+ * Every subscriber sees every request; 'stream' picks which of its buffers
+ * the frames describe. */
+struct rpi_subscriber_t {
+    rpi_subscriber_t(rpi_camera_t *c, size_t depth, rpi_overflow_policy_t policy,
+                     rpi_stream_t s = RPI_STREAM_MAIN)
+        : cam(c), stream(s), pipeline(depth, policy) {}
+
+    rpi_camera_t *cam;
+    rpi_stream_t stream;
+    FramePipeline<FrameSlot *> pipeline;
+};
 
-        queue.push(std::move(f));
-        cv.notify_one();
-        return true;
+/* One CameraManager per process, shared by every open camera. Starting it
+ * enumerates the media graph and loads the IPA modules, so it is started
+ * once and stopped with the last user: an open camera, or the pre-warm
+ * reference. Callers wait on g_cm_mtx while another thread starts it. */
+static std::mutex g_cm_mtx;
+static std::unique_ptr<CameraManager> g_cm;
+static int g_cm_users = 0;
+enum PrewarmState { PREWARM_NONE, PREWARM_PENDING, PREWARM_HELD };
+static PrewarmState g_prewarm = PREWARM_NONE; /* under g_cm_mtx */
+static std::thread g_prewarm_thread;          /* under g_cm_mtx */
+
+static void camera_manager_put_locked() {
+    if (g_cm_users > 0 && --g_cm_users == 0) {
+        g_cm->stop();
+        g_cm.reset();
     }
+}
 
-    bool pop(InternalFrame &out) {
-        std::unique_lock<std::mutex> lk(mtx);
-
-        cv.wait(lk, [&] {
-            return !queue.empty() || stopped;
-        });
-
-        if (queue.empty())
-            return false;
-
-        out = std::move(queue.front());
-        queue.pop();
-        return true;
+static CameraManager *camera_manager_get() {
+    std::lock_guard<std::mutex> lk(g_cm_mtx);
+    if (!g_cm) {
+        auto cm = std::make_unique<CameraManager>();
+        if (cm->start()) {
+            LOG_ERROR("Failed to start camera manager");
+            return nullptr;
+        }
+        g_cm = std::move(cm);
     }
+    g_cm_users++;
+    return g_cm.get();
+}
 
-    bool try_pop(InternalFrame &out) {
-        std::lock_guard<std::mutex> lk(mtx);
-        if (queue.empty())
-            return false;
+static void camera_manager_put() {
+    std::lock_guard<std::mutex> lk(g_cm_mtx);
+    camera_manager_put_locked();
+}
 
-        out = std::move(queue.front());
-        queue.pop();
-        return true;
+static void prewarm_thread() {
+    CameraManager *cm = camera_manager_get();
+    std::lock_guard<std::mutex> lk(g_cm_mtx);
+    if (!cm) {
+        g_prewarm = PREWARM_NONE;
+        return;
     }
+    /* Released while starting: hand the reference straight back */
+    if (g_prewarm == PREWARM_PENDING)
+        g_prewarm = PREWARM_HELD;
+    else
+        camera_manager_put_locked();
+}
 
-    void stop() {
-        std::lock_guard<std::mutex> lk(mtx);
-        stopped = true;
-        cv.notify_all();
-    }
+/* Counters behind rpi_camera_get_stats(). The frame worker is the only
+ * writer of the first group, so it bumps them with relaxed load/store pairs
+ * instead of locked RMWs. Consumers on any thread write the second group,
+ * which sits on its own cache line so their fetch_adds do not bounce the
+ * worker's. */
+struct CameraStats {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> dropped_pipeline{0};
+    std::atomic<uint64_t> dropped_newest{0};
+    std::atomic<uint64_t> dropped_oldest{0};
+    std::atomic<uint64_t> dropped_sensor{0};
+    std::atomic<uint32_t> high_water{0};
+    std::atomic<uint64_t> sensor_to_complete[RPI_STATS_LATENCY_BUCKETS] = {};
+    uint32_t last_sequence = 0;  /* frame worker only */
+    bool have_sequence = false;  /* cleared by start */
+    uint64_t start_ns = 0;       /* last rpi_camera_start(), MONOTONIC */
+    std::atomic<uint64_t> first_frame_ns{0}; /* start_ns to its first completion */
+    std::atomic<uint64_t> stills{0};
+    std::atomic<uint64_t> still_video_lost{0};
+    bool after_still = false;    /* frame worker only: the next gap counts too */
+
+    alignas(64) std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> complete_to_consumer[RPI_STATS_LATENCY_BUCKETS] = {};
+};
 
-    void reset()
-    {
-        std::lock_guard<std::mutex> lk(mtx);
-        std::queue<InternalFrame> empty;
-        std::swap(queue, empty);
-        stopped = false;
-    }
+/* Where rpi_camera_create_ex() spent its time; the frame worker adds the
+ * first start's time to first frame */
+struct StartupTiming {
+    uint64_t manager_ns = 0;
+    uint64_t acquire_ns = 0;
+    uint64_t configure_ns = 0;
+    uint64_t allocate_ns = 0;
+    std::atomic<uint64_t> first_frame_ns{0};
+};
 
-    uint64_t dropped_count() const { return dropped; }
+/* The still buffer's way through one rpi_camera_capture_still(): the
+ * caller asks (PENDING), the next request going back to the camera takes
+ * the buffer (INFLIGHT), the frame worker hands the completed slot over
+ * (READY). A caller that gave up leaves it ABANDONED and the slot just goes
+ * round. The buffer is free again once the slot carrying it is requeued
+ * without it, see prepare_request(). */
+enum StillState { STILL_IDLE, STILL_PENDING, STILL_INFLIGHT, STILL_READY, STILL_ABANDONED };
+
+struct StillCapture {
+    libcamera::Stream *stream = nullptr;
+    FrameBuffer *buffer = nullptr;
+    const MappedBuffer *mapped = nullptr;
+    std::atomic<bool> wanted{false};   /* PENDING, claimed lock-free by requeue */
+    std::atomic<bool> attached{false}; /* a request holds the buffer */
+    std::mutex mtx;
+    std::condition_variable cv;
+    StillState state = STILL_IDLE; /* the rest under mtx */
+    FrameSlot *slot = nullptr;     /* READY: one reference for the caller */
+    int error = 0;
+};
 
-private:
-    std::queue<InternalFrame> queue;
-    size_t max_size;
+/* One rpi_camera_capture_burst(). Requeues put the brackets on
+ * consecutive requests, one each (queue_slot()); from the first
+ * bracketed request's completion on, the frame worker keeps the first frame
+ * whose metadata shows each bracket in turn, so control latency costs
+ * frames in between but never a bracket. */
+enum BurstState { BURST_IDLE, BURST_RUNNING, BURST_READY };
 
+struct BurstCapture {
+    std::atomic<bool> active{false};       /* frame worker: collect */
+    std::atomic<unsigned int> to_send{0};  /* brackets not on a request yet */
     std::mutex mtx;
     std::condition_variable cv;
-    bool stopped = false;
-
-    std::atomic<uint64_t> dropped{0};
+    BurstState state = BURST_IDLE; /* the rest under mtx */
+    std::vector<rpi_controls_t> brackets;
+    size_t sent = 0;
+    bool armed = false;            /* first bracketed request completed */
+    std::vector<FrameSlot *> slots; /* kept frames, one reference each */
+    int error = 0;
 };
 
-// Global map to store camera pointers by request cookie
-static std::map<uint64_t, rpi_camera_t*> g_camera_map;
-static uint64_t g_next_cookie = 1;
+/* Single-writer counter bump */
+static inline void stat_add(std::atomic<uint64_t> &c, uint64_t n = 1) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static unsigned int latency_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    unsigned int b = us ? 63 - __builtin_clzll(us) : 0;
+    return std::min(b, RPI_STATS_LATENCY_BUCKETS - 1u);
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
 struct rpi_camera_t {
-    std::unique_ptr<CameraManager> cm;
+    CameraManager *cm; /* shared, see camera_manager_get() */
     std::shared_ptr<Camera> camera;
     std::unique_ptr<CameraConfiguration> config;
     std::unique_ptr<FrameBufferAllocator> allocator;
     std::vector<std::unique_ptr<Request>> requests;
     libcamera::Stream *stream;
     std::vector<libcamera::FrameBuffer *> buffers;
+    /* Optional ISP-scaled copy of every frame, same request as 'stream' */
+    libcamera::Stream *analysis_stream;
+    std::vector<libcamera::FrameBuffer *> analysis_buffers;
 
     int width;
     int height;
-    rpi_format_t format;
+    rpi_format_t format;         /* what get_frame() delivers */
+    rpi_format_t capture_format; /* what the ISP writes, see capture_format_for() */
+    pixconv_matrix_t matrix;     /* YCbCr matrix of the captured stream */
     
     std::atomic<bool> running;
-    std::thread capture_thread;
     bool signal_connected;
-
-    uint64_t cookie; /* Add cookie to store our identifier*/
-    std::unique_ptr<FramePipeline> pipeline;
+    /* Frame worker: libcamera's event thread only hands completed slots
+     * over; metadata, stats and fan-out run here */
+    std::thread capture_thread;
+    std::unique_ptr<FramePipeline<FrameSlot *>> completed;
+    int worker_cpu;      /* -1 = any */
+    int worker_priority; /* SCHED_FIFO priority, 0 = normal scheduling */
+
+    /* Queue behind the rpi_camera_get/acquire API, attached on first use so
+     * cameras driven only through subscriptions do not fill it */
+    std::unique_ptr<rpi_subscriber_t> default_sub;
+    std::atomic<bool> default_attached;
+    /* The frame worker walks this without a lock; 'dispatching' lets
+     * unsubscribe wait until no walk can still see a removed entry */
+    std::atomic<rpi_subscriber_t *> subs[RPI_CAMERA_MAX_SUBSCRIBERS];
+    std::atomic<int> dispatching;
+    std::mutex subs_mtx;
+    std::vector<FrameSlot> slots; /* one per buffer, fixed after create */
+    std::map<FrameBuffer *, MappedBuffer> mappings; /* keyed by buffer */
+    unsigned int stride; /* negotiated bytes per row of plane 0 */
+    int64_t frame_duration[2]; /* FrameDurationLimits at start, us, 0 = default */
+    FramePool pool;      /* destination buffers for the copy path */
+    /* MJPEG: encodes the main stream for get_frame() on its own subscriber */
+    std::unique_ptr<JpegEncoder> jpeg;
+
+    /* Queued controls, moved into the next request that goes out */
+    std::mutex ctrl_mtx;
+    rpi_controls_t ctrl_pending;
+    uint64_t ctrl_ticket;          /* last ticket handed out */
+    std::atomic<bool> ctrl_dirty;  /* ctrl_pending has something */
+    /* Frame worker only: queued values not yet seen in the metadata */
+    rpi_controls_t ctrl_awaiting;
+    uint64_t ctrl_awaiting_ticket;
+    uint64_t ctrl_applied_ticket;
+
+    CameraStats stats;
+    StartupTiming startup;
+    StillCapture still;
+    BurstCapture burst;
     
     ~rpi_camera_t() = default;
 };
 
-/* API for user blocking */
-int rpi_camera_get_frame(rpi_camera_t *cam, rpi_frame_t *out) {
-    if (!cam || !out) return -1;
+/* Copy the fields 'src' sets into 'dst'. Turning AE back on drops manual
+ * exposure and gain. */
+static void merge_controls(rpi_controls_t &dst, const rpi_controls_t &src) {
+    if (src.set & RPI_CTRL_BRIGHTNESS) dst.brightness = src.brightness;
+    if (src.set & RPI_CTRL_CONTRAST)   dst.contrast = src.contrast;
+    if (src.set & RPI_CTRL_EXPOSURE)   dst.exposure_us = src.exposure_us;
+    if (src.set & RPI_CTRL_GAIN)       dst.analogue_gain = src.analogue_gain;
+    if (src.set & RPI_CTRL_FRAME_DURATION) {
+        dst.frame_duration_min_us = src.frame_duration_min_us;
+        dst.frame_duration_max_us = src.frame_duration_max_us;
+    }
+    if (src.set & RPI_CTRL_AE_ENABLE) {
+        dst.ae_enable = src.ae_enable;
+        if (src.ae_enable)
+            dst.set &= ~((RPI_CTRL_EXPOSURE | RPI_CTRL_GAIN) & ~src.set);
+    }
+    dst.set |= src.set;
+}
+
+/* Set the fields 'c' has in a request's control list */
+static void write_controls(ControlList &list, const rpi_controls_t &c) {
+    if (c.set & RPI_CTRL_BRIGHTNESS) list.set(controls::Brightness, c.brightness);
+    if (c.set & RPI_CTRL_CONTRAST)   list.set(controls::Contrast, c.contrast);
+    if (c.set & RPI_CTRL_EXPOSURE)   list.set(controls::ExposureTime, (int32_t)c.exposure_us);
+    if (c.set & RPI_CTRL_GAIN)       list.set(controls::AnalogueGain, c.analogue_gain);
+    if (c.set & RPI_CTRL_AE_ENABLE)  list.set(controls::AeEnable, c.ae_enable != 0);
+    if (c.set & RPI_CTRL_FRAME_DURATION)
+        list.set(controls::FrameDurationLimits,
+                 Span<const int64_t, 2>({ c.frame_duration_min_us, c.frame_duration_max_us }));
+}
+
+/* Move queued controls into a request about to go to the camera */
+static void attach_controls(rpi_camera_t *cam, FrameSlot *slot) {
+    slot->ctrl_ticket = 0;
+    if (!cam->ctrl_dirty.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lk(cam->ctrl_mtx);
+    const rpi_controls_t &c = cam->ctrl_pending;
+    write_controls(slot->request->controls(), c);
+
+    slot->ctrl = c;
+    slot->ctrl_ticket = cam->ctrl_ticket;
+    cam->ctrl_pending.set = 0;
+    cam->ctrl_dirty.store(false, std::memory_order_relaxed);
+}
+
+/* Send a request to the camera with the next burst bracket, if one is
+ * due; after attach_controls() so the bracket wins over queued values.
+ * Requeues come from any consumer thread, so the bracket is picked and the
+ * request queued under one lock: brackets reach the sensor in order. */
+static int queue_slot(rpi_camera_t *cam, FrameSlot *slot) {
+    BurstCapture &burst = cam->burst;
+    slot->bracket = false;
+    if (!burst.to_send.load(std::memory_order_acquire))
+        return cam->camera->queueRequest(slot->request);
+
+    std::lock_guard<std::mutex> lk(burst.mtx);
+    if (burst.state == BURST_RUNNING && burst.sent < burst.brackets.size()) {
+        write_controls(slot->request->controls(), burst.brackets[burst.sent++]);
+        burst.to_send.store(burst.brackets.size() - burst.sent, std::memory_order_relaxed);
+        slot->bracket = true;
+    }
+    return cam->camera->queueRequest(slot->request);
+}
+
+/* Empty a request for its next trip; reuse() also empties its controls.
+ * One that carried the still buffer gives it up, which takes a full reuse()
+ * and the video buffers added back. The still buffer goes on the first
+ * request out after rpi_camera_capture_still() asks for it. */
+static void prepare_request(rpi_camera_t *cam, FrameSlot *slot) {
+    Request *req = slot->request;
+    StillCapture &still = cam->still;
+
+    if (!slot->mapped[RPI_STREAM_STILL]) {
+        req->reuse(Request::ReuseBuffers);
+    } else {
+        size_t i = slot - cam->slots.data();
+        req->reuse();
+        if (req->addBuffer(cam->stream, cam->buffers[i]) < 0 ||
+            (cam->analysis_stream &&
+             req->addBuffer(cam->analysis_stream, cam->analysis_buffers[i]) < 0))
+            LOG_ERROR("Failed to add buffer to request");
+        slot->mapped[RPI_STREAM_STILL] = nullptr;
+        still.attached.store(false, std::memory_order_release);
+    }
 
-    InternalFrame f;
-    if (!cam->pipeline->pop(f))
+    if (!still.wanted.load(std::memory_order_relaxed) ||
+        !still.wanted.exchange(false, std::memory_order_acq_rel))
+        return;
+    bool added = req->addBuffer(still.stream, still.buffer) == 0;
+    if (added) {
+        slot->mapped[RPI_STREAM_STILL] = still.mapped;
+        still.attached.store(true, std::memory_order_release);
+    } else {
+        LOG_ERROR("Failed to add still buffer to request");
+    }
+
+    std::lock_guard<std::mutex> lk(still.mtx);
+    if (still.state == STILL_PENDING && added) {
+        still.state = STILL_INFLIGHT;
+    } else if (still.state == STILL_PENDING) {
+        still.state = STILL_READY;
+        still.error = -EIO;
+        still.cv.notify_all();
+    } else if (!added) {
+        still.state = STILL_IDLE; /* abandoned */
+    }
+}
+
+/* Hand a slot's request back to the camera */
+static void requeue_slot(FrameSlot *slot) {
+    rpi_camera_t *cam = slot->cam;
+    if (!cam->running || !slot->request)
+        return;
+
+    prepare_request(cam, slot);
+    attach_controls(cam, slot);
+    queue_slot(cam, slot);
+}
+
+/* Row size in bytes and row count of image data in each plane */
+static uint32_t plane_layout(rpi_format_t fmt, int width, int height,
+                             uint32_t stride, uint32_t row_bytes[],
+                             uint32_t rows[], uint32_t strides[]) {
+    switch (fmt) {
+        case RPI_FMT_YUV420:
+            if (!stride)
+                stride = width;
+            row_bytes[0] = width;
+            rows[0] = height;
+            strides[0] = stride;
+            for (int i = 1; i < 3; i++) {
+                row_bytes[i] = (width + 1) / 2;
+                rows[i] = (height + 1) / 2;
+                strides[i] = stride / 2;
+            }
+            return 3;
+        case RPI_FMT_NV12:
+            if (!stride)
+                stride = width;
+            row_bytes[0] = width;
+            rows[0] = height;
+            strides[0] = stride;
+            row_bytes[1] = (width + 1) / 2 * 2;
+            rows[1] = (height + 1) / 2;
+            strides[1] = stride;
+            return 2;
+        case RPI_FMT_RGB888:
+            row_bytes[0] = width * 3;
+            break;
+        case RPI_FMT_BGRA:
+            row_bytes[0] = width * 4;
+            break;
+        case RPI_FMT_GRAY8:
+            row_bytes[0] = width;
+            break;
+        case RPI_FMT_RAW10: /* 4 pixels in 5 bytes */
+            row_bytes[0] = (width + 3) / 4 * 5;
+            break;
+        case RPI_FMT_RAW12: /* 2 pixels in 3 bytes */
+            row_bytes[0] = (width + 1) / 2 * 3;
+            break;
+        case RPI_FMT_YUYV:
+        default:
+            row_bytes[0] = width * 2;
+            break;
+    }
+    rows[0] = height;
+    strides[0] = stride ? stride : row_bytes[0];
+    return 1;
+}
+
+/* Map every plane of 'buffer' and fill in its plane table */
+static int map_buffer(FrameBuffer *buffer, const StreamConfiguration &sc,
+                      rpi_format_t format, MappedBuffer &mb) {
+    const std::vector<FrameBuffer::Plane> &planes = buffer->planes();
+    if (planes.empty())
         return -1;
 
-    out->size = f.data.size();
-    out->data = (uint8_t *)malloc(out->size);
-    memcpy(out->data, f.data.data(), out->size);
+    /* libcamera normally places all planes in one dmabuf: map each distinct
+     * fd once, covering every plane that lives in it */
+    std::vector<int> fds;
+    for (const auto &p : planes) {
+        int fd = p.fd.get();
+        if (std::find(fds.begin(), fds.end(), fd) != fds.end())
+            continue;
+
+        size_t len = 0;
+        for (const auto &q : planes) {
+            if (q.fd.get() == fd)
+                len = std::max<size_t>(len, q.offset + q.length);
+        }
+
+        void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_ERROR("mmap failed");
+            return -1;
+        }
+        fds.push_back(fd);
+        mb.maps.emplace_back(map, len);
+    }
 
-    out->timestamp = f.timestamp;
-    out->sequence  = f.sequence;
+    auto base_of = [&](const FrameBuffer::Plane &p) {
+        size_t idx = std::find(fds.begin(), fds.end(), p.fd.get()) - fds.begin();
+        return (uint8_t *)mb.maps[idx].first;
+    };
+
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    uint32_t strides[RPI_FRAME_MAX_PLANES];
+    mb.width = sc.size.width;
+    mb.height = sc.size.height;
+    mb.format = format;
+    mb.num_planes = plane_layout(format, mb.width, mb.height, sc.stride,
+                                 row_bytes, rows, strides);
+
+    uint8_t *start = base_of(planes[0]) + planes[0].offset;
+    for (uint32_t i = 0; i < mb.num_planes; i++) {
+        rpi_plane_t &dst = mb.planes[i];
+        if (i < planes.size()) {
+            dst.data = base_of(planes[i]) + planes[i].offset;
+            dst.size = planes[i].length;
+        } else {
+            /* Single-plane buffer holding several image planes: derive the
+             * sub-plane from the previous one */
+            const rpi_plane_t &prev = mb.planes[i - 1];
+            dst.data = (uint8_t *)prev.data + (size_t)strides[i - 1] * rows[i - 1];
+            dst.size = (size_t)strides[i] * rows[i];
+        }
+        dst.stride = strides[i];
+        dst.offset = (uint8_t *)dst.data - start;
+    }
+
+    /* Planes are contiguous when they share one map and follow each other */
+    const rpi_plane_t &last = mb.planes[mb.num_planes - 1];
+    bool contiguous = mb.maps.size() == 1 && (uint8_t *)last.data >= start;
+    mb.data = start;
+    mb.size = contiguous ? (uint8_t *)last.data + last.size - start : mb.planes[0].size;
 
     return 0;
 }
 
-/* API for user non-blocking */
-int rpi_camera_try_get_frame(rpi_camera_t *cam, rpi_frame_t *out) {
-    if (!cam || !out) return -1;
+static void unmap_buffers(rpi_camera_t *cam) {
+    for (auto &entry : cam->mappings) {
+        for (auto &map : entry.second.maps)
+            munmap(map.first, map.second);
+    }
+    cam->mappings.clear();
+}
+
+/* Drop one reference; the last one gives the buffer back to the sensor,
+ * or, while stopped, leaves it for the next rpi_camera_start() */
+static void unref_slot(FrameSlot *slot) {
+    uint32_t refs = slot->refs.load(std::memory_order_relaxed);
+    do {
+        /* Double release */
+        if (refs == 0)
+            return;
+    } while (!slot->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed));
+
+    if (refs == 1)
+        requeue_slot(slot);
+}
+
+/* Describe one stream of a completed slot in 'out'; the buffer is already
+ * mapped */
+static int lease_slot(FrameSlot *slot, rpi_stream_t stream, rpi_frame_t *out) {
+    const MappedBuffer *mb = slot->mapped[stream];
+    if (!mb) {
+        unref_slot(slot);
+        return -1;
+    }
+
+    CameraStats &st = slot->cam->stats;
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    st.delivered.fetch_add(1, std::memory_order_relaxed);
+    if (now >= slot->complete_ns)
+        st.complete_to_consumer[latency_bucket(now - slot->complete_ns)]
+            .fetch_add(1, std::memory_order_relaxed);
+
+    out->data = mb->data;
+    out->size = mb->size;
+    out->timestamp = slot->timestamp;
+    out->sequence  = slot->sequence;
+    out->width = mb->width;
+    out->height = mb->height;
+    out->format = mb->format;
+    out->num_planes = mb->num_planes;
+    memcpy(out->planes, mb->planes, sizeof(out->planes));
+    out->meta = slot->meta;
+    out->priv = slot;
+
+    return 0;
+}
+
+/* Attach a subscriber so the frame worker starts feeding it */
+static int attach_subscriber(rpi_camera_t *cam, rpi_subscriber_t *sub) {
+    std::lock_guard<std::mutex> lk(cam->subs_mtx);
+    for (auto &entry : cam->subs) {
+        if (!entry.load(std::memory_order_relaxed)) {
+            entry.store(sub, std::memory_order_seq_cst);
+            return 0;
+        }
+    }
+    return -ENOSPC;
+}
+
+static void detach_subscriber(rpi_camera_t *cam, rpi_subscriber_t *sub) {
+    {
+        std::lock_guard<std::mutex> lk(cam->subs_mtx);
+        for (auto &entry : cam->subs) {
+            if (entry.load(std::memory_order_relaxed) == sub)
+                entry.store(nullptr, std::memory_order_seq_cst);
+        }
+    }
+
+    /* A dispatch that loaded 'sub' before the store may still push to it */
+    while (cam->dispatching.load(std::memory_order_seq_cst))
+        std::this_thread::yield();
 
-    InternalFrame f;
-    if (!cam->pipeline->try_pop(f))
+    /* Frames still queued for it are its references to drop */
+    FrameSlot *slot;
+    while (sub->pipeline.try_pop(slot))
+        unref_slot(slot);
+}
+
+/* The get/acquire API's queue, attached the first time it is used; null
+ * while every subscriber slot is taken */
+static FramePipeline<FrameSlot *> *default_pipeline(rpi_camera_t *cam) {
+    if (!cam->default_attached.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lk(cam->subs_mtx);
+        if (!cam->default_attached.load(std::memory_order_relaxed)) {
+            for (auto &entry : cam->subs) {
+                if (!entry.load(std::memory_order_relaxed)) {
+                    entry.store(cam->default_sub.get(), std::memory_order_seq_cst);
+                    cam->default_attached.store(true, std::memory_order_release);
+                    break;
+                }
+            }
+            if (!cam->default_attached.load(std::memory_order_relaxed)) {
+                LOG_ERROR("Too many subscribers for rpi_camera_get/acquire");
+                return nullptr;
+            }
+        }
+    }
+    return &cam->default_sub->pipeline;
+}
+
+/* Run 'fn' on every attached subscriber (control path only) */
+template <typename Fn>
+static void for_each_subscriber(rpi_camera_t *cam, Fn fn) {
+    std::lock_guard<std::mutex> lk(cam->subs_mtx);
+    for (auto &entry : cam->subs) {
+        rpi_subscriber_t *sub = entry.load(std::memory_order_relaxed);
+        if (sub)
+            fn(sub);
+    }
+}
+
+/* The slot carrying the still goes to the rpi_camera_capture_still() caller
+ * with a reference of its own; frame worker only */
+static void hand_over_still(rpi_camera_t *cam, FrameSlot *slot) {
+    StillCapture &still = cam->still;
+    std::lock_guard<std::mutex> lk(still.mtx);
+    if (still.state == STILL_INFLIGHT) {
+        slot->refs.fetch_add(1, std::memory_order_relaxed);
+        still.slot = slot;
+        still.error = 0;
+        still.state = STILL_READY;
+        still.cv.notify_all();
+    } else if (still.state == STILL_ABANDONED) {
+        still.state = STILL_IDLE;
+    }
+}
+
+static bool controls_in_effect(const rpi_controls_t &c, const rpi_frame_meta_t &m);
+
+/* Keep the slot if it shows the next bracket of a running burst, with a
+ * reference for the rpi_camera_capture_burst() caller; frame worker only */
+static void collect_bracket(rpi_camera_t *cam, FrameSlot *slot) {
+    BurstCapture &burst = cam->burst;
+    std::lock_guard<std::mutex> lk(burst.mtx);
+    if (burst.state != BURST_RUNNING || (!burst.armed && !slot->bracket))
+        return;
+    burst.armed = true;
+    if (!controls_in_effect(burst.brackets[burst.slots.size()], slot->meta))
+        return;
+
+    slot->refs.fetch_add(1, std::memory_order_relaxed);
+    burst.slots.push_back(slot);
+    if (burst.slots.size() == burst.brackets.size()) {
+        burst.state = BURST_READY;
+        burst.active.store(false, std::memory_order_relaxed);
+        burst.cv.notify_all();
+    }
+}
+
+/* The request carrying the still failed; its caller gets -EIO */
+static void fail_still(rpi_camera_t *cam) {
+    StillCapture &still = cam->still;
+    std::lock_guard<std::mutex> lk(still.mtx);
+    if (still.state == STILL_INFLIGHT) {
+        still.state = STILL_READY;
+        still.error = -EIO;
+        still.cv.notify_all();
+    } else if (still.state == STILL_ABANDONED) {
+        still.state = STILL_IDLE;
+    }
+}
+
+/* Fan a completed slot out to every subscriber */
+static void dispatch_slot(rpi_camera_t *cam, FrameSlot *slot) {
+    /* Hold one reference across the walk so an early release by a fast
+     * consumer cannot requeue the slot before every queue has it */
+    slot->refs.store(1, std::memory_order_relaxed);
+    cam->dispatching.fetch_add(1, std::memory_order_seq_cst);
+
+    for (auto &entry : cam->subs) {
+        rpi_subscriber_t *sub = entry.load(std::memory_order_seq_cst);
+        if (!sub)
+            continue;
+
+        slot->refs.fetch_add(1, std::memory_order_relaxed);
+        /* Whatever the overflow policy rejects loses this queue's reference */
+        FrameSlot *rejected = sub->pipeline.push(slot);
+        if (rejected) {
+            /* DROP_NEWEST hands back the frame just offered, the evicting
+             * policies the oldest queued one */
+            stat_add(rejected == slot ? cam->stats.dropped_newest : cam->stats.dropped_oldest);
+            unref_slot(rejected);
+            stat_add(cam->stats.dropped_pipeline);
+        }
+
+        uint32_t depth = (uint32_t)sub->pipeline.occupancy();
+        if (depth > cam->stats.high_water.load(std::memory_order_relaxed))
+            cam->stats.high_water.store(depth, std::memory_order_relaxed);
+    }
+
+    cam->dispatching.fetch_sub(1, std::memory_order_seq_cst);
+    if (slot->mapped[RPI_STREAM_STILL])
+        hand_over_still(cam, slot);
+    if (cam->burst.active.load(std::memory_order_acquire))
+        collect_bracket(cam, slot);
+    unref_slot(slot);
+}
+
+/* API for user zero-copy with timeout (timeout_ms < 0 blocks) */
+int rpi_camera_acquire_frame_timeout(rpi_camera_t *cam, rpi_frame_t *out,
+                                     int timeout_ms) {
+    if (!cam || !out || !cam->default_sub) return -1;
+
+    FramePipeline<FrameSlot *> *pipeline = default_pipeline(cam);
+    if (!pipeline) return -ENOSPC;
+
+    FrameSlot *slot;
+    int ret = pipeline->pop(slot, timeout_ms);
+    if (ret)
+        return ret;
+
+    return lease_slot(slot, RPI_STREAM_MAIN, out);
+}
+
+/* API for user zero-copy blocking */
+int rpi_camera_acquire_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    return rpi_camera_acquire_frame_timeout(cam, out, -1);
+}
+
+/* API for user zero-copy non-blocking */
+int rpi_camera_try_acquire_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    if (!cam || !out || !cam->default_sub) return -1;
+
+    FramePipeline<FrameSlot *> *pipeline = default_pipeline(cam);
+    if (!pipeline) return -ENOSPC;
+
+    FrameSlot *slot;
+    if (!pipeline->try_pop(slot))
         return -EAGAIN;
 
-    out->size = f.data.size();
-    out->data = (uint8_t *)malloc(out->size);
-    memcpy(out->data, f.data.data(), out->size);
+    return lease_slot(slot, RPI_STREAM_MAIN, out);
+}
+
+/* API for user: additional consumer with its own queue */
+rpi_subscriber_t *rpi_camera_subscribe(rpi_camera_t *cam, unsigned int queue_depth,
+                                       rpi_overflow_policy_t policy) {
+    return rpi_camera_subscribe_stream(cam, RPI_STREAM_MAIN, queue_depth, policy);
+}
+
+/* API for user: consumer of one stream, e.g. the analysis stream */
+rpi_subscriber_t *rpi_camera_subscribe_stream(rpi_camera_t *cam, rpi_stream_t stream,
+                                              unsigned int queue_depth,
+                                              rpi_overflow_policy_t policy) {
+    if (!cam || !queue_depth || stream < 0 || stream >= RPI_STREAM_COUNT)
+        return nullptr;
+    if (stream == RPI_STREAM_ANALYSIS && !cam->analysis_stream) {
+        LOG_ERROR("Analysis stream not configured");
+        return nullptr;
+    }
+    if (stream == RPI_STREAM_STILL) {
+        LOG_ERROR("Stills come from rpi_camera_capture_still()");
+        return nullptr;
+    }
+
+    rpi_subscriber_t *sub = new rpi_subscriber_t(cam, queue_depth, policy, stream);
+    if (attach_subscriber(cam, sub) < 0) {
+        LOG_ERROR("Too many subscribers");
+        delete sub;
+        return nullptr;
+    }
+    return sub;
+}
+
+void rpi_camera_unsubscribe(rpi_subscriber_t *sub) {
+    if (!sub) return;
+
+    sub->pipeline.stop();
+    detach_subscriber(sub->cam, sub);
+    delete sub;
+}
+
+int rpi_subscriber_acquire_frame(rpi_subscriber_t *sub, rpi_frame_t *out,
+                                 int timeout_ms) {
+    if (!sub || !out) return -1;
+
+    FrameSlot *slot;
+    int ret = sub->pipeline.pop(slot, timeout_ms);
+    if (ret)
+        return ret;
+
+    return lease_slot(slot, sub->stream, out);
+}
 
-    out->timestamp = f.timestamp;
-    out->sequence  = f.sequence;
+int rpi_subscriber_try_acquire_frame(rpi_subscriber_t *sub, rpi_frame_t *out) {
+    if (!sub || !out) return -1;
 
+    FrameSlot *slot;
+    if (!sub->pipeline.try_pop(slot))
+        return -EAGAIN;
+
+    return lease_slot(slot, sub->stream, out);
+}
+
+int rpi_subscriber_get_fd(rpi_subscriber_t *sub) {
+    if (!sub) return -1;
+    return sub->pipeline.fd();
+}
+
+/* libcamera stream behind one of ours, null if it is not configured */
+static Stream *stream_of(rpi_camera_t *cam, rpi_stream_t stream) {
+    switch (stream) {
+        case RPI_STREAM_MAIN:     return cam->stream;
+        case RPI_STREAM_ANALYSIS: return cam->analysis_stream;
+        case RPI_STREAM_STILL:    return cam->still.stream;
+        default:                  return nullptr;
+    }
+}
+
+int rpi_camera_get_format_name(rpi_camera_t *cam, rpi_stream_t stream,
+                               char *buf, size_t len) {
+    if (!cam || !buf || !len || stream < 0 || stream >= RPI_STREAM_COUNT)
+        return -EINVAL;
+    Stream *s = stream_of(cam, stream);
+    if (!s)
+        return -ENODEV;
+
+    snprintf(buf, len, "%s", s->configuration().pixelFormat.toString().c_str());
+    return 0;
+}
+
+int rpi_camera_get_stream_size(rpi_camera_t *cam, rpi_stream_t stream,
+                               int *width, int *height) {
+    if (!cam || stream < 0 || stream >= RPI_STREAM_COUNT) return -EINVAL;
+    /* The still buffer is in no slot until a capture asks for it */
+    const MappedBuffer *mb = stream == RPI_STREAM_STILL ? cam->still.mapped
+                             : cam->slots.empty()       ? nullptr
+                                                        : cam->slots[0].mapped[stream];
+    if (!mb) return -ENODEV;
+
+    if (width) *width = mb->width;
+    if (height) *height = mb->height;
+    return 0;
+}
+
+/* Convert a lease into a pool buffer in the output format */
+static int convert_leased_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    rpi_frame_t lease = *out;
+    rpi_format_t fmt = cam->format;
+    size_t total = pixconv_frame_size(fmt, lease.width, lease.height);
+
+    PoolBuffer *pb = total <= cam->pool.buffer_size() ? cam->pool.get() : nullptr;
+    void *dst = pb ? pb->data : malloc(total);
+    if (!dst) {
+        rpi_camera_release_frame(&lease);
+        return -ENOMEM;
+    }
+
+    pixconv_frame_init(out, fmt, lease.width, lease.height, dst, total);
+    int ret = pixconv_convert(&lease, out, cam->matrix);
+    out->priv = pb ? static_cast<FrameOwner *>(pb) : NULL;
+    rpi_camera_release_frame(&lease);
+
+    if (ret)
+        rpi_camera_release_frame(out);
+    return ret;
+}
+
+/* Turn a lease into a private heap copy (compatibility path). Planes are
+ * packed row by row so stride padding is not copied. */
+static int copy_leased_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    if (cam->format != out->format)
+        return convert_leased_frame(cam, out);
+
+    rpi_frame_t lease = *out;
+
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    uint32_t strides[RPI_FRAME_MAX_PLANES];
+    uint32_t n = plane_layout(lease.format, lease.width, lease.height, cam->stride,
+                              row_bytes, rows, strides);
+
+    size_t total = 0;
+    for (uint32_t i = 0; i < n; i++)
+        total += (size_t)row_bytes[i] * rows[i];
+
+    /* Pool buffer in steady state; heap only if the user holds them all */
+    PoolBuffer *pb = total <= cam->pool.buffer_size() ? cam->pool.get() : nullptr;
+    uint8_t *dst = pb ? pb->data : (uint8_t *)malloc(total);
+    if (!dst) {
+        rpi_camera_release_frame(&lease);
+        return -ENOMEM;
+    }
+
+    out->data = dst;
+    out->size = total;
+    for (uint32_t i = 0; i < n; i++) {
+        const uint8_t *src = (const uint8_t *)lease.planes[i].data;
+        rpi_plane_t &plane = out->planes[i];
+
+        plane.data = dst;
+        plane.stride = row_bytes[i];
+        plane.size = (size_t)row_bytes[i] * rows[i];
+        plane.offset = dst - (uint8_t *)out->data;
+
+        if (lease.planes[i].stride == row_bytes[i]) {
+            memcpy(dst, src, plane.size);
+        } else {
+            for (uint32_t r = 0; r < rows[i]; r++)
+                memcpy(dst + (size_t)r * row_bytes[i],
+                       src + (size_t)r * lease.planes[i].stride, row_bytes[i]);
+        }
+        dst += plane.size;
+    }
+    out->priv = pb ? static_cast<FrameOwner *>(pb) : NULL;
+
+    rpi_camera_release_frame(&lease);
     return 0;
 }
 
+/* API for user with timeout (timeout_ms < 0 blocks) */
+int rpi_camera_get_frame_timeout(rpi_camera_t *cam, rpi_frame_t *out,
+                                 int timeout_ms) {
+    if (cam && out && cam->jpeg)
+        return cam->jpeg->get(out, timeout_ms);
+
+    int ret = rpi_camera_acquire_frame_timeout(cam, out, timeout_ms);
+    if (ret)
+        return ret;
+
+    return copy_leased_frame(cam, out);
+}
+
+/* API for user blocking */
+int rpi_camera_get_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    return rpi_camera_get_frame_timeout(cam, out, -1);
+}
+
+/* API for user event loop: readable while a frame is ready */
+int rpi_camera_get_fd(rpi_camera_t *cam) {
+    if (!cam || !cam->default_sub) return -1;
+    if (cam->jpeg)
+        return cam->jpeg->fd();
+    FramePipeline<FrameSlot *> *pipeline = default_pipeline(cam);
+    return pipeline ? pipeline->fd() : -ENOSPC;
+}
+
+/* API for user non-blocking */
+int rpi_camera_try_get_frame(rpi_camera_t *cam, rpi_frame_t *out) {
+    if (cam && out && cam->jpeg)
+        return cam->jpeg->try_get(out);
+
+    int ret = rpi_camera_try_acquire_frame(cam, out);
+    if (ret)
+        return ret;
+
+    return copy_leased_frame(cam, out);
+}
+
+/* Lease return: the last holder gives the buffer back to the sensor */
+void FrameSlot::release() {
+    unref_slot(this);
+}
+
 /* API for user free frame */
 void rpi_camera_release_frame(rpi_frame_t *f) {
     if (!f) return;
-    free(f->data);
+
+    if (f->priv)
+        ((FrameOwner *)f->priv)->release();
+    else
+        free(f->data);
+
     f->data = NULL;
+    f->priv = NULL;
+}
+
+int rpi_frame_get_jpeg_info(const rpi_frame_t *f, rpi_jpeg_info_t *info) {
+    if (!f || !info || !f->priv || f->format != RPI_FMT_MJPEG) return -EINVAL;
+
+    const JpegFrame *jf = dynamic_cast<const JpegFrame *>((FrameOwner *)f->priv);
+    if (!jf) return -EINVAL;
+
+    info->encode_ns = jf->encode_ns;
+    info->worker = jf->worker;
+    info->quality = jf->enc->quality();
+    return 0;
 }
 
 // Chuyển đổi format
@@ -172,200 +1021,721 @@ static PixelFormat to_libcamera_format(rpi_format_t fmt) {
             return formats::YUV420;
         case RPI_FMT_RGB888:
             return formats::RGB888;
-        case RPI_FMT_MJPEG:
-            // return formats::MJPEG;
-            std::cerr << "[WARN] MJPEG not supported by libcamera, using YUYV" << std::endl;
-            return formats::YUYV;  // or YUV420
+        case RPI_FMT_RAW10:
+            return formats::SBGGR10_CSI2P; /* order fixed up by pick_raw_format() */
+        case RPI_FMT_RAW12:
+            return formats::SBGGR12_CSI2P;
+        case RPI_FMT_NV12:
+            return formats::NV12;
+        case RPI_FMT_YUYV:
+            return formats::YUYV;
+        case RPI_FMT_MJPEG: /* no hardware JPEG output, see JpegEncoder */
+            return formats::YUV420;
         default:
             return formats::YUV420;
     }
 }
 
-// Request completion handler
+static bool from_libcamera_format(const PixelFormat &pf, rpi_format_t *fmt) {
+    if (pf == formats::YUV420)      *fmt = RPI_FMT_YUV420;
+    else if (pf == formats::NV12)   *fmt = RPI_FMT_NV12;
+    else if (pf == formats::YUYV)   *fmt = RPI_FMT_YUYV;
+    else if (pf == formats::RGB888) *fmt = RPI_FMT_RGB888;
+    else return false;
+    return true;
+}
+
+/* Formats the ISP cannot write are captured as YUV420 and converted on the
+ * copy path; MJPEG frames are encoded from YUV420 planes as they are */
+static rpi_format_t capture_format_for(rpi_format_t fmt) {
+    switch (fmt) {
+        case RPI_FMT_BGRA:
+        case RPI_FMT_GRAY8:
+        case RPI_FMT_MJPEG:
+            return RPI_FMT_YUV420;
+        default:
+            return fmt;
+    }
+}
+
+static pixconv_matrix_t matrix_for(const StreamConfiguration &sc) {
+    if (!sc.colorSpace)
+        return PIXCONV_BT601;
+    if (sc.colorSpace->ycbcrEncoding == ColorSpace::YcbcrEncoding::Rec709)
+        return PIXCONV_BT709;
+    if (sc.colorSpace->range == ColorSpace::Range::Full)
+        return PIXCONV_JPEG;
+    return PIXCONV_BT601;
+}
+
+static bool is_raw_format(rpi_format_t fmt) {
+    return fmt == RPI_FMT_RAW10 || fmt == RPI_FMT_RAW12;
+}
+
+/* The Bayer order belongs to the sensor: take whichever packed CSI-2 format
+ * of the wanted depth the raw stream offers */
+static PixelFormat pick_raw_format(const StreamConfiguration &sc, rpi_format_t fmt) {
+    const std::string suffix = fmt == RPI_FMT_RAW12 ? "12_CSI2P" : "10_CSI2P";
+    auto matches = [&](const PixelFormat &pf) {
+        std::string name = pf.toString();
+        return name.size() > suffix.size() &&
+               name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if (matches(sc.pixelFormat))
+        return sc.pixelFormat;
+    for (const PixelFormat &pf : sc.formats().pixelformats()) {
+        if (matches(pf))
+            return pf;
+    }
+    return to_libcamera_format(fmt);
+}
+
+/* Whether the frame shows the queued exposure and gain; the sensor rounds
+ * exposure to whole lines and gain to its register steps */
+static bool controls_in_effect(const rpi_controls_t &c, const rpi_frame_meta_t &m) {
+    if ((c.set & RPI_CTRL_EXPOSURE) && (m.valid & RPI_META_EXPOSURE)) {
+        int tolerance = std::max(c.exposure_us / 50, 100);
+        if (std::abs(m.exposure_us - c.exposure_us) > tolerance)
+            return false;
+    }
+    if ((c.set & RPI_CTRL_GAIN) && (m.valid & RPI_META_ANALOGUE_GAIN)) {
+        if (std::fabs(m.analogue_gain - c.analogue_gain) > c.analogue_gain * 0.05f)
+            return false;
+    }
+    return true;
+}
+
+/* Fill the slot's metadata from its completed request. Runs on the
+ * frame worker, which owns the ctrl_awaiting state. */
+static void read_metadata(rpi_camera_t *cam, FrameSlot *slot, const ControlList &md) {
+    rpi_frame_meta_t &m = slot->meta;
+    memset(&m, 0, sizeof(m));
+
+    if (auto v = md.get(controls::ExposureTime)) {
+        m.exposure_us = *v;
+        m.valid |= RPI_META_EXPOSURE;
+    }
+    if (auto v = md.get(controls::AnalogueGain)) {
+        m.analogue_gain = *v;
+        m.valid |= RPI_META_ANALOGUE_GAIN;
+    }
+    if (auto v = md.get(controls::ColourTemperature)) {
+        m.colour_temperature = *v;
+        m.valid |= RPI_META_COLOUR_TEMPERATURE;
+    }
+    if (auto v = md.get(controls::Lux)) {
+        m.lux = *v;
+        m.valid |= RPI_META_LUX;
+    }
+    if (auto v = md.get(controls::SensorTimestamp)) {
+        m.sensor_timestamp = *v;
+        m.valid |= RPI_META_SENSOR_TIMESTAMP;
+    }
+    if (auto v = md.get(controls::FrameDuration)) {
+        m.frame_duration_us = *v;
+        m.valid |= RPI_META_FRAME_DURATION;
+    }
+
+    /* A newer batch takes over the wait; targets it does not set still
+     * have to show up */
+    m.control_ticket = slot->ctrl_ticket;
+    if (slot->ctrl_ticket) {
+        merge_controls(cam->ctrl_awaiting, slot->ctrl);
+        cam->ctrl_awaiting_ticket = slot->ctrl_ticket;
+    }
+    if (cam->ctrl_awaiting_ticket && controls_in_effect(cam->ctrl_awaiting, m)) {
+        cam->ctrl_applied_ticket = cam->ctrl_awaiting_ticket;
+        cam->ctrl_awaiting_ticket = 0;
+        cam->ctrl_awaiting.set = 0;
+    }
+    m.applied_ticket = cam->ctrl_applied_ticket;
+}
+
+/* Completion-side counters: sequence gaps and how long the frame took to
+ * come back from the sensor */
+static void record_completion(rpi_camera_t *cam, FrameSlot *slot) {
+    CameraStats &st = cam->stats;
+
+    stat_add(st.completed);
+    if (!st.have_sequence && slot->complete_ns > st.start_ns) {
+        uint64_t ttff = slot->complete_ns - st.start_ns;
+        st.first_frame_ns.store(ttff, std::memory_order_relaxed);
+        if (!cam->startup.first_frame_ns.load(std::memory_order_relaxed))
+            cam->startup.first_frame_ns.store(ttff, std::memory_order_relaxed);
+    }
+    slot->gap = 0;
+    if (st.have_sequence && slot->sequence - st.last_sequence > 1) {
+        slot->gap = slot->sequence - st.last_sequence - 1;
+        stat_add(st.dropped_sensor, slot->gap);
+    }
+    /* The larger frame can cost video on either side of it */
+    if (slot->mapped[RPI_STREAM_STILL]) {
+        stat_add(st.stills);
+        stat_add(st.still_video_lost, slot->gap);
+        st.after_still = true;
+    } else if (st.after_still) {
+        stat_add(st.still_video_lost, slot->gap);
+        st.after_still = false;
+    }
+    st.last_sequence = slot->sequence;
+    st.have_sequence = true;
+
+    /* SensorTimestamp is CLOCK_BOOTTIME, the buffer timestamp MONOTONIC;
+     * the hand-over to this thread is not part of it */
+    uint64_t start, now;
+    if (slot->meta.valid & RPI_META_SENSOR_TIMESTAMP) {
+        start = (uint64_t)slot->meta.sensor_timestamp;
+        now = clock_ns(CLOCK_BOOTTIME) - (clock_ns(CLOCK_MONOTONIC) - slot->complete_ns);
+    } else {
+        start = slot->timestamp;
+        now = slot->complete_ns;
+    }
+    if (now >= start)
+        stat_add(st.sensor_to_complete[latency_bucket(now - start)]);
+}
+
+/* Everything a completed request needs before its consumers see it */
+static void process_slot(rpi_camera_t *cam, FrameSlot *slot) {
+    Request *request = slot->request;
+
+    LOG_DEBUG("Request completed! Status: %d Sequence: %u", (int)request->status(),
+              request->sequence());
+
+    /* Nothing to deliver: the request goes straight back, and the next
+     * frame's sequence gap counts the loss */
+    FrameBuffer *buffer = request->findBuffer(cam->stream);
+    if (!buffer || buffer->metadata().status == FrameMetadata::FrameError) {
+        LOG_WARN_RATELIMIT(1000, "Request %u: %s", request->sequence(),
+                           buffer ? "frame error" : "no main-stream buffer");
+        if (slot->mapped[RPI_STREAM_STILL])
+            fail_still(cam);
+        requeue_slot(slot);
+        return;
+    }
+
+    const FrameMetadata &metadata = buffer->metadata();
+    slot->timestamp = metadata.timestamp;
+    slot->sequence  = metadata.sequence;
+    read_metadata(cam, slot, request->metadata());
+    record_completion(cam, slot);
+
+    /* Only the slot pointer is queued; the buffer is already mapped */
+    dispatch_slot(cam, slot);
+}
+
+static void frame_worker(rpi_camera_t *cam) {
+    FrameSlot *slot;
+    while (cam->completed->pop(slot, -1) == 0)
+        process_slot(cam, slot);
+}
+
+/* Pin and prioritise the frame worker as configured. Failures only warn:
+ * SCHED_FIFO needs CAP_SYS_NICE or an rtprio limit. */
+static void tune_worker(rpi_camera_t *cam) {
+    pthread_t t = cam->capture_thread.native_handle();
+    pthread_setname_np(t, "rpicam-frames");
+
+    if (cam->worker_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cam->worker_cpu, &set);
+        int ret = pthread_setaffinity_np(t, sizeof(set), &set);
+        if (ret)
+            LOG_WARN("Cannot pin frame worker to CPU %d: %s", cam->worker_cpu, strerror(ret));
+    }
+    if (cam->worker_priority > 0) {
+        struct sched_param sp = {};
+        sp.sched_priority = std::min(cam->worker_priority, sched_get_priority_max(SCHED_FIFO));
+        int ret = pthread_setschedparam(t, SCHED_FIFO, &sp);
+        if (ret)
+            LOG_WARN("Cannot give frame worker SCHED_FIFO %d: %s", sp.sched_priority,
+                     strerror(ret));
+    }
+}
+
+/* Request completion handler. Runs on libcamera's event thread, which
+ * delivers every other completion too, so it only queues the slot. */
 static void request_complete(Request *request) {
     if (request->status() == Request::RequestCancelled)
     {
-        std::cout << "[DEBUG] Request cancelled. Cookie: " << request->cookie() << std::endl;
+        LOG_DEBUG("Request cancelled. Cookie: %#llx", (unsigned long long)request->cookie());
         return;
     }
 
-    // Get camera from global map using cookie
-     uint64_t cookie = request->cookie();
-     auto it = g_camera_map.find(cookie);
-     if (it == g_camera_map.end()) {
-         std::cerr << "Camera not found for cookie: " << cookie << std::endl;
-         return;
-     }
+    /* The cookie is the request's own slot, which knows its camera */
+    FrameSlot *slot = reinterpret_cast<FrameSlot *>(request->cookie());
+    slot->complete_ns = clock_ns(CLOCK_MONOTONIC);
+
+    /* Sized for every slot, so never full */
+    FrameSlot *rejected = slot->cam->completed->push(slot);
+    if (rejected)
+        requeue_slot(rejected);
+}
 
-     std::cout << "[DEBUG] Request completed! Status: " << request->status() 
-              << " Cookie: " << request->cookie() << std::endl;
+// extern "C" {
 
-     rpi_camera_t *cam = it->second;
-     FramePipeline *pipeline = cam->pipeline.get();
+int rpi_camera_capture_still(rpi_camera_t *cam, rpi_frame_t *out, int timeout_ms,
+                             rpi_still_info_t *info) {
+    if (!cam || !out) return -EINVAL;
+
+    StillCapture &still = cam->still;
+    if (!still.stream) return -ENODEV;
+
+    std::unique_lock<std::mutex> lk(still.mtx);
+    if (!cam->running) return -EAGAIN;
+    if (still.state != STILL_IDLE || still.attached.load(std::memory_order_acquire))
+        return -EBUSY;
+
+    uint64_t t0 = clock_ns(CLOCK_MONOTONIC);
+    still.state = STILL_PENDING;
+    still.slot = nullptr;
+    still.error = 0;
+    still.wanted.store(true, std::memory_order_release);
+
+    auto ready = [&] { return still.state == STILL_READY; };
+    if (timeout_ms < 0)
+        still.cv.wait(lk, ready);
+    else if (!still.cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready)) {
+        /* Not taken yet: withdraw it. Taken: the slot goes round without us. */
+        if (still.state == STILL_PENDING && still.wanted.exchange(false))
+            still.state = STILL_IDLE;
+        else
+            still.state = STILL_ABANDONED;
+        return -ETIMEDOUT;
+    }
 
-    const Request::BufferMap &buffers = request->buffers();
-    
-    for (auto bufferPair : buffers) {
-        FrameBuffer *buffer = bufferPair.second;
-        const FrameMetadata &metadata = buffer->metadata();
-        
-        // Lấy dữ liệu frame
-        const std::vector<FrameBuffer::Plane> &planes = buffer->planes();
-        
-        if (!planes.empty()) {
-            void *data = mmap(NULL, planes[0].length, PROT_READ, 
-                            MAP_SHARED, planes[0].fd.get(), 0);
-            
-            if (data != MAP_FAILED) {
-                rpi_frame_t frame;
-                frame.data = data;
-                frame.size = planes[0].length;
-                frame.timestamp = metadata.timestamp;
-                frame.sequence = metadata.sequence;
-                
-                /* -------- COPY FRAME -------- */
-                InternalFrame copy;
-                copy.timestamp = metadata.timestamp;
-                copy.sequence  = metadata.sequence;
-
-                size_t total_size = 0;
-                for (const auto &p : planes)
-                    total_size += p.length;
-
-                copy.data.resize(total_size);
-
-                uint8_t *dst = copy.data.data();
-                size_t offset = 0;
-
-                for (const auto &p : planes) {
-                    void *src = mmap(NULL, p.length, PROT_READ,
-                                    MAP_SHARED, p.fd.get(), 0);
-                    if (src == MAP_FAILED) {
-                        std::cerr << "mmap failed\n";
-                        continue;
-                    }
-
-                    memcpy(dst + offset, src, p.length);
-                    offset += p.length;
-
-                    munmap(src, p.length);
-                }
+    still.state = STILL_IDLE;
+    FrameSlot *slot = still.slot;
+    still.slot = nullptr;
+    if (still.error)
+        return still.error;
+    lk.unlock();
 
-                pipeline->push(std::move(copy));
-                
-                munmap(data, planes[0].length);
-            }
-        }
+    if (info) {
+        info->latency_ns = clock_ns(CLOCK_MONOTONIC) - t0;
+        info->video_frames_lost = slot->gap;
     }
-    
-    // Requeue request nếu vẫn đang chạy
-    if (cam->running) {
-        request->reuse(Request::ReuseBuffers);
-        cam->camera->queueRequest(request);
+    return lease_slot(slot, RPI_STREAM_STILL, out);
+}
+
+int rpi_camera_get_stats(rpi_camera_t *cam, rpi_camera_stats_t *stats) {
+    if (!cam || !stats) return -EINVAL;
+
+    const CameraStats &st = cam->stats;
+    const auto rd = std::memory_order_relaxed;
+    memset(stats, 0, sizeof(*stats));
+    stats->frames_completed = st.completed.load(rd);
+    stats->frames_delivered = st.delivered.load(rd);
+    stats->dropped_pipeline = st.dropped_pipeline.load(rd);
+    stats->dropped_newest = st.dropped_newest.load(rd);
+    stats->dropped_oldest = st.dropped_oldest.load(rd);
+    if (cam->jpeg) {
+        stats->dropped_pipeline += cam->jpeg->dropped();
+        stats->dropped_newest += cam->jpeg->dropped_newest();
+        stats->dropped_oldest += cam->jpeg->dropped_oldest();
+    }
+    stats->dropped_sensor = st.dropped_sensor.load(rd);
+    stats->queue_high_water = st.high_water.load(rd);
+    stats->start_to_first_frame_ns = st.first_frame_ns.load(rd);
+    stats->stills = st.stills.load(rd);
+    stats->still_video_lost = st.still_video_lost.load(rd);
+    for (int i = 0; i < RPI_STATS_LATENCY_BUCKETS; i++) {
+        stats->sensor_to_complete[i] = st.sensor_to_complete[i].load(rd);
+        stats->complete_to_consumer[i] = st.complete_to_consumer[i].load(rd);
     }
+
+    instrument_counts_t calls;
+    stats->instrumented = instrument_read(&calls);
+    stats->allocs = calls.allocs;
+    stats->frees = calls.frees;
+    stats->mmaps = calls.mmaps;
+    stats->munmaps = calls.munmaps;
+    stats->ioctls = calls.ioctls;
+    return 0;
 }
 
-// extern "C" {
+int rpi_camera_get_startup(rpi_camera_t *cam, rpi_camera_startup_t *out) {
+    if (!cam || !out) return -EINVAL;
+
+    const StartupTiming &t = cam->startup;
+    out->manager_ns = t.manager_ns;
+    out->acquire_ns = t.acquire_ns;
+    out->configure_ns = t.configure_ns;
+    out->allocate_ns = t.allocate_ns;
+    out->first_frame_ns = t.first_frame_ns.load(std::memory_order_relaxed);
+    return 0;
+}
 
 void WaitForFirstFrame(rpi_camera_t *cam) {
-    int max_wait = 1000; // 1 second
-    int waited = 0;
-    rpi_frame_t dummy;
-    while (rpi_camera_try_get_frame(cam, &dummy) != 0 && waited < max_wait) {
-        usleep(10000); // 10ms
-        waited += 10;
-    }
-    if (waited >= max_wait) {
-        printf("[ERROR]: No frames received after 1 second!\n");
+    if (!cam || !cam->default_sub) return;
+
+    /* Sleep on the frame eventfd; the frame stays queued for the caller */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    FramePipeline<FrameSlot *> *pipeline = cam->jpeg ? nullptr : default_pipeline(cam);
+    if (!cam->jpeg && !pipeline) return;
+    int ret = cam->jpeg ? cam->jpeg->wait_ready(1000) // 1 second
+                        : pipeline->wait_ready(1000);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    if (ret) {
+        LOG_ERROR("No frames received after 1 second!");
+    } else {
+        long waited = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+        LOG_INFO("First frame received after %ldms", waited);
+    }
+}
+
+void rpi_camera_config_init(rpi_camera_config_t *cfg, int width, int height,
+                            rpi_format_t format) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->width = width;
+    cfg->height = height;
+    cfg->format = format;
+    cfg->pool_buffers = RPI_CAMERA_DEFAULT_POOL_BUFFERS;
+    cfg->pool_lock = 0;
+    cfg->overflow_policy = RPI_OVERFLOW_DROP_NEWEST;
+    cfg->buffer_count = 0;
+    cfg->queue_depth = RPI_CAMERA_DEFAULT_QUEUE_DEPTH;
+    cfg->frame_duration_min_us = 0;
+    cfg->frame_duration_max_us = 0;
+    cfg->camera_index = 0;
+    cfg->camera_id = NULL;
+    cfg->analysis_width = 0;
+    cfg->analysis_height = 0;
+    cfg->analysis_format = RPI_FMT_YUV420;
+    cfg->still_width = 0;
+    cfg->still_height = 0;
+    cfg->still_format = RPI_FMT_YUV420;
+    cfg->jpeg_quality = RPI_CAMERA_DEFAULT_JPEG_QUALITY;
+    cfg->jpeg_workers = RPI_CAMERA_DEFAULT_JPEG_WORKERS;
+    cfg->worker_cpu = -1;
+    cfg->worker_priority = 0;
+}
+
+int rpi_camera_count(void) {
+    CameraManager *cm = camera_manager_get();
+    if (!cm) return -ENODEV;
+    int n = (int)cm->cameras().size();
+    camera_manager_put();
+    return n;
+}
+
+int rpi_camera_get_id(int index, char *buf, size_t len) {
+    if (!buf || !len) return -EINVAL;
+    CameraManager *cm = camera_manager_get();
+    if (!cm) return -ENODEV;
+    std::vector<std::shared_ptr<Camera>> cameras = cm->cameras();
+    int ret = -ENOENT;
+    if (index >= 0 && (size_t)index < cameras.size()) {
+        snprintf(buf, len, "%s", cameras[index]->id().c_str());
+        ret = 0;
+    }
+    camera_manager_put();
+    return ret;
+}
+
+static void prewarm_at_exit() {
+    rpi_camera_prewarm_release();
+}
+
+void rpi_camera_prewarm(void) {
+    static std::once_flag at_exit;
+    std::call_once(at_exit, [] { atexit(prewarm_at_exit); });
+
+    std::thread previous;
+    {
+        std::lock_guard<std::mutex> lk(g_cm_mtx);
+        if (g_prewarm != PREWARM_NONE)
+            return;
+        g_prewarm = PREWARM_PENDING;
+        previous = std::move(g_prewarm_thread);
+        g_prewarm_thread = std::thread(prewarm_thread);
+    }
+    /* One released while it started may still be handing its reference back */
+    if (previous.joinable())
+        previous.join();
+}
+
+void rpi_camera_prewarm_release(void) {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> lk(g_cm_mtx);
+        if (g_prewarm == PREWARM_HELD)
+            camera_manager_put_locked();
+        g_prewarm = PREWARM_NONE;
+        thread = std::move(g_prewarm_thread);
+    }
+    /* Outside g_cm_mtx, which the thread takes once the manager is up */
+    if (thread.joinable())
+        thread.join();
+}
+
+int rpi_camera_config_profile(rpi_camera_config_t *cfg, const char *profile) {
+    if (!cfg || !profile) return -EINVAL;
+
+    if (strcmp(profile, "default") == 0) {
+        cfg->buffer_count = 0;
+        cfg->queue_depth = RPI_CAMERA_DEFAULT_QUEUE_DEPTH;
+        cfg->overflow_policy = RPI_OVERFLOW_DROP_NEWEST;
+        cfg->frame_duration_min_us = 0;
+        cfg->frame_duration_max_us = 0;
+    } else if (strcmp(profile, "low-latency") == 0) {
+        /* One frame being filled, one with the consumer: nothing queues */
+        cfg->buffer_count = 2;
+        cfg->queue_depth = 1;
+        cfg->overflow_policy = RPI_OVERFLOW_LATEST;
+        cfg->frame_duration_min_us = 1000000 / CAMERA_FRAME_RATE;
+        cfg->frame_duration_max_us = cfg->frame_duration_min_us;
+    } else if (strcmp(profile, "throughput") == 0) {
+        cfg->buffer_count = 6;
+        cfg->queue_depth = 16;
+        cfg->overflow_policy = RPI_OVERFLOW_DROP_NEWEST;
+        cfg->frame_duration_min_us = 0;
+        cfg->frame_duration_max_us = 0;
     } else {
-        printf("[INFO]: First frame received after %dms\n", waited);
-        rpi_camera_release_frame(&dummy);
+        return -EINVAL;
     }
+    return 0;
+}
+
+/* One request per slot, made once per camera */
+static int rpi_camera_create_requests(rpi_camera_t *cam)
+{
+    for (size_t i = 0; i < cam->buffers.size(); i++) {
+        FrameBuffer *buffer = cam->buffers[i];
+        /* Cookie = the slot, so completion needs no lookup */
+        std::unique_ptr<Request> req =
+            cam->camera->createRequest(reinterpret_cast<uint64_t>(&cam->slots[i]));
+
+        if (!req)
+        {
+            LOG_ERROR("Failed to create request");
+            return -1;
+        }
+
+        if (req->addBuffer(cam->stream, buffer) < 0)
+        {
+            LOG_ERROR("Failed to add buffer to request");
+            return -1;
+        }
+
+        if (cam->analysis_stream &&
+            req->addBuffer(cam->analysis_stream, cam->analysis_buffers[i]) < 0)
+        {
+            LOG_ERROR("Failed to add analysis buffer to request");
+            return -1;
+        }
+
+        cam->slots[i].request = req.get();
+        cam->requests.push_back(std::move(req));
+    }
+
+    return 0;
 }
 
 rpi_camera_t* rpi_camera_create(int width, int height, rpi_format_t format) {
+    rpi_camera_config_t cfg;
+    rpi_camera_config_init(&cfg, width, height, format);
+    return rpi_camera_create_ex(&cfg);
+}
+
+rpi_camera_t* rpi_camera_create_ex(const rpi_camera_config_t *cfg) {
+    if (!cfg) return nullptr;
+
+    int width = cfg->width;
+    int height = cfg->height;
     rpi_camera_t *cam = new rpi_camera_t();
     cam->width = width;
     cam->height = height;
-    cam->format = format;
+    cam->format = cfg->format;
+    cam->capture_format = capture_format_for(cfg->format);
+    cam->matrix = PIXCONV_BT601;
     cam->running = false;
     cam->allocator = nullptr;
-    cam->cookie = g_next_cookie++; // Assign unique cookie
-    cam->pipeline = std::make_unique<FramePipeline>(4); // Example queue 4 frame
+    cam->cm = nullptr;
+    cam->stream = nullptr;
+    cam->analysis_stream = nullptr;
+    cam->default_sub = std::make_unique<rpi_subscriber_t>(
+        cam, cfg->queue_depth ? cfg->queue_depth : RPI_CAMERA_DEFAULT_QUEUE_DEPTH,
+        cfg->overflow_policy);
+    cam->frame_duration[0] = cfg->frame_duration_min_us;
+    cam->frame_duration[1] = cfg->frame_duration_max_us;
+    cam->worker_cpu = cfg->worker_cpu;
+    cam->worker_priority = cfg->worker_priority;
+    cam->default_attached = false;
+    for (auto &entry : cam->subs)
+        entry.store(nullptr, std::memory_order_relaxed);
+    cam->dispatching = 0;
     cam->signal_connected = false;
-
-    // Register in global map
-    g_camera_map[cam->cookie] = cam;
-
-    // Khởi tạo CameraManager
-    cam->cm = std::make_unique<CameraManager>();
-    int ret = cam->cm->start();
-    if (ret) {
-        std::cerr << "Failed to start camera manager" << std::endl;
+    memset(&cam->ctrl_pending, 0, sizeof(cam->ctrl_pending));
+    memset(&cam->ctrl_awaiting, 0, sizeof(cam->ctrl_awaiting));
+    cam->ctrl_ticket = 0;
+    cam->ctrl_dirty = false;
+    cam->ctrl_awaiting_ticket = 0;
+    cam->ctrl_applied_ticket = 0;
+
+    // Khởi tạo CameraManager (shared)
+    uint64_t t0 = clock_ns(CLOCK_MONOTONIC);
+    cam->cm = camera_manager_get();
+    if (!cam->cm) {
         delete cam;
         return nullptr;
     }
+    uint64_t t1 = clock_ns(CLOCK_MONOTONIC);
+    cam->startup.manager_ns = t1 - t0;
     
-    // Tìm camera
-    if (cam->cm->cameras().empty()) {
-        std::cerr << "No cameras available" << std::endl;
-        delete cam;
+    // Tìm camera: by id if given, else by index
+    std::shared_ptr<Camera> camera;
+    if (cfg->camera_id && cfg->camera_id[0]) {
+        camera = cam->cm->get(cfg->camera_id);
+    } else {
+        std::vector<std::shared_ptr<Camera>> cameras = cam->cm->cameras();
+        if (cfg->camera_index >= 0 && (size_t)cfg->camera_index < cameras.size())
+            camera = cameras[cfg->camera_index];
+    }
+    if (!camera) {
+        LOG_ERROR("No camera available");
+        rpi_camera_destroy(cam);
         return nullptr;
     }
     
-    cam->camera = cam->cm->cameras()[0];
-    ret = cam->camera->acquire();
+    int ret = camera->acquire();
     if (ret) {
-        std::cerr << "Failed to acquire camera" << std::endl;
-        delete cam;
+        LOG_ERROR("Failed to acquire camera");
+        rpi_camera_destroy(cam);
         return nullptr;
     }
-    else {
-        std::cout << "Find camera: " << cam->camera->id() << std::endl;
-    }
+    cam->camera = camera;
+    LOG_INFO("Find camera: %s", cam->camera->id().c_str());
+    t0 = t1;
+    t1 = clock_ns(CLOCK_MONOTONIC);
+    cam->startup.acquire_ns = t1 - t0;
     
     // Cấu hình camera
-    cam->config = cam->camera->generateConfiguration({StreamRole::VideoRecording}); /* StillCapture | Raw | Viewfinder | VideoRecording */
+    /* The analysis stream is a second ISP output of the same request; the
+     * still stream is configured up front but only in the requests that
+     * rpi_camera_capture_still() asks for */
+    bool analysis = cfg->analysis_width > 0 && cfg->analysis_height > 0;
+    bool still = cfg->still_width > 0 && cfg->still_height > 0;
+    bool raw = is_raw_format(cfg->format);
+    std::vector<StreamRole> roles = { raw ? StreamRole::Raw : StreamRole::VideoRecording }; /* StillCapture | Raw | Viewfinder | VideoRecording */
+    if (analysis)
+        roles.push_back(StreamRole::Viewfinder);
+    if (still)
+        roles.push_back(StreamRole::StillCapture);
+    cam->config = cam->camera->generateConfiguration(roles);
+    if (!cam->config || cam->config->size() != roles.size()) {
+        LOG_ERROR("Camera cannot provide the requested streams");
+        rpi_camera_destroy(cam);
+        return nullptr;
+    }
     StreamConfiguration &streamConfig = cam->config->at(0);
     
     streamConfig.size.width = width;
     streamConfig.size.height = height;
-    streamConfig.pixelFormat = to_libcamera_format(format);
+    if (cfg->buffer_count)
+        streamConfig.bufferCount = cfg->buffer_count;
+    streamConfig.pixelFormat = raw ? pick_raw_format(streamConfig, cfg->format)
+                                   : to_libcamera_format(cam->capture_format);
+    /* JFIF expects full-range YCbCr */
+    if (cfg->format == RPI_FMT_MJPEG)
+        streamConfig.colorSpace = ColorSpace::Sycc;
+
+    if (analysis) {
+        StreamConfiguration &analysisConfig = cam->config->at(1);
+        analysisConfig.size.width = cfg->analysis_width;
+        analysisConfig.size.height = cfg->analysis_height;
+        if (is_raw_format(cfg->analysis_format)) {
+            LOG_ERROR("Analysis stream cannot be raw");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        analysisConfig.pixelFormat = to_libcamera_format(capture_format_for(cfg->analysis_format));
+    }
+    if (still) {
+        StreamConfiguration &stillConfig = cam->config->at(roles.size() - 1);
+        stillConfig.size.width = cfg->still_width;
+        stillConfig.size.height = cfg->still_height;
+        stillConfig.bufferCount = 1;
+        if (is_raw_format(cfg->still_format)) {
+            LOG_ERROR("Still stream cannot be raw");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        stillConfig.pixelFormat = to_libcamera_format(capture_format_for(cfg->still_format));
+    }
     
     CameraConfiguration::Status validation = cam->config->validate();
     if (validation == CameraConfiguration::Invalid) {
-        std::cerr << "[ERROR]: Camera configuration invalid" << std::endl;
-        delete cam;
+        LOG_ERROR("Camera configuration invalid");
+        rpi_camera_destroy(cam);
         return nullptr;
     }
     else if (validation == CameraConfiguration::Adjusted) {
-        std::cout << "[INFO]: Camera configuration adjusted by libcamera!" << std::endl;
+        LOG_INFO("Camera configuration adjusted by libcamera!");
     }
     else {
-        std::cout<< "[INFO]: Camera config validate!" << std::endl;
+        LOG_INFO("Camera config validate!");
+    }
+
+    /* Validation may swap in an unpacked Bayer layout we cannot describe */
+    if (raw && streamConfig.pixelFormat.toString().find("_CSI2P") == std::string::npos) {
+        LOG_ERROR("Sensor has no packed raw format of that depth");
+        rpi_camera_destroy(cam);
+        return nullptr;
+    }
+    /* ...or a different YUV/RGB layout: frames carry what was negotiated */
+    rpi_format_t analysis_format = RPI_FMT_YUV420;
+    rpi_format_t still_format = RPI_FMT_YUV420;
+    if ((!raw && !from_libcamera_format(streamConfig.pixelFormat, &cam->capture_format)) ||
+        (analysis && !from_libcamera_format(cam->config->at(1).pixelFormat, &analysis_format)) ||
+        (still && !from_libcamera_format(cam->config->at(roles.size() - 1).pixelFormat,
+                                         &still_format))) {
+        LOG_ERROR("Unsupported pixel format after validation");
+        rpi_camera_destroy(cam);
+        return nullptr;
     }
+    cam->matrix = matrix_for(streamConfig);
+    if (cfg->format == RPI_FMT_MJPEG && cam->matrix != PIXCONV_JPEG)
+        LOG_WARN("MJPEG from limited-range YUV, colours will look flat");
     
     ret = cam->camera->configure(cam->config.get());
     if (ret) {
-        std::cerr << "[ERROR]: Failed to configure camera" << std::endl;
-        delete cam;
+        LOG_ERROR("Failed to configure camera");
+        rpi_camera_destroy(cam);
         return nullptr;
     }
     else {
-        std::cout<< "[INFO]: Camera configuration!" << std::endl;
+        LOG_INFO("Camera configuration!");
     }
+    t0 = t1;
+    t1 = clock_ns(CLOCK_MONOTONIC);
+    cam->startup.configure_ns = t1 - t0;
     
     // Allocate buffers
     cam->allocator = std::make_unique<FrameBufferAllocator>(cam->camera);
     Stream *stream = streamConfig.stream();
     ret = cam->allocator->allocate(stream);
     if (ret < 0) {
-        std::cerr << "Failed to allocate buffers" << std::endl;
-        delete cam;
+        LOG_ERROR("Failed to allocate buffers");
+        rpi_camera_destroy(cam);
         return nullptr;
     }
     else {
-        std::cout<<"[INFO]: Allocate buffers...!\n" << std::endl;
+        LOG_INFO("Allocate buffers...!");
+    }
+    if (analysis) {
+        cam->analysis_stream = cam->config->at(1).stream();
+        if (cam->allocator->allocate(cam->analysis_stream) < 0) {
+            LOG_ERROR("Failed to allocate analysis buffers");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        for (const auto &b : cam->allocator->buffers(cam->analysis_stream))
+            cam->analysis_buffers.push_back(b.get());
     }
     
     // Tạo requests
@@ -375,115 +1745,282 @@ rpi_camera_t* rpi_camera_create(int width, int height, rpi_format_t format) {
     {
         cam->buffers.push_back(b.get());
     }
-    
-    std::cout << "Camera created: " << width << "x" << height << std::endl;
-    return cam;
-}
+    /* Map every buffer once; frames are read through these mappings.
+     * One slot per request, so both streams need a buffer for each. */
+    cam->width = streamConfig.size.width;
+    cam->height = streamConfig.size.height;
+    cam->stride = streamConfig.stride;
+    size_t num_slots = cam->buffers.size();
+    if (analysis)
+        num_slots = std::min(num_slots, cam->analysis_buffers.size());
+    cam->buffers.resize(num_slots);
+    cam->slots = std::vector<FrameSlot>(num_slots);
+    cam->completed = std::make_unique<FramePipeline<FrameSlot *>>(num_slots,
+                                                                  RPI_OVERFLOW_DROP_NEWEST);
+    for (size_t i = 0; i < num_slots; i++) {
+        FrameSlot &slot = cam->slots[i];
+        slot.cam = cam;
+        for (auto &m : slot.mapped)
+            m = nullptr;
+
+        MappedBuffer &mb = cam->mappings[cam->buffers[i]];
+        if (map_buffer(cam->buffers[i], streamConfig, cam->capture_format, mb) < 0) {
+            LOG_ERROR("Failed to map buffers");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        slot.mapped[RPI_STREAM_MAIN] = &mb;
+
+        if (analysis) {
+            MappedBuffer &amb = cam->mappings[cam->analysis_buffers[i]];
+            if (map_buffer(cam->analysis_buffers[i], cam->config->at(1),
+                           analysis_format, amb) < 0) {
+                LOG_ERROR("Failed to map analysis buffers");
+                rpi_camera_destroy(cam);
+                return nullptr;
+            }
+            slot.mapped[RPI_STREAM_ANALYSIS] = &amb;
+        }
+    }
+    if (analysis)
+        LOG_INFO("Analysis stream %ux%u", cam->config->at(1).size.width,
+                 cam->config->at(1).size.height);
+
+    /* One still buffer, mapped like the rest; no slot holds it yet */
+    if (still) {
+        StreamConfiguration &stillConfig = cam->config->at(roles.size() - 1);
+        cam->still.stream = stillConfig.stream();
+        if (cam->allocator->allocate(cam->still.stream) < 0 ||
+            cam->allocator->buffers(cam->still.stream).empty()) {
+            LOG_ERROR("Failed to allocate still buffer");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        cam->still.buffer = cam->allocator->buffers(cam->still.stream)[0].get();
+        MappedBuffer &smb = cam->mappings[cam->still.buffer];
+        if (map_buffer(cam->still.buffer, stillConfig, still_format, smb) < 0) {
+            LOG_ERROR("Failed to map still buffer");
+            rpi_camera_destroy(cam);
+            return nullptr;
+        }
+        cam->still.mapped = &smb;
+        LOG_INFO("Still stream %ux%u", stillConfig.size.width, stillConfig.size.height);
+    }
 
-int rpi_camera_create_requests(rpi_camera_t *cam)
-{
-    cam->requests.clear();
+    /* Requests live as long as the buffers; start() only requeues them */
+    if (rpi_camera_create_requests(cam) < 0) {
+        rpi_camera_destroy(cam);
+        return nullptr;
+    }
 
-    for (auto &buffer : cam->buffers) {
-        std::unique_ptr<Request> req =
-            cam->camera->createRequest(cam->cookie);
+    /* Copy-path buffers sized from the negotiated frame */
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    uint32_t strides[RPI_FRAME_MAX_PLANES];
+    uint32_t n = plane_layout(cam->capture_format, cam->width, cam->height, cam->stride,
+                              row_bytes, rows, strides);
+    size_t packed_size = 0;
+    for (uint32_t i = 0; i < n; i++)
+        packed_size += (size_t)row_bytes[i] * rows[i];
+    packed_size = std::max(packed_size,
+                           pixconv_frame_size(cam->format, cam->width, cam->height));
+    size_t frame_size = std::max<size_t>(streamConfig.frameSize, packed_size);
+    /* MJPEG get_frame() hands out the encoder's buffers instead */
+    if (cfg->pool_buffers && cam->format != RPI_FMT_MJPEG &&
+        cam->pool.init(cfg->pool_buffers, frame_size, cfg->pool_lock) < 0) {
+        LOG_ERROR("Failed to allocate frame pool");
+        rpi_camera_destroy(cam);
+        return nullptr;
+    }
 
-        if (!req)
-        {
-            std::cerr << "Failed to create request" << std::endl;
-            return -1;
+    if (cam->format == RPI_FMT_MJPEG) {
+        JpegEncoder::Config jc;
+        jc.width = cam->width;
+        jc.height = cam->height;
+        jc.input_format = cam->capture_format;
+        jc.quality = cfg->jpeg_quality;
+        jc.workers = cfg->jpeg_workers ? cfg->jpeg_workers : RPI_CAMERA_DEFAULT_JPEG_WORKERS;
+        jc.out_buffers = cfg->pool_buffers ? cfg->pool_buffers : 1;
+        jc.policy = cfg->overflow_policy;
+        jc.lock = cfg->pool_lock;
+
+        /* Mailbox input: while every worker is busy only the newest frame
+         * waits, so encoding never holds more than workers + 1 buffers */
+        rpi_subscriber_t *in = rpi_camera_subscribe(cam, 1, RPI_OVERFLOW_LATEST);
+        cam->jpeg = std::make_unique<JpegEncoder>();
+        if (cam->jpeg->init(in, jc) < 0) {
+            LOG_ERROR("Failed to set up JPEG encoder");
+            rpi_camera_destroy(cam);
+            return nullptr;
         }
+    }
+    cam->startup.allocate_ns = clock_ns(CLOCK_MONOTONIC) - t1;
+    
+    LOG_INFO("Camera created: %dx%d", width, height);
+    LOG_INFO("Startup: manager %.1f ms, acquire %.1f ms, configure %.1f ms, allocate %.1f ms",
+             cam->startup.manager_ns / 1e6, cam->startup.acquire_ns / 1e6,
+             cam->startup.configure_ns / 1e6, cam->startup.allocate_ns / 1e6);
+    return cam;
+}
 
-        if (req->addBuffer(cam->stream, buffer) < 0)
-        {
-            std::cerr << "Failed to add buffer to request" << std::endl;
-            return -1;
+/* Tear down what rpi_camera_start() set up. 'started' tells whether the
+ * camera itself got as far as streaming. */
+static void stop_streaming(rpi_camera_t *cam, bool started) {
+    /* No completion requeues from here on */
+    cam->running = false;
+    /* Stop camera first (stop producing frames) */
+    if (started)
+        cam->camera->stop();
+    /* The worker hands out what already completed, then exits */
+    cam->completed->stop();
+    if (cam->capture_thread.joinable())
+        cam->capture_thread.join();
+    /* Stop pipelines to unblock get_frame(); what they still queue are
+     * their references to drop */
+    for_each_subscriber(cam, [](rpi_subscriber_t *sub) {
+        sub->pipeline.stop();
+        sub->pipeline.discard(unref_slot);
+    });
+    /* Encoder workers see their input stopped; wait until they let go of
+     * the frames they hold */
+    if (cam->jpeg)
+        cam->jpeg->stop();
+
+    /* Frames the user still holds stay valid; their slots wait out of the
+     * sensor queue until released. Requests, mappings and the pool stay for
+     * the next start. */
+
+    /* A pending still or burst will not come now; drop what was kept for it */
+    std::vector<FrameSlot *> kept;
+    {
+        StillCapture &still = cam->still;
+        std::lock_guard<std::mutex> lk(still.mtx);
+        still.wanted.store(false, std::memory_order_relaxed);
+        if (still.state == STILL_ABANDONED) {
+            still.state = STILL_IDLE;
+        } else if (still.state != STILL_IDLE) {
+            if (still.slot)
+                kept.push_back(still.slot);
+            still.state = STILL_READY;
+            still.slot = nullptr;
+            still.error = -EPIPE;
+            still.cv.notify_all();
         }
-
-        cam->requests.push_back(std::move(req));
     }
-
-    return 0;
+    {
+        BurstCapture &burst = cam->burst;
+        std::lock_guard<std::mutex> lk(burst.mtx);
+        burst.active.store(false, std::memory_order_relaxed);
+        burst.to_send.store(0, std::memory_order_relaxed);
+        if (burst.state == BURST_RUNNING) {
+            kept.insert(kept.end(), burst.slots.begin(), burst.slots.end());
+            burst.state = BURST_READY;
+            burst.slots.clear();
+            burst.error = -EPIPE;
+            burst.cv.notify_all();
+        }
+    }
+    for (FrameSlot *slot : kept)
+        unref_slot(slot);
 }
 
 int rpi_camera_start(rpi_camera_t *cam) {
-    if (!cam || !cam->camera || !cam->pipeline) {
-        std::cout<<"[ERROR]: NULL ptr...!"<<std::endl;
+    if (!cam || !cam->camera || !cam->default_sub) {
+        LOG_ERROR("NULL ptr...!");
         return -1;
     }
     
     if (cam->running) {
-        std::cout<<"[INFO]: Camera still running...!"<<std::endl;
+        LOG_INFO("Camera still running...!");
         return 0;
     }
 
     int ret = 0;
+    /* Time to first frame counts from here, see record_completion() */
+    cam->stats.start_ns = clock_ns(CLOCK_MONOTONIC);
+    cam->stats.first_frame_ns.store(0, std::memory_order_relaxed);
 
-    cam->requests.clear();
-    
     // Connect request completion signal
-     if (rpi_camera_create_requests(cam) < 0) {
-        std::cerr << "Failed to create requests" << std::endl;
-        return -1;
-    }
-
     if (!cam->signal_connected) {
         cam->camera->requestCompleted.connect(request_complete);
         cam->signal_connected = true;
     }
     
-    cam->pipeline->reset();
+    /* Hold every slot until the queueing below; a frame still leased from
+     * the last run keeps its slot until released, see unref_slot() */
+    for (auto &slot : cam->slots)
+        slot.refs.fetch_add(1, std::memory_order_acq_rel);
+    /* The sensor restarts its count; that is not a gap */
+    cam->stats.have_sequence = false;
+    cam->stats.after_still = false;
+    for_each_subscriber(cam, [](rpi_subscriber_t *sub) { sub->pipeline.reset(); });
+
+    cam->completed->reset();
+    cam->capture_thread = std::thread(frame_worker, cam);
+    tune_worker(cam);
 
     cam->running = true;
+    if (cam->jpeg)
+        cam->jpeg->start();
 
     // Start camera
-    ret = cam->camera->start();
+    /* Frame rate from the first frame on, not from the first request */
+    ControlList start_controls;
+    if (cam->frame_duration[0] > 0 || cam->frame_duration[1] > 0) {
+        int64_t lo = cam->frame_duration[0], hi = cam->frame_duration[1];
+        start_controls.set(controls::FrameDurationLimits,
+                           Span<const int64_t, 2>({ lo ? lo : hi, hi ? hi : lo }));
+    }
+    ret = cam->camera->start(&start_controls);
     if (ret) {
-        std::cerr << "Failed to start camera" << std::endl;
+        LOG_ERROR("Failed to start camera");
+        for (auto &slot : cam->slots)
+            slot.refs.fetch_sub(1, std::memory_order_acq_rel);
+        stop_streaming(cam, false);
         return -1;
     }
     else {
-        std::cout<<"[INFO]: Camera Start...!"<<std::endl;
+        LOG_INFO("Camera Start...!");
     }
 
-    // Queue all requests
-    for (std::unique_ptr<Request> &request : cam->requests) {
-        ret = cam->camera->queueRequest(request.get());
+    // Queue all requests; controls queued while stopped ride on the first.
+    // They come back from the last run completed or cancelled: reuse()
+    // keeps their buffers, so a restart allocates and maps nothing.
+    for (size_t i = 0; i < cam->slots.size(); i++) {
+        FrameSlot &slot = cam->slots[i];
+        /* Still leased: the release queues it */
+        if (slot.refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            continue;
+        prepare_request(cam, &slot);
+        attach_controls(cam, &slot);
+        ret = queue_slot(cam, &slot);
         if (ret < 0) {
-            std::cerr << "[ERROR]: Failed to queue request" << std::endl;
+            LOG_ERROR("Failed to queue request");
+            /* Slots not reached yet still carry the hold */
+            for (size_t j = i + 1; j < cam->slots.size(); j++)
+                cam->slots[j].refs.fetch_sub(1, std::memory_order_acq_rel);
+            stop_streaming(cam, true);
             return -1;
         }
     }
 
-    std::cout << "[INFO]: Camera started...!" << std::endl;
+    LOG_INFO("Camera started...!");
     return 0;
 }
 
 int rpi_camera_stop(rpi_camera_t *cam) {
     if (!cam || !cam->camera) {
-        std::cout<<"[ERROR]: NULL ptr...!"<<std::endl;
+        LOG_ERROR("NULL ptr...!");
         return -1;
     }
 
     if (!cam->running) {
-        std::cout<<"[INFO]: Camera has not been running...!"<<std::endl;
+        LOG_INFO("Camera has not been running...!");
         return 0;
     }
-    
-    cam->running = false;
-    /* Stop camera first (stop producing frames) */
-    cam->camera->stop();
-    /* Stop pipeline to unblock get_frame() */
-    if (cam->pipeline) {
-        cam->pipeline->stop();
-        cam->pipeline->reset();
-    }
 
-    /* Destroy requests after stop */
-    cam->requests.clear();
-    cam->running = false;
+    stop_streaming(cam, true);
 
-    std::cout << "[INFO]: Camera stopped" << std::endl;
+    LOG_INFO("Camera stopped");
     return 0;
 }
 
@@ -493,120 +2030,183 @@ void rpi_camera_destroy(rpi_camera_t *cam) {
     if (cam->running) {
         rpi_camera_stop(cam);
     }
-    /* 2. Ensure pipeline stopped */
-    if (cam->pipeline) {
-        cam->pipeline->stop();
-        cam->pipeline.reset();
+    /* 2. Ensure pipelines stopped, free subscribers the user left */
+    cam->jpeg.reset(); /* unsubscribes its input */
+    for (auto &entry : cam->subs) {
+        rpi_subscriber_t *sub = entry.exchange(nullptr);
+        if (sub && sub != cam->default_sub.get())
+            delete sub;
     }
-    /* 3. Join capture thread (if you really use it) */
+    cam->default_sub.reset();
+    /* 3. Join the frame worker (stop already did unless start failed) */
+    if (cam->completed)
+        cam->completed->stop();
     if(cam->capture_thread.joinable()) {
         cam->capture_thread.join();
     }
     /* 4. Clear requests (release FrameBuffer refs) */
     cam->requests.clear();
-    /* 5. Delete allocator (owns buffers)*/
+    /* 5. Unmap and delete allocator (owns buffers)*/
+    unmap_buffers(cam);
     cam->allocator.reset();
 
-    /* 6. Remove from global map */
-    g_camera_map.erase(cam->cookie);
-    /* 7. Release camera */
+    /* 6. Release camera; it outlives us while the manager is shared */
     if(cam->camera) {
+        if (cam->signal_connected)
+            cam->camera->requestCompleted.disconnect(request_complete);
         cam->camera->release();
         cam->camera.reset();
     }
-    /* 8. Stop manager*/
+    /* 7. Drop our use of the shared manager */
     if(cam->cm) {
-        cam->cm->stop();
-        cam->cm.reset();
+        camera_manager_put();
+        cam->cm = nullptr;
     }
-    /* 9. Delete cam */
+    /* 8. Delete cam */
     delete cam;
 }
 
 // Các hàm cấu hình nâng cao
-static float clamp(float v, float min, float max) {
-    return std::max(min, std::min(v, max));
+/* Clamp to the camera's range, if it publishes one */
+template <typename T>
+static T clamp_control(rpi_camera_t *cam, const Control<T> &id, T value, const char *name) {
+    const ControlInfoMap &infos = cam->camera->controls();
+    auto it = infos.find(&id);
+    if (it == infos.end())
+        return value;
+
+    T v = std::max(it->second.min().template get<T>(),
+                   std::min(value, it->second.max().template get<T>()));
+    if (v != value)
+        LOG_WARN("%s %s out of range, clamped to %s", name, std::to_string(value).c_str(),
+                 std::to_string(v).c_str());
+    return v;
 }
 
-static int clamp_int(int v, int min, int max) {
-    return std::max(min, std::min(v, max));
+/* Clamp 'c' to what the camera supports; -EINVAL if it cannot be applied */
+static int check_controls(rpi_camera_t *cam, rpi_controls_t &c) {
+    if (c.set & RPI_CTRL_BRIGHTNESS)
+        c.brightness = clamp_control(cam, controls::Brightness, c.brightness, "Brightness");
+    if (c.set & RPI_CTRL_CONTRAST)
+        c.contrast = clamp_control(cam, controls::Contrast, c.contrast, "Contrast");
+    if (c.set & RPI_CTRL_EXPOSURE)
+        c.exposure_us = clamp_control(cam, controls::ExposureTime, (int32_t)c.exposure_us,
+                                      "Exposure");
+    if (c.set & RPI_CTRL_GAIN)
+        c.analogue_gain = clamp_control(cam, controls::AnalogueGain, c.analogue_gain, "Gain");
+    if ((c.set & RPI_CTRL_FRAME_DURATION) &&
+        (c.frame_duration_min_us <= 0 || c.frame_duration_max_us < c.frame_duration_min_us))
+        return -EINVAL;
+    return 0;
 }
 
-int rpi_camera_set_brightness(rpi_camera_t *cam, float value) {
-    if (!cam) return -EINVAL;
-    
-    auto &info = cam->camera->controls().at(&controls::Brightness);
-    float v = clamp(value, info.min().get<float>(), info.max().get<float>());
+int rpi_camera_queue_controls(rpi_camera_t *cam, const rpi_controls_t *ctrls,
+                              uint64_t *ticket) {
+    if (!cam || !cam->camera || !ctrls) return -EINVAL;
 
-    if (v != value) {
-        fprintf(stderr,
-            "[WARN] Brightness %.2f out of range, clamped to %.2f\n",
-            value, v);
-    }
+    rpi_controls_t c = *ctrls;
+    if (check_controls(cam, c) < 0)
+        return -EINVAL;
 
-    // Create a request and add controls
-    for (auto &req : cam->requests) {
-        req->controls().set(controls::Brightness, v);
-    }
-    
+    std::lock_guard<std::mutex> lk(cam->ctrl_mtx);
+    merge_controls(cam->ctrl_pending, c);
+    cam->ctrl_ticket++;
+    cam->ctrl_dirty.store(true, std::memory_order_release);
+    if (ticket)
+        *ticket = cam->ctrl_ticket;
     return 0;
 }
 
-int rpi_camera_set_contrast(rpi_camera_t *cam, float value) {
-    if (!cam) return -EINVAL;
-    
-    auto &info = cam->camera->controls().at(&controls::Contrast);
-    float v = clamp(value, info.min().get<float>(), info.max().get<float>());
+int rpi_camera_capture_burst(rpi_camera_t *cam, const rpi_controls_t *brackets,
+                             unsigned int count, rpi_frame_t *frames, int timeout_ms) {
+    if (!cam || !cam->camera || !brackets || !frames || !count) return -EINVAL;
+    /* Kept frames are out of circulation; two more keep the sensor fed */
+    if (count + 2 > cam->slots.size()) {
+        LOG_ERROR("Burst of %u needs buffer_count >= %u", count, count + 2);
+        return -EINVAL;
+    }
 
-    if (v != value) {
-        fprintf(stderr,
-            "[WARN] Contrast %.2f out of range, clamped to %.2f\n",
-            value, v);
+    std::vector<rpi_controls_t> checked(brackets, brackets + count);
+    for (rpi_controls_t &c : checked) {
+        if (check_controls(cam, c) < 0)
+            return -EINVAL;
     }
 
-    for (auto &req : cam->requests) {
-        req->controls().set(controls::Contrast, v);
+    BurstCapture &burst = cam->burst;
+    std::unique_lock<std::mutex> lk(burst.mtx);
+    if (!cam->running) return -EAGAIN;
+    if (burst.state != BURST_IDLE) return -EBUSY;
+
+    burst.brackets.swap(checked);
+    burst.sent = 0;
+    burst.armed = false;
+    burst.slots.clear();
+    burst.error = 0;
+    burst.state = BURST_RUNNING;
+    burst.active.store(true, std::memory_order_release);
+    burst.to_send.store(count, std::memory_order_release);
+
+    auto ready = [&] { return burst.state == BURST_READY; };
+    bool done = true;
+    if (timeout_ms < 0)
+        burst.cv.wait(lk, ready);
+    else
+        done = burst.cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), ready);
+
+    /* Whatever happened, the burst is over; frames kept so far are ours */
+    std::vector<FrameSlot *> kept;
+    kept.swap(burst.slots);
+    int ret = done ? burst.error : -ETIMEDOUT;
+    burst.state = BURST_IDLE;
+    burst.active.store(false, std::memory_order_relaxed);
+    burst.to_send.store(0, std::memory_order_relaxed);
+    lk.unlock();
+
+    /* Dropping a reference may requeue, which takes burst.mtx */
+    if (ret) {
+        for (FrameSlot *slot : kept)
+            unref_slot(slot);
+        return ret;
     }
-    
+    for (unsigned int i = 0; i < count; i++)
+        lease_slot(kept[i], RPI_STREAM_MAIN, &frames[i]);
     return 0;
 }
 
-int rpi_camera_set_exposure(rpi_camera_t *cam, int microseconds) {
-    if (!cam) return -EINVAL;
-    
-    auto &info = cam->camera->controls().at(&controls::ExposureTime);
-    int v = clamp_int(microseconds, info.min().get<int>(), info.max().get<int>());
+int rpi_camera_set_brightness(rpi_camera_t *cam, float value) {
+    rpi_controls_t c = {};
+    c.set = RPI_CTRL_BRIGHTNESS;
+    c.brightness = value;
+    return rpi_camera_queue_controls(cam, &c, NULL);
+}
 
-    if (v != microseconds) {
-        fprintf(stderr,
-            "[WARN] Exposure %d out of range, clamped to %d\n",
-            microseconds, v);
-    }
+int rpi_camera_set_contrast(rpi_camera_t *cam, float value) {
+    rpi_controls_t c = {};
+    c.set = RPI_CTRL_CONTRAST;
+    c.contrast = value;
+    return rpi_camera_queue_controls(cam, &c, NULL);
+}
 
-    for (auto &req : cam->requests) {
-        req->controls().set(controls::ExposureTime, v);
-    }
-    
-    return 0;
+int rpi_camera_set_exposure(rpi_camera_t *cam, int microseconds) {
+    rpi_controls_t c = {};
+    c.set = RPI_CTRL_EXPOSURE;
+    c.exposure_us = microseconds;
+    return rpi_camera_queue_controls(cam, &c, NULL);
 }
 
 int rpi_camera_set_gain(rpi_camera_t *cam, float value) {
-    if (!cam) return -EINVAL;
-    
-    auto &info = cam->camera->controls().at(&controls::AnalogueGain);
-    float v = clamp(value, info.min().get<float>(), info.max().get<float>());
+    rpi_controls_t c = {};
+    c.set = RPI_CTRL_GAIN;
+    c.analogue_gain = value;
+    return rpi_camera_queue_controls(cam, &c, NULL);
+}
 
-    if (v != value) {
-        fprintf(stderr,
-            "[WARN] Gain %.2f out of range, clamped to %.2f\n",
-            value, v);
-    }
+int rpi_camera_set_fps(rpi_camera_t *cam, float fps) {
+    if (fps <= 0) return -EINVAL;
 
-    for (auto &req : cam->requests) {
-        req->controls().set(controls::AnalogueGain, v);
-    }
-    
-    return 0;
+    rpi_controls_t c = {};
+    c.set = RPI_CTRL_FRAME_DURATION;
+    c.frame_duration_min_us = (int64_t)(1000000.0f / fps);
+    c.frame_duration_max_us = c.frame_duration_min_us;
+    return rpi_camera_queue_controls(cam, &c, NULL);
 }
-
-// } // extern "C"
\ No newline at end of file
@@ -0,0 +1,145 @@
+// ============================================================================
+// instrument.c - malloc/free and mmap/munmap/ioctl interposition counters
+// ============================================================================
+//
+// The definitions below take precedence over libc's for every object in the
+// process (the executable excepted), libstdc++'s operator new and libcamera
+// included. Each call bumps a relaxed atomic and forwards to libc. Calls libc
+// makes internally, such as malloc's own mmap, are not seen.
+
+#define _GNU_SOURCE
+#include "instrument.h"
+#include <string.h>
+
+#ifdef RPI_CAMERA_INSTRUMENT
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+static instrument_counts_t g_counts;
+
+#define COUNT(field) __atomic_fetch_add(&g_counts.field, 1, __ATOMIC_RELAXED)
+
+/* libc's allocator entry points; dlsym() itself allocates, so these are
+ * called directly instead of looked up */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    COUNT(allocs);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    COUNT(allocs);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    COUNT(allocs);
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t align, size_t size)
+{
+    COUNT(allocs);
+    return __libc_memalign(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+int posix_memalign(void **out, size_t align, size_t size)
+{
+    void *p = memalign(align, size);
+    if (!p)
+        return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+        COUNT(frees);
+    __libc_free(ptr);
+}
+
+/* The next definition of 'name', looked up on first use. Racing lookups
+ * store the same pointer. */
+static void *next_symbol(void **slot, const char *name)
+{
+    void *fn = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (!fn) {
+        fn = dlsym(RTLD_NEXT, name);
+        __atomic_store_n(slot, fn, __ATOMIC_RELEASE);
+    }
+    return fn;
+}
+
+static void *g_mmap, *g_mmap64, *g_munmap, *g_ioctl;
+
+void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+    COUNT(mmaps);
+    void *(*fn)(void *, size_t, int, int, int, off_t) = next_symbol(&g_mmap, "mmap");
+    return fn(addr, len, prot, flags, fd, off);
+}
+
+void *mmap64(void *addr, size_t len, int prot, int flags, int fd, off64_t off)
+{
+    COUNT(mmaps);
+    void *(*fn)(void *, size_t, int, int, int, off64_t) = next_symbol(&g_mmap64, "mmap64");
+    return fn(addr, len, prot, flags, fd, off);
+}
+
+int munmap(void *addr, size_t len)
+{
+    COUNT(munmaps);
+    int (*fn)(void *, size_t) = next_symbol(&g_munmap, "munmap");
+    return fn(addr, len);
+}
+
+/* Every ioctl argument is a pointer or fits in one */
+int ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    va_start(ap, request);
+    void *arg = va_arg(ap, void *);
+    va_end(ap);
+
+    COUNT(ioctls);
+    int (*fn)(int, unsigned long, ...) = next_symbol(&g_ioctl, "ioctl");
+    return fn(fd, request, arg);
+}
+
+int instrument_read(instrument_counts_t *c)
+{
+    c->allocs = __atomic_load_n(&g_counts.allocs, __ATOMIC_RELAXED);
+    c->frees = __atomic_load_n(&g_counts.frees, __ATOMIC_RELAXED);
+    c->mmaps = __atomic_load_n(&g_counts.mmaps, __ATOMIC_RELAXED);
+    c->munmaps = __atomic_load_n(&g_counts.munmaps, __ATOMIC_RELAXED);
+    c->ioctls = __atomic_load_n(&g_counts.ioctls, __ATOMIC_RELAXED);
+    return 1;
+}
+
+#else
+
+int instrument_read(instrument_counts_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    return 0;
+}
+
+#endif
@@ -0,0 +1,868 @@
+// ============================================================================
+// pixel_convert.c - YUV/RGB conversion (scalar, SSE2, AVX2, NEON)
+// ============================================================================
+
+#include "pixel_convert.h"
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__arm__))
+#include <arm_neon.h>
+#define PIXCONV_NEON 1
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define PIXCONV_X86 1
+#endif
+
+/* Q6 fixed-point YCbCr -> RGB. The vector kernels work in saturating 16-bit
+ * lanes; with these coefficients only the final value can leave the int16
+ * range, and then it clamps to 255 either way, so all kernels are
+ * bit-exact with the scalar reference. */
+typedef struct {
+    int16_t yoff, ygain, rv, gu, gv, bu;
+} yuv_coeffs;
+
+static const yuv_coeffs k_coeffs[] = {
+    [PIXCONV_BT601] = { 16, 75, 102, 25, 52, 129 },
+    [PIXCONV_BT709] = { 16, 75, 115, 14, 34, 135 },
+    [PIXCONV_JPEG]  = {  0, 64,  90, 22, 46, 113 },
+};
+
+/* Row kernels. Widths are in pixels; chroma rows have (w + 1) / 2 samples. */
+typedef struct {
+    pixconv_impl_t impl;
+    const char *name;
+    void (*interleave_uv)(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n);
+    void (*deinterleave_uv)(const uint8_t *uv, uint8_t *u, uint8_t *v, int n);
+    /* Two YUYV rows -> two Y rows and one averaged chroma row (w even) */
+    void (*yuyv_to_i420_row)(const uint8_t *r0, const uint8_t *r1, uint8_t *y0,
+                             uint8_t *y1, uint8_t *u, uint8_t *v, int w);
+    void (*yuyv_to_y_row)(const uint8_t *src, uint8_t *y, int w);
+    void (*yuv_to_bgr24_row)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                             uint8_t *dst, int w, const yuv_coeffs *c);
+    void (*yuv_to_bgra_row)(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                            uint8_t *dst, int w, const yuv_coeffs *c);
+} pixconv_kernels;
+
+// ============================================================================
+// Scalar reference
+// ============================================================================
+static inline uint8_t clamp8(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static void interleave_uv_c(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n)
+{
+    for (int i = 0; i < n; i++) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+static void deinterleave_uv_c(const uint8_t *uv, uint8_t *u, uint8_t *v, int n)
+{
+    for (int i = 0; i < n; i++) {
+        u[i] = uv[2 * i];
+        v[i] = uv[2 * i + 1];
+    }
+}
+
+static void yuyv_to_i420_row_c(const uint8_t *r0, const uint8_t *r1, uint8_t *y0,
+                               uint8_t *y1, uint8_t *u, uint8_t *v, int w)
+{
+    for (int x = 0; x + 1 < w; x += 2) {
+        const uint8_t *a = r0 + 2 * x, *b = r1 + 2 * x;
+        y0[x] = a[0];
+        y0[x + 1] = a[2];
+        y1[x] = b[0];
+        y1[x + 1] = b[2];
+        u[x / 2] = (uint8_t)((a[1] + b[1] + 1) >> 1);
+        v[x / 2] = (uint8_t)((a[3] + b[3] + 1) >> 1);
+    }
+}
+
+static void yuyv_to_y_row_c(const uint8_t *src, uint8_t *y, int w)
+{
+    for (int x = 0; x < w; x++)
+        y[x] = src[2 * x];
+}
+
+static inline void yuv_pixel(int y, int u, int v, const yuv_coeffs *c,
+                             uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    int yy = (y - c->yoff) * c->ygain;
+    int du = u - 128, dv = v - 128;
+    *r = clamp8((yy + c->rv * dv + 32) >> 6);
+    *g = clamp8((yy - c->gu * du - c->gv * dv + 32) >> 6);
+    *b = clamp8((yy + c->bu * du + 32) >> 6);
+}
+
+static void yuv_to_bgr24_row_c(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                               uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    for (int x = 0; x < w; x++, dst += 3)
+        yuv_pixel(y[x], u[x / 2], v[x / 2], c, &dst[2], &dst[1], &dst[0]);
+}
+
+static void yuv_to_bgra_row_c(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                              uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    for (int x = 0; x < w; x++, dst += 4) {
+        yuv_pixel(y[x], u[x / 2], v[x / 2], c, &dst[2], &dst[1], &dst[0]);
+        dst[3] = 255;
+    }
+}
+
+static const pixconv_kernels k_scalar = {
+    PIXCONV_IMPL_SCALAR, "scalar",
+    interleave_uv_c, deinterleave_uv_c, yuyv_to_i420_row_c, yuyv_to_y_row_c,
+    yuv_to_bgr24_row_c, yuv_to_bgra_row_c,
+};
+
+// ============================================================================
+// SSE2 / AVX2
+// ============================================================================
+#if PIXCONV_X86
+static void interleave_uv_sse2(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(u + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(v + i));
+        _mm_storeu_si128((__m128i *)(uv + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i *)(uv + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+    }
+    interleave_uv_c(u + i, v + i, uv + 2 * i, n - i);
+}
+
+static void deinterleave_uv_sse2(const uint8_t *uv, uint8_t *u, uint8_t *v, int n)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(uv + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(uv + 2 * i + 16));
+        _mm_storeu_si128((__m128i *)(u + i),
+                         _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo)));
+        _mm_storeu_si128((__m128i *)(v + i),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    deinterleave_uv_c(uv + 2 * i, u + i, v + i, n - i);
+}
+
+static void yuyv_to_i420_row_sse2(const uint8_t *r0, const uint8_t *r1, uint8_t *y0,
+                                  uint8_t *y1, uint8_t *u, uint8_t *v, int w)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(r0 + 2 * x));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(r0 + 2 * x + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(r1 + 2 * x));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(r1 + 2 * x + 16));
+
+        __m128i ca = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+        __m128i cb = _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8));
+        __m128i c = _mm_avg_epu8(ca, cb); /* U0 V0 U1 V1 ... */
+
+        _mm_storeu_si128((__m128i *)(y0 + x),
+                         _mm_packus_epi16(_mm_and_si128(a0, lo), _mm_and_si128(a1, lo)));
+        _mm_storeu_si128((__m128i *)(y1 + x),
+                         _mm_packus_epi16(_mm_and_si128(b0, lo), _mm_and_si128(b1, lo)));
+        _mm_storel_epi64((__m128i *)(u + x / 2), _mm_packus_epi16(_mm_and_si128(c, lo), zero));
+        _mm_storel_epi64((__m128i *)(v + x / 2), _mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+    }
+    yuyv_to_i420_row_c(r0 + 2 * x, r1 + 2 * x, y0 + x, y1 + x, u + x / 2, v + x / 2, w - x);
+}
+
+static void yuyv_to_y_row_sse2(const uint8_t *src, uint8_t *y, int w)
+{
+    const __m128i lo = _mm_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * x + 16));
+        _mm_storeu_si128((__m128i *)(y + x),
+                         _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo)));
+    }
+    yuyv_to_y_row_c(src + 2 * x, y + x, w - x);
+}
+
+/* 8 pixels in 16-bit lanes -> R, G, B in 16-bit lanes */
+static inline void yuv_to_rgb_sse2_8(__m128i y, __m128i u, __m128i v, const yuv_coeffs *c,
+                                     __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i bias = _mm_set1_epi16(128), round = _mm_set1_epi16(32);
+    __m128i yy = _mm_mullo_epi16(_mm_sub_epi16(y, _mm_set1_epi16(c->yoff)),
+                                 _mm_set1_epi16(c->ygain));
+    __m128i du = _mm_sub_epi16(u, bias), dv = _mm_sub_epi16(v, bias);
+
+    __m128i rr = _mm_adds_epi16(yy, _mm_mullo_epi16(dv, _mm_set1_epi16(c->rv)));
+    __m128i gg = _mm_subs_epi16(yy, _mm_mullo_epi16(du, _mm_set1_epi16(c->gu)));
+    gg = _mm_subs_epi16(gg, _mm_mullo_epi16(dv, _mm_set1_epi16(c->gv)));
+    __m128i bb = _mm_adds_epi16(yy, _mm_mullo_epi16(du, _mm_set1_epi16(c->bu)));
+
+    *r = _mm_srai_epi16(_mm_adds_epi16(rr, round), 6);
+    *g = _mm_srai_epi16(_mm_adds_epi16(gg, round), 6);
+    *b = _mm_srai_epi16(_mm_adds_epi16(bb, round), 6);
+}
+
+/* 16 pixels -> R, G, B bytes */
+static inline void yuv_to_rgb_sse2_16(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                      const yuv_coeffs *c, __m128i *R, __m128i *G, __m128i *B)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i yv = _mm_loadu_si128((const __m128i *)y);
+    __m128i uv = _mm_loadl_epi64((const __m128i *)u);
+    __m128i vv = _mm_loadl_epi64((const __m128i *)v);
+    uv = _mm_unpacklo_epi8(uv, uv); /* one chroma sample per pixel */
+    vv = _mm_unpacklo_epi8(vv, vv);
+
+    __m128i r0, g0, b0, r1, g1, b1;
+    yuv_to_rgb_sse2_8(_mm_unpacklo_epi8(yv, zero), _mm_unpacklo_epi8(uv, zero),
+                      _mm_unpacklo_epi8(vv, zero), c, &r0, &g0, &b0);
+    yuv_to_rgb_sse2_8(_mm_unpackhi_epi8(yv, zero), _mm_unpackhi_epi8(uv, zero),
+                      _mm_unpackhi_epi8(vv, zero), c, &r1, &g1, &b1);
+    *R = _mm_packus_epi16(r0, r1);
+    *G = _mm_packus_epi16(g0, g1);
+    *B = _mm_packus_epi16(b0, b1);
+}
+
+/* Four 32-bit BGRX pixels -> 12 BGR bytes in the low part of the register */
+static inline __m128i bgrx_to_bgr_sse2(__m128i p)
+{
+    __m128i a = _mm_and_si128(p, _mm_set1_epi64x(0xffffff));
+    __m128i b = _mm_and_si128(_mm_srli_epi64(p, 8), _mm_set1_epi64x(0xffffff000000LL));
+    __m128i q = _mm_or_si128(a, b); /* 6 bytes per 64-bit half */
+    __m128i hi = _mm_srli_si128(_mm_and_si128(q, _mm_set_epi64x(-1, 0)), 2);
+    return _mm_or_si128(_mm_and_si128(q, _mm_set_epi64x(0, -1)), hi);
+}
+
+static inline void store12(uint8_t *dst, __m128i v)
+{
+    uint32_t tail = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    _mm_storel_epi64((__m128i *)dst, v);
+    memcpy(dst + 8, &tail, 4);
+}
+
+static void yuv_to_bgr24_row_sse2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                  uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i R, G, B;
+        yuv_to_rgb_sse2_16(y + x, u + x / 2, v + x / 2, c, &R, &G, &B);
+
+        __m128i bg_lo = _mm_unpacklo_epi8(B, G), bg_hi = _mm_unpackhi_epi8(B, G);
+        __m128i rx_lo = _mm_unpacklo_epi8(R, zero), rx_hi = _mm_unpackhi_epi8(R, zero);
+        uint8_t *d = dst + 3 * x;
+        /* 16-byte stores overlap the next group; the last one is exact */
+        _mm_storeu_si128((__m128i *)d, bgrx_to_bgr_sse2(_mm_unpacklo_epi16(bg_lo, rx_lo)));
+        _mm_storeu_si128((__m128i *)(d + 12), bgrx_to_bgr_sse2(_mm_unpackhi_epi16(bg_lo, rx_lo)));
+        _mm_storeu_si128((__m128i *)(d + 24), bgrx_to_bgr_sse2(_mm_unpacklo_epi16(bg_hi, rx_hi)));
+        store12(d + 36, bgrx_to_bgr_sse2(_mm_unpackhi_epi16(bg_hi, rx_hi)));
+    }
+    yuv_to_bgr24_row_c(y + x, u + x / 2, v + x / 2, dst + 3 * x, w - x, c);
+}
+
+static void yuv_to_bgra_row_sse2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                 uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    const __m128i alpha = _mm_set1_epi8((char)0xff);
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i R, G, B;
+        yuv_to_rgb_sse2_16(y + x, u + x / 2, v + x / 2, c, &R, &G, &B);
+
+        __m128i bg_lo = _mm_unpacklo_epi8(B, G), bg_hi = _mm_unpackhi_epi8(B, G);
+        __m128i ra_lo = _mm_unpacklo_epi8(R, alpha), ra_hi = _mm_unpackhi_epi8(R, alpha);
+        __m128i *d = (__m128i *)(dst + 4 * x);
+        _mm_storeu_si128(d + 0, _mm_unpacklo_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(d + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+        _mm_storeu_si128(d + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+    }
+    yuv_to_bgra_row_c(y + x, u + x / 2, v + x / 2, dst + 4 * x, w - x, c);
+}
+
+static const pixconv_kernels k_sse2 = {
+    PIXCONV_IMPL_SSE2, "sse2",
+    interleave_uv_sse2, deinterleave_uv_sse2, yuyv_to_i420_row_sse2, yuyv_to_y_row_sse2,
+    yuv_to_bgr24_row_sse2, yuv_to_bgra_row_sse2,
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static void interleave_uv_avx2(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n)
+{
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(u + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(v + i));
+        __m256i lo = _mm256_unpacklo_epi8(a, b), hi = _mm256_unpackhi_epi8(a, b);
+        _mm256_storeu_si256((__m256i *)(uv + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(uv + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave_uv_sse2(u + i, v + i, uv + 2 * i, n - i);
+}
+
+AVX2 static void deinterleave_uv_avx2(const uint8_t *uv, uint8_t *u, uint8_t *v, int n)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(uv + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(uv + 2 * i + 32));
+        __m256i uu = _mm256_packus_epi16(_mm256_and_si256(a, lo), _mm256_and_si256(b, lo));
+        __m256i vv = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        /* packus works per 128-bit lane: put the quarters back in order */
+        _mm256_storeu_si256((__m256i *)(u + i), _mm256_permute4x64_epi64(uu, 0xd8));
+        _mm256_storeu_si256((__m256i *)(v + i), _mm256_permute4x64_epi64(vv, 0xd8));
+    }
+    deinterleave_uv_sse2(uv + 2 * i, u + i, v + i, n - i);
+}
+
+AVX2 static void yuyv_to_i420_row_avx2(const uint8_t *r0, const uint8_t *r1, uint8_t *y0,
+                                       uint8_t *y1, uint8_t *u, uint8_t *v, int w)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    const __m256i zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(r0 + 2 * x));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(r0 + 2 * x + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(r1 + 2 * x));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(r1 + 2 * x + 32));
+
+        __m256i ya = _mm256_packus_epi16(_mm256_and_si256(a0, lo), _mm256_and_si256(a1, lo));
+        __m256i yb = _mm256_packus_epi16(_mm256_and_si256(b0, lo), _mm256_and_si256(b1, lo));
+        __m256i ca = _mm256_packus_epi16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+        __m256i cb = _mm256_packus_epi16(_mm256_srli_epi16(b0, 8), _mm256_srli_epi16(b1, 8));
+        __m256i c = _mm256_permute4x64_epi64(_mm256_avg_epu8(ca, cb), 0xd8);
+
+        _mm256_storeu_si256((__m256i *)(y0 + x), _mm256_permute4x64_epi64(ya, 0xd8));
+        _mm256_storeu_si256((__m256i *)(y1 + x), _mm256_permute4x64_epi64(yb, 0xd8));
+
+        __m256i uu = _mm256_packus_epi16(_mm256_and_si256(c, lo), zero);
+        __m256i vv = _mm256_packus_epi16(_mm256_srli_epi16(c, 8), zero);
+        _mm_storeu_si128((__m128i *)(u + x / 2),
+                         _mm256_castsi256_si128(_mm256_permute4x64_epi64(uu, 0xd8)));
+        _mm_storeu_si128((__m128i *)(v + x / 2),
+                         _mm256_castsi256_si128(_mm256_permute4x64_epi64(vv, 0xd8)));
+    }
+    yuyv_to_i420_row_sse2(r0 + 2 * x, r1 + 2 * x, y0 + x, y1 + x, u + x / 2, v + x / 2, w - x);
+}
+
+AVX2 static void yuyv_to_y_row_avx2(const uint8_t *src, uint8_t *y, int w)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * x + 32));
+        __m256i yy = _mm256_packus_epi16(_mm256_and_si256(a, lo), _mm256_and_si256(b, lo));
+        _mm256_storeu_si256((__m256i *)(y + x), _mm256_permute4x64_epi64(yy, 0xd8));
+    }
+    yuyv_to_y_row_sse2(src + 2 * x, y + x, w - x);
+}
+
+AVX2 static inline void yuv_to_rgb_avx2_16(__m256i y, __m256i u, __m256i v, const yuv_coeffs *c,
+                                           __m256i *r, __m256i *g, __m256i *b)
+{
+    const __m256i bias = _mm256_set1_epi16(128), round = _mm256_set1_epi16(32);
+    __m256i yy = _mm256_mullo_epi16(_mm256_sub_epi16(y, _mm256_set1_epi16(c->yoff)),
+                                    _mm256_set1_epi16(c->ygain));
+    __m256i du = _mm256_sub_epi16(u, bias), dv = _mm256_sub_epi16(v, bias);
+
+    __m256i rr = _mm256_adds_epi16(yy, _mm256_mullo_epi16(dv, _mm256_set1_epi16(c->rv)));
+    __m256i gg = _mm256_subs_epi16(yy, _mm256_mullo_epi16(du, _mm256_set1_epi16(c->gu)));
+    gg = _mm256_subs_epi16(gg, _mm256_mullo_epi16(dv, _mm256_set1_epi16(c->gv)));
+    __m256i bb = _mm256_adds_epi16(yy, _mm256_mullo_epi16(du, _mm256_set1_epi16(c->bu)));
+
+    *r = _mm256_srai_epi16(_mm256_adds_epi16(rr, round), 6);
+    *g = _mm256_srai_epi16(_mm256_adds_epi16(gg, round), 6);
+    *b = _mm256_srai_epi16(_mm256_adds_epi16(bb, round), 6);
+}
+
+/* 32 pixels -> R, G, B bytes, in pixel order */
+AVX2 static inline void yuv_to_rgb_avx2_32(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                           const yuv_coeffs *c, __m256i *R, __m256i *G, __m256i *B)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i yv = _mm256_loadu_si256((const __m256i *)y);
+    __m128i u16 = _mm_loadu_si128((const __m128i *)u);
+    __m128i v16 = _mm_loadu_si128((const __m128i *)v);
+    /* Lane 0 = pixels 0-15, lane 1 = 16-31, matching the Y load */
+    __m256i uv = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(u16, u16)),
+                                         _mm_unpackhi_epi8(u16, u16), 1);
+    __m256i vv = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(v16, v16)),
+                                         _mm_unpackhi_epi8(v16, v16), 1);
+
+    __m256i r0, g0, b0, r1, g1, b1;
+    yuv_to_rgb_avx2_16(_mm256_unpacklo_epi8(yv, zero), _mm256_unpacklo_epi8(uv, zero),
+                       _mm256_unpacklo_epi8(vv, zero), c, &r0, &g0, &b0);
+    yuv_to_rgb_avx2_16(_mm256_unpackhi_epi8(yv, zero), _mm256_unpackhi_epi8(uv, zero),
+                       _mm256_unpackhi_epi8(vv, zero), c, &r1, &g1, &b1);
+    *R = _mm256_packus_epi16(r0, r1);
+    *G = _mm256_packus_epi16(g0, g1);
+    *B = _mm256_packus_epi16(b0, b1);
+}
+
+AVX2 static void yuv_to_bgr24_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                       uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i R, G, B;
+        yuv_to_rgb_avx2_32(y + x, u + x / 2, v + x / 2, c, &R, &G, &B);
+
+        __m256i bg_lo = _mm256_unpacklo_epi8(B, G), bg_hi = _mm256_unpackhi_epi8(B, G);
+        __m256i rx_lo = _mm256_unpacklo_epi8(R, zero), rx_hi = _mm256_unpackhi_epi8(R, zero);
+        /* Lanes hold pixels [0-3|16-19], [4-7|20-23], [8-11|24-27], [12-15|28-31] */
+        __m256i p[4] = {
+            _mm256_shuffle_epi8(_mm256_unpacklo_epi16(bg_lo, rx_lo), pack),
+            _mm256_shuffle_epi8(_mm256_unpackhi_epi16(bg_lo, rx_lo), pack),
+            _mm256_shuffle_epi8(_mm256_unpacklo_epi16(bg_hi, rx_hi), pack),
+            _mm256_shuffle_epi8(_mm256_unpackhi_epi16(bg_hi, rx_hi), pack),
+        };
+        uint8_t *d = dst + 3 * x;
+        for (int k = 0; k < 4; k++)
+            _mm_storeu_si128((__m128i *)(d + 12 * k), _mm256_castsi256_si128(p[k]));
+        for (int k = 0; k < 3; k++)
+            _mm_storeu_si128((__m128i *)(d + 48 + 12 * k), _mm256_extracti128_si256(p[k], 1));
+        store12(d + 84, _mm256_extracti128_si256(p[3], 1));
+    }
+    yuv_to_bgr24_row_sse2(y + x, u + x / 2, v + x / 2, dst + 3 * x, w - x, c);
+}
+
+AVX2 static void yuv_to_bgra_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                      uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    const __m256i alpha = _mm256_set1_epi8((char)0xff);
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        __m256i R, G, B;
+        yuv_to_rgb_avx2_32(y + x, u + x / 2, v + x / 2, c, &R, &G, &B);
+
+        __m256i bg_lo = _mm256_unpacklo_epi8(B, G), bg_hi = _mm256_unpackhi_epi8(B, G);
+        __m256i ra_lo = _mm256_unpacklo_epi8(R, alpha), ra_hi = _mm256_unpackhi_epi8(R, alpha);
+        __m256i q0 = _mm256_unpacklo_epi16(bg_lo, ra_lo); /* [0-3|16-19] */
+        __m256i q1 = _mm256_unpackhi_epi16(bg_lo, ra_lo); /* [4-7|20-23] */
+        __m256i q2 = _mm256_unpacklo_epi16(bg_hi, ra_hi); /* [8-11|24-27] */
+        __m256i q3 = _mm256_unpackhi_epi16(bg_hi, ra_hi); /* [12-15|28-31] */
+        __m256i *d = (__m256i *)(dst + 4 * x);
+        _mm256_storeu_si256(d + 0, _mm256_permute2x128_si256(q0, q1, 0x20));
+        _mm256_storeu_si256(d + 1, _mm256_permute2x128_si256(q2, q3, 0x20));
+        _mm256_storeu_si256(d + 2, _mm256_permute2x128_si256(q0, q1, 0x31));
+        _mm256_storeu_si256(d + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+    }
+    yuv_to_bgra_row_sse2(y + x, u + x / 2, v + x / 2, dst + 4 * x, w - x, c);
+}
+
+static const pixconv_kernels k_avx2 = {
+    PIXCONV_IMPL_AVX2, "avx2",
+    interleave_uv_avx2, deinterleave_uv_avx2, yuyv_to_i420_row_avx2, yuyv_to_y_row_avx2,
+    yuv_to_bgr24_row_avx2, yuv_to_bgra_row_avx2,
+};
+#endif
+
+// ============================================================================
+// NEON
+// ============================================================================
+#if PIXCONV_NEON
+static void interleave_uv_neon(const uint8_t *u, const uint8_t *v, uint8_t *uv, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t p = { { vld1q_u8(u + i), vld1q_u8(v + i) } };
+        vst2q_u8(uv + 2 * i, p);
+    }
+    interleave_uv_c(u + i, v + i, uv + 2 * i, n - i);
+}
+
+static void deinterleave_uv_neon(const uint8_t *uv, uint8_t *u, uint8_t *v, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t p = vld2q_u8(uv + 2 * i);
+        vst1q_u8(u + i, p.val[0]);
+        vst1q_u8(v + i, p.val[1]);
+    }
+    deinterleave_uv_c(uv + 2 * i, u + i, v + i, n - i);
+}
+
+static void yuyv_to_i420_row_neon(const uint8_t *r0, const uint8_t *r1, uint8_t *y0,
+                                  uint8_t *y1, uint8_t *u, uint8_t *v, int w)
+{
+    int x = 0;
+    for (; x + 32 <= w; x += 32) {
+        /* val[0] = even Y, val[1] = U, val[2] = odd Y, val[3] = V */
+        uint8x16x4_t a = vld4q_u8(r0 + 2 * x);
+        uint8x16x4_t b = vld4q_u8(r1 + 2 * x);
+        uint8x16x2_t ya = { { a.val[0], a.val[2] } };
+        uint8x16x2_t yb = { { b.val[0], b.val[2] } };
+        vst2q_u8(y0 + x, ya);
+        vst2q_u8(y1 + x, yb);
+        vst1q_u8(u + x / 2, vrhaddq_u8(a.val[1], b.val[1]));
+        vst1q_u8(v + x / 2, vrhaddq_u8(a.val[3], b.val[3]));
+    }
+    yuyv_to_i420_row_c(r0 + 2 * x, r1 + 2 * x, y0 + x, y1 + x, u + x / 2, v + x / 2, w - x);
+}
+
+static void yuyv_to_y_row_neon(const uint8_t *src, uint8_t *y, int w)
+{
+    int x = 0;
+    for (; x + 16 <= w; x += 16)
+        vst1q_u8(y + x, vld2q_u8(src + 2 * x).val[0]);
+    yuyv_to_y_row_c(src + 2 * x, y + x, w - x);
+}
+
+static inline void yuv_to_rgb_neon_8(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8,
+                                     const yuv_coeffs *c,
+                                     uint8x8_t *r, uint8x8_t *g, uint8x8_t *b)
+{
+    const int16x8_t bias = vdupq_n_s16(128);
+    int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(y8));
+    int16x8_t du = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), bias);
+    int16x8_t dv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), bias);
+    int16x8_t yy = vmulq_s16(vsubq_s16(y, vdupq_n_s16(c->yoff)), vdupq_n_s16(c->ygain));
+
+    int16x8_t rr = vqaddq_s16(yy, vmulq_s16(dv, vdupq_n_s16(c->rv)));
+    int16x8_t gg = vqsubq_s16(yy, vmulq_s16(du, vdupq_n_s16(c->gu)));
+    gg = vqsubq_s16(gg, vmulq_s16(dv, vdupq_n_s16(c->gv)));
+    int16x8_t bb = vqaddq_s16(yy, vmulq_s16(du, vdupq_n_s16(c->bu)));
+
+    /* Rounding narrow: (x + 32) >> 6, clamped to 0..255 */
+    *r = vqrshrun_n_s16(rr, 6);
+    *g = vqrshrun_n_s16(gg, 6);
+    *b = vqrshrun_n_s16(bb, 6);
+}
+
+static inline void yuv_to_rgb_neon_16(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                      const yuv_coeffs *c,
+                                      uint8x16_t *R, uint8x16_t *G, uint8x16_t *B)
+{
+    uint8x16_t yv = vld1q_u8(y);
+    uint8x8_t u8 = vld1_u8(u), v8 = vld1_u8(v);
+    uint8x8x2_t uu = vzip_u8(u8, u8); /* one chroma sample per pixel */
+    uint8x8x2_t vv = vzip_u8(v8, v8);
+
+    uint8x8_t r0, g0, b0, r1, g1, b1;
+    yuv_to_rgb_neon_8(vget_low_u8(yv), uu.val[0], vv.val[0], c, &r0, &g0, &b0);
+    yuv_to_rgb_neon_8(vget_high_u8(yv), uu.val[1], vv.val[1], c, &r1, &g1, &b1);
+    *R = vcombine_u8(r0, r1);
+    *G = vcombine_u8(g0, g1);
+    *B = vcombine_u8(b0, b1);
+}
+
+static void yuv_to_bgr24_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                  uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        uint8x16x3_t bgr;
+        yuv_to_rgb_neon_16(y + x, u + x / 2, v + x / 2, c, &bgr.val[2], &bgr.val[1], &bgr.val[0]);
+        vst3q_u8(dst + 3 * x, bgr);
+    }
+    yuv_to_bgr24_row_c(y + x, u + x / 2, v + x / 2, dst + 3 * x, w - x, c);
+}
+
+static void yuv_to_bgra_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                 uint8_t *dst, int w, const yuv_coeffs *c)
+{
+    int x = 0;
+    for (; x + 16 <= w; x += 16) {
+        uint8x16x4_t bgra;
+        yuv_to_rgb_neon_16(y + x, u + x / 2, v + x / 2, c, &bgra.val[2], &bgra.val[1], &bgra.val[0]);
+        bgra.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + 4 * x, bgra);
+    }
+    yuv_to_bgra_row_c(y + x, u + x / 2, v + x / 2, dst + 4 * x, w - x, c);
+}
+
+static const pixconv_kernels k_neon = {
+    PIXCONV_IMPL_NEON, "neon",
+    interleave_uv_neon, deinterleave_uv_neon, yuyv_to_i420_row_neon, yuyv_to_y_row_neon,
+    yuv_to_bgr24_row_neon, yuv_to_bgra_row_neon,
+};
+#endif
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+static _Atomic(const pixconv_kernels *) g_kernels;
+
+static const pixconv_kernels *best_kernels(void)
+{
+#if PIXCONV_NEON
+    return &k_neon;
+#elif PIXCONV_X86
+    if (__builtin_cpu_supports("avx2"))
+        return &k_avx2;
+    return &k_sse2;
+#else
+    return &k_scalar;
+#endif
+}
+
+static const pixconv_kernels *kernels(void)
+{
+    const pixconv_kernels *k = atomic_load_explicit(&g_kernels, memory_order_acquire);
+    if (!k) {
+        k = best_kernels();
+        atomic_store_explicit(&g_kernels, k, memory_order_release);
+    }
+    return k;
+}
+
+int pixconv_select(pixconv_impl_t impl)
+{
+    const pixconv_kernels *k = NULL;
+    switch (impl) {
+        case PIXCONV_IMPL_AUTO:   k = best_kernels(); break;
+        case PIXCONV_IMPL_SCALAR: k = &k_scalar; break;
+#if PIXCONV_X86
+        case PIXCONV_IMPL_SSE2:   k = &k_sse2; break;
+        case PIXCONV_IMPL_AVX2:
+            if (__builtin_cpu_supports("avx2"))
+                k = &k_avx2;
+            break;
+#endif
+#if PIXCONV_NEON
+        case PIXCONV_IMPL_NEON:   k = &k_neon; break;
+#endif
+        default: break;
+    }
+    if (!k)
+        return -1;
+
+    atomic_store_explicit(&g_kernels, k, memory_order_release);
+    return 0;
+}
+
+const char *pixconv_impl_name(void)
+{
+    return kernels()->name;
+}
+
+// ============================================================================
+// Frame layout
+// ============================================================================
+static int packed_layout(rpi_format_t format, int width, int height,
+                         uint32_t row_bytes[RPI_FRAME_MAX_PLANES],
+                         uint32_t rows[RPI_FRAME_MAX_PLANES])
+{
+    uint32_t cw = (uint32_t)(width + 1) / 2, ch = (uint32_t)(height + 1) / 2;
+
+    rows[0] = (uint32_t)height;
+    switch (format) {
+        case RPI_FMT_YUV420:
+            row_bytes[0] = (uint32_t)width;
+            row_bytes[1] = row_bytes[2] = cw;
+            rows[1] = rows[2] = ch;
+            return 3;
+        case RPI_FMT_NV12:
+            row_bytes[0] = (uint32_t)width;
+            row_bytes[1] = cw * 2;
+            rows[1] = ch;
+            return 2;
+        case RPI_FMT_YUYV:   row_bytes[0] = (uint32_t)width * 2; return 1;
+        case RPI_FMT_RGB888: row_bytes[0] = (uint32_t)width * 3; return 1;
+        case RPI_FMT_BGRA:   row_bytes[0] = (uint32_t)width * 4; return 1;
+        case RPI_FMT_GRAY8:  row_bytes[0] = (uint32_t)width; return 1;
+        case RPI_FMT_RAW10:  row_bytes[0] = (uint32_t)(width + 3) / 4 * 5; return 1;
+        case RPI_FMT_RAW12:  row_bytes[0] = (uint32_t)(width + 1) / 2 * 3; return 1;
+        default:
+            return 0;
+    }
+}
+
+size_t pixconv_frame_size(rpi_format_t format, int width, int height)
+{
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    int n = packed_layout(format, width, height, row_bytes, rows);
+
+    size_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += (size_t)row_bytes[i] * rows[i];
+    return total;
+}
+
+int pixconv_frame_init(rpi_frame_t *frame, rpi_format_t format, int width, int height,
+                       void *buf, size_t size)
+{
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    int n = packed_layout(format, width, height, row_bytes, rows);
+    if (!frame || !buf || n == 0 || size < pixconv_frame_size(format, width, height))
+        return -EINVAL;
+
+    uint8_t *p = (uint8_t *)buf;
+    frame->data = buf;
+    frame->size = pixconv_frame_size(format, width, height);
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+    frame->num_planes = (uint32_t)n;
+    for (int i = 0; i < n; i++) {
+        frame->planes[i].data = p;
+        frame->planes[i].stride = row_bytes[i];
+        frame->planes[i].size = (size_t)row_bytes[i] * rows[i];
+        frame->planes[i].offset = (size_t)(p - (uint8_t *)buf);
+        p += frame->planes[i].size;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Conversions
+// ============================================================================
+/* Sources that are not planar are unpacked this many pixels at a time */
+#define PIXCONV_CHUNK 512
+
+#define ROW(frame, plane, y) \
+    ((uint8_t *)(frame)->planes[plane].data + (size_t)(y) * (frame)->planes[plane].stride)
+
+static void copy_plane(const rpi_frame_t *src, rpi_frame_t *dst, int plane,
+                       size_t row_bytes, int rows)
+{
+    for (int y = 0; y < rows; y++)
+        memcpy(ROW(dst, plane, y), ROW(src, plane, y), row_bytes);
+}
+
+static int copy_frame(const rpi_frame_t *src, rpi_frame_t *dst)
+{
+    uint32_t row_bytes[RPI_FRAME_MAX_PLANES], rows[RPI_FRAME_MAX_PLANES];
+    int n = packed_layout(src->format, src->width, src->height, row_bytes, rows);
+    if (n == 0)
+        return -EINVAL;
+
+    for (int i = 0; i < n; i++)
+        copy_plane(src, dst, i, row_bytes[i], (int)rows[i]);
+    return 0;
+}
+
+static int to_gray(const rpi_frame_t *src, rpi_frame_t *dst, const pixconv_kernels *k)
+{
+    int w = src->width, h = src->height;
+
+    if (src->format == RPI_FMT_YUYV) {
+        for (int y = 0; y < h; y++)
+            k->yuyv_to_y_row(ROW(src, 0, y), ROW(dst, 0, y), w);
+        return 0;
+    }
+    copy_plane(src, dst, 0, (size_t)w, h);
+    return 0;
+}
+
+/* Any YUV source -> YUV420 or NV12 */
+static int to_420(const rpi_frame_t *src, rpi_frame_t *dst, const pixconv_kernels *k)
+{
+    int w = src->width, h = src->height, cw = (w + 1) / 2, ch = (h + 1) / 2;
+    int nv12 = dst->format == RPI_FMT_NV12;
+
+    if (src->format == RPI_FMT_YUYV) {
+        uint8_t ubuf[PIXCONV_CHUNK / 2], vbuf[PIXCONV_CHUNK / 2];
+        for (int y = 0; y < h; y += 2) {
+            int y1 = y + 1 < h ? y + 1 : y; /* odd height: last row pairs with itself */
+            if (!nv12) {
+                k->yuyv_to_i420_row(ROW(src, 0, y), ROW(src, 0, y1), ROW(dst, 0, y),
+                                    ROW(dst, 0, y1), ROW(dst, 1, y / 2), ROW(dst, 2, y / 2), w);
+                continue;
+            }
+            for (int x = 0; x < w; x += PIXCONV_CHUNK) {
+                int n = w - x < PIXCONV_CHUNK ? w - x : PIXCONV_CHUNK;
+                k->yuyv_to_i420_row(ROW(src, 0, y) + 2 * x, ROW(src, 0, y1) + 2 * x,
+                                    ROW(dst, 0, y) + x, ROW(dst, 0, y1) + x, ubuf, vbuf, n);
+                k->interleave_uv(ubuf, vbuf, ROW(dst, 1, y / 2) + x, n / 2);
+            }
+        }
+        return 0;
+    }
+
+    /* YUV420 <-> NV12: same luma, chroma (de)interleaved */
+    copy_plane(src, dst, 0, (size_t)w, h);
+    for (int y = 0; y < ch; y++) {
+        if (nv12)
+            k->interleave_uv(ROW(src, 1, y), ROW(src, 2, y), ROW(dst, 1, y), cw);
+        else
+            k->deinterleave_uv(ROW(src, 1, y), ROW(dst, 1, y), ROW(dst, 2, y), cw);
+    }
+    return 0;
+}
+
+/* Any YUV source -> RGB888 or BGRA */
+static int to_rgb(const rpi_frame_t *src, rpi_frame_t *dst, const yuv_coeffs *c,
+                  const pixconv_kernels *k)
+{
+    int w = src->width, h = src->height;
+    int bgra = dst->format == RPI_FMT_BGRA, bpp = bgra ? 4 : 3;
+    void (*row)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, int,
+                const yuv_coeffs *) = bgra ? k->yuv_to_bgra_row : k->yuv_to_bgr24_row;
+    uint8_t ybuf[PIXCONV_CHUNK], ubuf[PIXCONV_CHUNK / 2], vbuf[PIXCONV_CHUNK / 2];
+
+    for (int y = 0; y < h; y++) {
+        uint8_t *out = ROW(dst, 0, y);
+
+        switch (src->format) {
+            case RPI_FMT_YUV420:
+                row(ROW(src, 0, y), ROW(src, 1, y / 2), ROW(src, 2, y / 2), out, w, c);
+                break;
+            case RPI_FMT_NV12:
+                for (int x = 0; x < w; x += PIXCONV_CHUNK) {
+                    int n = w - x < PIXCONV_CHUNK ? w - x : PIXCONV_CHUNK;
+                    k->deinterleave_uv(ROW(src, 1, y / 2) + x, ubuf, vbuf, (n + 1) / 2);
+                    row(ROW(src, 0, y) + x, ubuf, vbuf, out + (size_t)x * bpp, n, c);
+                }
+                break;
+            case RPI_FMT_YUYV:
+                /* Each row keeps its own chroma: pair the row with itself */
+                for (int x = 0; x < w; x += PIXCONV_CHUNK) {
+                    int n = w - x < PIXCONV_CHUNK ? w - x : PIXCONV_CHUNK;
+                    const uint8_t *s = ROW(src, 0, y) + 2 * x;
+                    k->yuyv_to_i420_row(s, s, ybuf, ybuf, ubuf, vbuf, n);
+                    row(ybuf, ubuf, vbuf, out + (size_t)x * bpp, n, c);
+                }
+                break;
+            default:
+                return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+int pixconv_convert(const rpi_frame_t *src, rpi_frame_t *dst, pixconv_matrix_t matrix)
+{
+    if (!src || !dst || !src->data || !dst->data || matrix < PIXCONV_BT601 ||
+        matrix > PIXCONV_JPEG || src->width != dst->width || src->height != dst->height)
+        return -EINVAL;
+
+    if (src->format == dst->format)
+        return copy_frame(src, dst);
+
+    if (src->format != RPI_FMT_YUV420 && src->format != RPI_FMT_NV12 &&
+        src->format != RPI_FMT_YUYV)
+        return -EINVAL;
+    if (src->format == RPI_FMT_YUYV && (src->width & 1))
+        return -EINVAL;
+
+    const pixconv_kernels *k = kernels();
+    switch (dst->format) {
+        case RPI_FMT_GRAY8:
+            return to_gray(src, dst, k);
+        case RPI_FMT_YUV420:
+        case RPI_FMT_NV12:
+            return to_420(src, dst, k);
+        case RPI_FMT_RGB888:
+        case RPI_FMT_BGRA:
+            return to_rgb(src, dst, &k_coeffs[matrix], k);
+        default:
+            return -EINVAL;
+    }
+}
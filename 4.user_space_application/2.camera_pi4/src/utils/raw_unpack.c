@@ -0,0 +1,215 @@
+// ============================================================================
+// raw_unpack.c - CSI-2 RAW10/RAW12 unpacking (scalar, SSSE3, NEON)
+// ============================================================================
+
+#include "raw_unpack.h"
+#include <errno.h>
+
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__arm__))
+#include <arm_neon.h>
+#define RAW_UNPACK_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define RAW_UNPACK_SSSE3 1
+#endif
+
+void raw_unpack10_scalar(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4, src += 5, dst += 4) {
+        uint8_t lsb = src[4];
+        dst[0] = (uint16_t)((src[0] << 2) | (lsb & 3));
+        dst[1] = (uint16_t)((src[1] << 2) | ((lsb >> 2) & 3));
+        dst[2] = (uint16_t)((src[2] << 2) | ((lsb >> 4) & 3));
+        dst[3] = (uint16_t)((src[3] << 2) | (lsb >> 6));
+    }
+    /* Partial group at the end of a row */
+    for (size_t k = 0; i < pixels; i++, k++)
+        dst[k] = (uint16_t)((src[k] << 2) | ((src[4] >> (2 * k)) & 3));
+}
+
+void raw_unpack12_scalar(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    size_t i = 0;
+    for (; i + 2 <= pixels; i += 2, src += 3, dst += 2) {
+        dst[0] = (uint16_t)((src[0] << 4) | (src[2] & 0x0f));
+        dst[1] = (uint16_t)((src[1] << 4) | (src[2] >> 4));
+    }
+    if (i < pixels)
+        dst[0] = (uint16_t)((src[0] << 4) | (src[2] & 0x0f));
+}
+
+/* Both kernels take 8 pixels per step from one 16-byte load. A shuffle puts
+ * each pixel's high byte in one 16-bit lane and the byte holding its low
+ * bits in another; a per-lane multiply moves that pixel's low bits to the
+ * top of the lane, from where one shift brings them down. */
+
+#if RAW_UNPACK_NEON
+/* 16-byte table lookup, 0 for out-of-range indices; ARMv7 has only the
+ * 8-byte-result form */
+static inline uint8x16_t tbl16_neon(uint8x16_t v, uint8x16_t idx)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(v, idx);
+#else
+    uint8x8x2_t t = { { vget_low_u8(v), vget_high_u8(v) } };
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+static void unpack10_neon(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    static const uint8_t msb_idx[16] = { 0, 255, 1, 255, 2, 255, 3, 255,
+                                         5, 255, 6, 255, 7, 255, 8, 255 };
+    static const uint8_t lsb_idx[16] = { 4, 255, 4, 255, 4, 255, 4, 255,
+                                         9, 255, 9, 255, 9, 255, 9, 255 };
+    static const uint16_t mul[8] = { 1 << 14, 1 << 12, 1 << 10, 1 << 8,
+                                     1 << 14, 1 << 12, 1 << 10, 1 << 8 };
+    const uint8x16_t tm = vld1q_u8(msb_idx), tl = vld1q_u8(lsb_idx);
+    const uint16x8_t m = vld1q_u16(mul);
+
+    size_t in_bytes = (pixels + 3) / 4 * 5;
+    size_t i = 0;
+    for (; i + 8 <= pixels && i / 4 * 5 + 16 <= in_bytes; i += 8) {
+        uint8x16_t v = vld1q_u8(src + i / 4 * 5);
+        uint16x8_t hi = vreinterpretq_u16_u8(tbl16_neon(v, tm));
+        uint16x8_t lo = vreinterpretq_u16_u8(tbl16_neon(v, tl));
+        lo = vshrq_n_u16(vmulq_u16(lo, m), 14);
+        vst1q_u16(dst + i, vorrq_u16(vshlq_n_u16(hi, 2), lo));
+    }
+    raw_unpack10_scalar(src + i / 4 * 5, dst + i, pixels - i);
+}
+
+static void unpack12_neon(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    static const uint8_t msb_idx[16] = { 0, 255, 1, 255, 3, 255, 4, 255,
+                                         6, 255, 7, 255, 9, 255, 10, 255 };
+    static const uint8_t lsb_idx[16] = { 2, 255, 2, 255, 5, 255, 5, 255,
+                                         8, 255, 8, 255, 11, 255, 11, 255 };
+    static const uint16_t mul[8] = { 1 << 12, 1 << 8, 1 << 12, 1 << 8,
+                                     1 << 12, 1 << 8, 1 << 12, 1 << 8 };
+    const uint8x16_t tm = vld1q_u8(msb_idx), tl = vld1q_u8(lsb_idx);
+    const uint16x8_t m = vld1q_u16(mul);
+
+    size_t in_bytes = (pixels + 1) / 2 * 3;
+    size_t i = 0;
+    for (; i + 8 <= pixels && i / 2 * 3 + 16 <= in_bytes; i += 8) {
+        uint8x16_t v = vld1q_u8(src + i / 2 * 3);
+        uint16x8_t hi = vreinterpretq_u16_u8(tbl16_neon(v, tm));
+        uint16x8_t lo = vreinterpretq_u16_u8(tbl16_neon(v, tl));
+        lo = vshrq_n_u16(vmulq_u16(lo, m), 12);
+        vst1q_u16(dst + i, vorrq_u16(vshlq_n_u16(hi, 4), lo));
+    }
+    raw_unpack12_scalar(src + i / 2 * 3, dst + i, pixels - i);
+}
+#endif
+
+#if RAW_UNPACK_SSSE3
+__attribute__((target("ssse3")))
+static void unpack10_ssse3(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    const __m128i tm = _mm_setr_epi8(0, -1, 1, -1, 2, -1, 3, -1,
+                                     5, -1, 6, -1, 7, -1, 8, -1);
+    const __m128i tl = _mm_setr_epi8(4, -1, 4, -1, 4, -1, 4, -1,
+                                     9, -1, 9, -1, 9, -1, 9, -1);
+    const __m128i m = _mm_setr_epi16(1 << 14, 1 << 12, 1 << 10, 1 << 8,
+                                     1 << 14, 1 << 12, 1 << 10, 1 << 8);
+
+    size_t in_bytes = (pixels + 3) / 4 * 5;
+    size_t i = 0;
+    for (; i + 8 <= pixels && i / 4 * 5 + 16 <= in_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i / 4 * 5));
+        __m128i hi = _mm_shuffle_epi8(v, tm);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, tl), m), 14);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(hi, 2), lo));
+    }
+    raw_unpack10_scalar(src + i / 4 * 5, dst + i, pixels - i);
+}
+
+__attribute__((target("ssse3")))
+static void unpack12_ssse3(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    const __m128i tm = _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1,
+                                     6, -1, 7, -1, 9, -1, 10, -1);
+    const __m128i tl = _mm_setr_epi8(2, -1, 2, -1, 5, -1, 5, -1,
+                                     8, -1, 8, -1, 11, -1, 11, -1);
+    const __m128i m = _mm_setr_epi16(1 << 12, 1 << 8, 1 << 12, 1 << 8,
+                                     1 << 12, 1 << 8, 1 << 12, 1 << 8);
+
+    size_t in_bytes = (pixels + 1) / 2 * 3;
+    size_t i = 0;
+    for (; i + 8 <= pixels && i / 2 * 3 + 16 <= in_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i / 2 * 3));
+        __m128i hi = _mm_shuffle_epi8(v, tm);
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, tl), m), 12);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+    }
+    raw_unpack12_scalar(src + i / 2 * 3, dst + i, pixels - i);
+}
+
+static int have_ssse3(void)
+{
+    return __builtin_cpu_supports("ssse3");
+}
+#endif
+
+void raw_unpack10(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+#if RAW_UNPACK_NEON
+    unpack10_neon(src, dst, pixels);
+#elif RAW_UNPACK_SSSE3
+    if (have_ssse3())
+        unpack10_ssse3(src, dst, pixels);
+    else
+        raw_unpack10_scalar(src, dst, pixels);
+#else
+    raw_unpack10_scalar(src, dst, pixels);
+#endif
+}
+
+void raw_unpack12(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+#if RAW_UNPACK_NEON
+    unpack12_neon(src, dst, pixels);
+#elif RAW_UNPACK_SSSE3
+    if (have_ssse3())
+        unpack12_ssse3(src, dst, pixels);
+    else
+        raw_unpack12_scalar(src, dst, pixels);
+#else
+    raw_unpack12_scalar(src, dst, pixels);
+#endif
+}
+
+int raw_unpack_frame(const rpi_frame_t *frame, uint16_t *dst, size_t dst_stride)
+{
+    if (!frame || !frame->data || !dst || frame->num_planes < 1 ||
+        dst_stride < (size_t)frame->width * 2)
+        return -EINVAL;
+
+    void (*unpack)(const uint8_t *, uint16_t *, size_t);
+    if (frame->format == RPI_FMT_RAW10)
+        unpack = raw_unpack10;
+    else if (frame->format == RPI_FMT_RAW12)
+        unpack = raw_unpack12;
+    else
+        return -EINVAL;
+
+    const rpi_plane_t *plane = &frame->planes[0];
+    for (int y = 0; y < frame->height; y++)
+        unpack((const uint8_t *)plane->data + (size_t)y * plane->stride,
+               (uint16_t *)((uint8_t *)dst + (size_t)y * dst_stride),
+               (size_t)frame->width);
+    return 0;
+}
+
+const char *raw_unpack_impl(void)
+{
+#if RAW_UNPACK_NEON
+    return "neon";
+#elif RAW_UNPACK_SSSE3
+    return have_ssse3() ? "ssse3" : "scalar";
+#else
+    return "scalar";
+#endif
+}
@@ -16,7 +16,8 @@
  * 
  * Build:
  *   gcc picam_security.c -o picam_security \
- *       $(pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0) -pthread
+ *       $(pkg-config --cflags --libs gstreamer-1.0 gstreamer-app-1.0 gstreamer-video-1.0) \
+ *       -pthread
  * 
  * Run:
  *   ./picam_security
@@ -24,6 +25,7 @@
 
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +56,7 @@ typedef struct {
     GstElement *pipeline;
     GstElement *source;
     GstElement *tee;
+    GstElement *snapshot_sink; /* newest frame of the live stream */
     GstElement *recording_bin;
     
     GMainLoop *loop;
@@ -264,7 +267,12 @@ gboolean camera_init(void) {
         // Branch 3: Encoding pipeline (ready for recording/streaming)
         "t. ! queue name=enc_queue ! videoconvert ! "
         "x264enc tune=zerolatency bitrate=2000 speed-preset=ultrafast ! "
-        "h264parse name=parse",
+        "h264parse name=parse "
+        
+        // Branch 4: Snapshots - keeps only the newest frame, the camera
+        // is busy with this pipeline and cannot open a second one
+        "t. ! queue leaky=downstream max-size-buffers=1 ! "
+        "appsink name=snap max-buffers=1 drop=true sync=false",
         VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FPS,
         PREVIEW_WIDTH, PREVIEW_HEIGHT
     );
@@ -282,6 +290,7 @@ gboolean camera_init(void) {
     
     // Get elements for later use
     g_camera.tee = gst_bin_get_by_name(GST_BIN(g_camera.pipeline), "t");
+    g_camera.snapshot_sink = gst_bin_get_by_name(GST_BIN(g_camera.pipeline), "snap");
     
     // Setup motion detection
     GstElement *motion = gst_bin_get_by_name(GST_BIN(g_camera.pipeline), "motion");
@@ -408,30 +417,40 @@ void take_snapshot(void) {
     
     printf("📸 Taking snapshot: %s\n", filename);
     
-    // Create temporary pipeline for snapshot
-    gchar *snapshot_pipeline = g_strdup_printf(
-        "libcamerasrc num-buffers=1 ! "
-        "video/x-raw,width=%d,height=%d ! "
-        "videoconvert ! jpegenc ! filesink location=%s",
-        VIDEO_WIDTH, VIDEO_HEIGHT, filename
-    );
+    // Grab the live frame: the stream keeps running, nothing reconfigures
+    // (the C wrapper's rpi_camera_capture_still() does full resolution)
+    if (!g_camera.snapshot_sink)
+        return;
+    GstSample *sample = gst_app_sink_try_pull_sample(GST_APP_SINK(g_camera.snapshot_sink),
+                                                     GST_SECOND);
+    if (!sample) {
+        g_printerr("❌ No frame for snapshot\n");
+        return;
+    }
     
-    GstElement *pipeline = gst_parse_launch(snapshot_pipeline, NULL);
-    g_free(snapshot_pipeline);
+    GstCaps *jpeg_caps = gst_caps_new_empty_simple("image/jpeg");
+    GError *error = NULL;
+    GstSample *jpeg = gst_video_convert_sample(sample, jpeg_caps, GST_SECOND, &error);
+    gst_caps_unref(jpeg_caps);
+    gst_sample_unref(sample);
+    if (!jpeg) {
+        g_printerr("❌ Snapshot encode failed: %s\n", error ? error->message : "unknown");
+        g_clear_error(&error);
+        return;
+    }
     
-    if (pipeline) {
-        gst_element_set_state(pipeline, GST_STATE_PLAYING);
-        
-        // Wait for EOS
-        GstBus *bus = gst_element_get_bus(pipeline);
-        gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
-        gst_object_unref(bus);
-        
-        gst_element_set_state(pipeline, GST_STATE_NULL);
-        gst_object_unref(pipeline);
-        
-        printf("✅ Snapshot saved\n");
+    GstMapInfo map;
+    GstBuffer *buffer = gst_sample_get_buffer(jpeg);
+    if (buffer && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        FILE *f = fopen(filename, "wb");
+        if (f) {
+            fwrite(map.data, 1, map.size, f);
+            fclose(f);
+            printf("✅ Snapshot saved\n");
+        }
+        gst_buffer_unmap(buffer, &map);
     }
+    gst_sample_unref(jpeg);
 }
 
 // ============================================================================
@@ -490,6 +509,9 @@ void print_statistics(void) {
 void camera_cleanup(void) {
     printf("\n🧹 Cleaning up...\n");
     
+    if (g_camera.snapshot_sink) {
+        gst_object_unref(g_camera.snapshot_sink);
+    }
     if (g_camera.pipeline) {
         gst_object_unref(g_camera.pipeline);
     }
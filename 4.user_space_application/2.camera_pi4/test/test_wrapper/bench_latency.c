@@ -0,0 +1,118 @@
+// bench_latency.c - Sensor-to-consumer latency of each tuning profile
+//
+// Usage: bench_latency [work_ms] [width height]
+//   work_ms: time the consumer spends on each frame (default 0). Set it
+//   above the frame period to see how each profile behaves when the
+//   consumer cannot keep up.
+#define _GNU_SOURCE
+#include "rpi_camera.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define WARMUP_FRAMES 30
+#define MEASURE_FRAMES 300
+
+static const char *k_profiles[] = { "default", "low-latency", "throughput" };
+
+/* SensorTimestamp is CLOCK_BOOTTIME, the frame timestamp CLOCK_MONOTONIC */
+static uint64_t boottime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run_profile(const char *profile, int width, int height, int work_ms)
+{
+    rpi_camera_config_t cfg;
+    rpi_camera_config_init(&cfg, width, height, RPI_FMT_YUV420);
+    int ret = rpi_camera_config_profile(&cfg, profile);
+    assert(ret == 0);
+
+    rpi_camera_t *cam = rpi_camera_create_ex(&cfg);
+    assert(cam != NULL);
+    ret = rpi_camera_start(cam);
+    assert(ret == 0);
+    WaitForFirstFrame(cam);
+
+    uint64_t *latency = malloc(MEASURE_FRAMES * sizeof(uint64_t));
+    assert(latency);
+    int n = 0, sensor_ts = 0;
+    uint32_t first_seq = 0, last_seq = 0;
+    uint64_t t0 = 0;
+
+    for (int i = 0; i < WARMUP_FRAMES + MEASURE_FRAMES; i++) {
+        rpi_frame_t frame;
+        ret = rpi_camera_acquire_frame_timeout(cam, &frame, 1000);
+        assert(ret == 0);
+
+        if (i >= WARMUP_FRAMES) {
+            /* From the start of exposure when the pipeline reports it,
+             * else from the frame timestamp */
+            if (frame.meta.valid & RPI_META_SENSOR_TIMESTAMP) {
+                latency[n] = boottime_ns() - (uint64_t)frame.meta.sensor_timestamp;
+                sensor_ts = 1;
+            } else {
+                latency[n] = get_time_ns() - frame.timestamp;
+            }
+            if (n == 0) {
+                first_seq = frame.sequence;
+                t0 = get_time_ns();
+            }
+            last_seq = frame.sequence;
+            n++;
+        }
+
+        if (work_ms > 0)
+            usleep(work_ms * 1000);
+        rpi_camera_release_frame(&frame);
+    }
+    double seconds = (get_time_ns() - t0) / 1e9;
+
+    rpi_camera_stop(cam);
+    rpi_camera_destroy(cam);
+
+    qsort(latency, n, sizeof(latency[0]), cmp_u64);
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += latency[i];
+    uint32_t span = last_seq - first_seq + 1;
+
+    printf("  %-12s %7.2f %7.2f %7.2f %7.2f %7.2f %7.1f %6u  %s\n", profile,
+           latency[0] / 1e6, (double)sum / n / 1e6, latency[n / 2] / 1e6,
+           latency[n * 99 / 100] / 1e6, latency[n - 1] / 1e6, n / seconds,
+           span - (uint32_t)n, sensor_ts ? "exposure" : "timestamp");
+    free(latency);
+}
+
+int main(int argc, char *argv[])
+{
+    int work_ms = argc > 1 ? atoi(argv[1]) : 0;
+    int width = argc > 3 ? atoi(argv[2]) : 1280;
+    int height = argc > 3 ? atoi(argv[3]) : 720;
+
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║  Latency by Profile                    ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+    printf("%dx%d YUV420, %d frames, consumer work %d ms/frame\n\n",
+           width, height, MEASURE_FRAMES, work_ms);
+    printf("  %-12s %7s %7s %7s %7s %7s %7s %6s  %s\n", "profile", "min", "avg", "p50",
+           "p99", "max", "fps", "missed", "from");
+    printf("  %-12s %7s %7s %7s %7s %7s\n", "", "ms", "ms", "ms", "ms", "ms");
+
+    for (size_t i = 0; i < sizeof(k_profiles) / sizeof(k_profiles[0]); i++)
+        run_profile(k_profiles[i], width, height, work_ms);
+
+    return 0;
+}
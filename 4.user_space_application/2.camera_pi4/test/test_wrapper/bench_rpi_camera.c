@@ -0,0 +1,517 @@
+// bench_rpi_camera.c - Throughput, latency and cost of the wrapper, swept
+//
+// Runs the camera once per combination of resolution x format x queue depth
+// x consumer speed and reports, for each run:
+//   fps            frames the consumer got per second
+//   cpu/frame      process CPU time (user + system) per delivered frame
+//   p50/p99/p99.9  start of exposure (or frame timestamp) to consumer
+//   allocs/frame   malloc/calloc/realloc/memalign calls per delivered frame
+//   sys/frame      mmap, munmap and ioctl calls per delivered frame
+//   drops          frames the pipeline rejected or the sensor skipped
+//   ttff           start to first completed frame: on the first start after
+//                  create, and the median over RESTARTS stop/start cycles
+// The CSV and JSON also break opening the camera down into its phases
+// (manager, acquire, configure, allocate); the manager is pre-warmed once
+// for the whole sweep, as a long-running service would.
+//
+// Usage: bench_rpi_camera [options]
+//   --sizes 640x480,1280x720     resolutions (default 640x480,1280x720,1920x1080)
+//   --formats yuv420,mjpeg       yuv420 nv12 yuyv rgb888 bgra gray8 mjpeg raw10 raw12
+//                                (default yuv420,nv12,rgb888,mjpeg)
+//   --depths 1,4,8               get/acquire queue depths (default 1,4,8)
+//   --work 0,20,50               consumer time per frame, ms (default 0,20,50)
+//   --buffers N                  camera buffers, 0 = libcamera default
+//   --seconds S                  measured time per run (default 3)
+//   --quick                      one pass: 640x480, yuv420 and mjpeg, depth 4, work 0
+//   --csv FILE / --json FILE     also write the results, one row per run
+//
+// Against the real sensor on the Pi; on a PC, build with the synthetic
+// backend and pick the source with RPI_CAMERA_SOURCE (see CMakeLists.txt).
+// CPU and call counts are process-wide, so with the synthetic backend they
+// include rendering the frames. Allocation and syscall counts need a library
+// built with -DRPI_CAMERA_INSTRUMENT=ON; otherwise they are shown as "-".
+#define _GNU_SOURCE
+#include "rpi_camera.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/resource.h>
+
+#define MAX_LIST 16
+#define MAX_FPS 240 /* sizes the latency array */
+#define WARMUP_NS 500000000ULL
+#define RESTARTS 5
+
+// ============================================================================
+// Sweep description and results
+// ============================================================================
+typedef struct {
+    const char *name;
+    rpi_format_t format;
+    int converted; /* made in software: only get_frame() returns it */
+} format_desc_t;
+
+static const format_desc_t k_formats[] = {
+    { "yuv420", RPI_FMT_YUV420, 0 }, { "nv12", RPI_FMT_NV12, 0 },
+    { "yuyv", RPI_FMT_YUYV, 0 },     { "rgb888", RPI_FMT_RGB888, 0 },
+    { "raw10", RPI_FMT_RAW10, 0 },   { "raw12", RPI_FMT_RAW12, 0 },
+    { "bgra", RPI_FMT_BGRA, 1 },     { "gray8", RPI_FMT_GRAY8, 1 },
+    { "mjpeg", RPI_FMT_MJPEG, 1 },
+};
+
+typedef struct {
+    int width[MAX_LIST], height[MAX_LIST], n_sizes;
+    const format_desc_t *format[MAX_LIST];
+    int n_formats;
+    int depth[MAX_LIST], n_depths;
+    int work_ms[MAX_LIST], n_work;
+    int buffers;
+    int seconds;
+} sweep_t;
+
+typedef struct {
+    int width, height, depth, work_ms;
+    const char *format;
+    int ok;
+    uint64_t frames;
+    double fps;
+    double cpu_us_per_frame;
+    double p50_ms, p99_ms, p999_ms, max_ms;
+    double allocs_per_frame;  /* NAN when the library does not count */
+    double mmaps_per_frame;
+    double ioctls_per_frame;
+    uint64_t dropped_pipeline, dropped_sensor;
+    int from_exposure;
+    double ttff_ms, restart_ttff_ms;
+    rpi_camera_startup_t startup;
+} result_t;
+
+/* SensorTimestamp is CLOCK_BOOTTIME, the frame timestamp CLOCK_MONOTONIC */
+static uint64_t boottime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Nearest-rank percentile of a sorted array */
+static double percentile_ms(const uint64_t *sorted, uint64_t n, double p)
+{
+    if (!n)
+        return 0;
+    uint64_t rank = (uint64_t)(p * n + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    return sorted[(rank > n ? n : rank) - 1] / 1e6;
+}
+
+// ============================================================================
+// One run
+// ============================================================================
+static void run_one(const sweep_t *sw, result_t *r, uint64_t *latency, uint64_t max_samples)
+{
+    const format_desc_t *fmt = NULL;
+    for (size_t i = 0; i < sizeof(k_formats) / sizeof(k_formats[0]); i++) {
+        if (!strcmp(k_formats[i].name, r->format))
+            fmt = &k_formats[i];
+    }
+
+    rpi_camera_config_t cfg;
+    rpi_camera_config_init(&cfg, r->width, r->height, fmt->format);
+    cfg.queue_depth = r->depth;
+    cfg.buffer_count = sw->buffers;
+
+    rpi_camera_t *cam = rpi_camera_create_ex(&cfg);
+    if (!cam)
+        return;
+    rpi_camera_get_startup(cam, &r->startup);
+    if (rpi_camera_start(cam) != 0) {
+        rpi_camera_destroy(cam);
+        return;
+    }
+    WaitForFirstFrame(cam);
+    rpi_camera_stats_t st;
+    rpi_camera_get_stats(cam, &st);
+    r->ttff_ms = st.start_to_first_frame_ns / 1e6;
+
+    rpi_camera_stats_t s0 = { 0 }, s1 = { 0 };
+    uint64_t n = 0, frames = 0, cpu0 = 0, t0 = 0;
+    uint64_t start = get_time_ns();
+    uint64_t end = start + WARMUP_NS + (uint64_t)sw->seconds * 1000000000ULL;
+    int measuring = 0;
+
+    while (get_time_ns() < end) {
+        if (!measuring && get_time_ns() - start >= WARMUP_NS) {
+            rpi_camera_get_stats(cam, &s0);
+            cpu0 = cpu_ns();
+            t0 = get_time_ns();
+            measuring = 1;
+        }
+
+        rpi_frame_t frame;
+        int ret = fmt->converted ? rpi_camera_get_frame_timeout(cam, &frame, 200)
+                                 : rpi_camera_acquire_frame_timeout(cam, &frame, 200);
+        if (ret != 0)
+            continue;
+
+        if (measuring) {
+            uint64_t lat;
+            if (frame.meta.valid & RPI_META_SENSOR_TIMESTAMP) {
+                lat = boottime_ns() - (uint64_t)frame.meta.sensor_timestamp;
+                r->from_exposure = 1;
+            } else {
+                lat = get_time_ns() - frame.timestamp;
+            }
+            if (n < max_samples)
+                latency[n++] = lat;
+            frames++;
+        }
+
+        if (r->work_ms > 0)
+            usleep(r->work_ms * 1000);
+        rpi_camera_release_frame(&frame);
+    }
+
+    double seconds = (get_time_ns() - t0) / 1e9;
+    uint64_t cpu = cpu_ns() - cpu0;
+    rpi_camera_get_stats(cam, &s1);
+
+    /* Restarts reuse the requests and buffers of the first start */
+    uint64_t restart[RESTARTS];
+    int restarts = 0;
+    for (int i = 0; i < RESTARTS; i++) {
+        rpi_camera_stop(cam);
+        if (rpi_camera_start(cam) != 0)
+            break;
+        rpi_frame_t frame;
+        int ret = fmt->converted ? rpi_camera_get_frame_timeout(cam, &frame, 1000)
+                                 : rpi_camera_acquire_frame_timeout(cam, &frame, 1000);
+        if (ret != 0)
+            continue;
+        rpi_camera_release_frame(&frame);
+        rpi_camera_get_stats(cam, &st);
+        restart[restarts++] = st.start_to_first_frame_ns;
+    }
+    qsort(restart, restarts, sizeof(restart[0]), cmp_u64);
+    r->restart_ttff_ms = restarts ? restart[restarts / 2] / 1e6 : NAN;
+
+    rpi_camera_stop(cam);
+    rpi_camera_destroy(cam);
+
+    qsort(latency, n, sizeof(latency[0]), cmp_u64);
+    r->ok = frames > 0;
+    r->frames = frames;
+    r->fps = frames / seconds;
+    r->cpu_us_per_frame = frames ? cpu / 1e3 / frames : 0;
+    r->p50_ms = percentile_ms(latency, n, 0.50);
+    r->p99_ms = percentile_ms(latency, n, 0.99);
+    r->p999_ms = percentile_ms(latency, n, 0.999);
+    r->max_ms = n ? latency[n - 1] / 1e6 : 0;
+    r->allocs_per_frame = r->mmaps_per_frame = r->ioctls_per_frame = NAN;
+    if (s1.instrumented && frames) {
+        r->allocs_per_frame = (double)(s1.allocs - s0.allocs) / frames;
+        r->mmaps_per_frame = (double)(s1.mmaps + s1.munmaps - s0.mmaps - s0.munmaps) / frames;
+        r->ioctls_per_frame = (double)(s1.ioctls - s0.ioctls) / frames;
+    }
+    r->dropped_pipeline = s1.dropped_pipeline - s0.dropped_pipeline;
+    r->dropped_sensor = s1.dropped_sensor - s0.dropped_sensor;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+static void print_header(void)
+{
+    printf("  %-9s %-6s %5s %4s %7s %9s %7s %7s %7s %8s %6s %6s %6s %6s %7s\n", "size",
+           "format", "depth", "work", "fps", "cpu/frame", "p50", "p99", "p99.9", "allocs/f",
+           "sys/f", "dropP", "dropS", "ttff", "restart");
+    printf("  %-9s %-6s %5s %4s %7s %9s %7s %7s %7s %8s %6s %6s %6s %6s %7s\n", "", "", "",
+           "ms", "", "us", "ms", "ms", "ms", "", "", "", "", "ms", "ms");
+}
+
+static void print_result(const result_t *r)
+{
+    char size[24];
+    snprintf(size, sizeof(size), "%dx%d", r->width, r->height);
+    if (!r->ok) {
+        printf("  %-9s %-6s %5d %4d  (camera did not run)\n", size, r->format, r->depth,
+               r->work_ms);
+        return;
+    }
+    char allocs[16] = "-", sys[16] = "-";
+    if (!isnan(r->allocs_per_frame)) {
+        snprintf(allocs, sizeof(allocs), "%.2f", r->allocs_per_frame);
+        snprintf(sys, sizeof(sys), "%.2f", r->mmaps_per_frame + r->ioctls_per_frame);
+    }
+    char restart[16] = "-";
+    if (!isnan(r->restart_ttff_ms))
+        snprintf(restart, sizeof(restart), "%.1f", r->restart_ttff_ms);
+    printf("  %-9s %-6s %5d %4d %7.2f %9.1f %7.2f %7.2f %7.2f %8s %6s %6llu %6llu %6.1f %7s\n",
+           size, r->format, r->depth, r->work_ms, r->fps, r->cpu_us_per_frame, r->p50_ms,
+           r->p99_ms, r->p999_ms, allocs, sys,
+           (unsigned long long)r->dropped_pipeline, (unsigned long long)r->dropped_sensor,
+           r->ttff_ms, restart);
+    fflush(stdout);
+}
+
+static int write_csv(const char *path, const result_t *res, int n, const char *camera,
+                     const char *source)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -errno;
+    fprintf(f, "camera,source,width,height,format,queue_depth,work_ms,ok,frames,fps,"
+               "cpu_us_per_frame,p50_ms,p99_ms,p999_ms,max_ms,allocs_per_frame,"
+               "mmaps_per_frame,ioctls_per_frame,dropped_pipeline,dropped_sensor,"
+               "latency_from,ttff_ms,restart_ttff_ms,manager_ms,acquire_ms,configure_ms,"
+               "allocate_ms\n");
+    for (int i = 0; i < n; i++) {
+        const result_t *r = &res[i];
+        /* Empty cells when the library does not count */
+        char counts[64] = ",,";
+        if (!isnan(r->allocs_per_frame))
+            snprintf(counts, sizeof(counts), "%.3f,%.3f,%.3f", r->allocs_per_frame,
+                     r->mmaps_per_frame, r->ioctls_per_frame);
+        char restart[32] = "";
+        if (!isnan(r->restart_ttff_ms))
+            snprintf(restart, sizeof(restart), "%.3f", r->restart_ttff_ms);
+        fprintf(f, "%s,%s,%d,%d,%s,%d,%d,%d,%llu,%.3f,%.2f,%.3f,%.3f,%.3f,%.3f,%s,%llu,%llu,%s,"
+                   "%.3f,%s,%.3f,%.3f,%.3f,%.3f\n",
+                camera, source, r->width, r->height, r->format, r->depth, r->work_ms, r->ok,
+                (unsigned long long)r->frames, r->fps, r->cpu_us_per_frame, r->p50_ms,
+                r->p99_ms, r->p999_ms, r->max_ms, counts,
+                (unsigned long long)r->dropped_pipeline,
+                (unsigned long long)r->dropped_sensor,
+                r->from_exposure ? "exposure" : "timestamp", r->ttff_ms, restart,
+                r->startup.manager_ns / 1e6, r->startup.acquire_ns / 1e6,
+                r->startup.configure_ns / 1e6, r->startup.allocate_ns / 1e6);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int write_json(const char *path, const result_t *res, int n, const char *camera,
+                      const char *source, int seconds)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -errno;
+    fprintf(f, "{\n  \"camera\": \"%s\",\n  \"source\": \"%s\",\n  \"seconds\": %d,\n"
+               "  \"runs\": [\n", camera, source, seconds);
+    for (int i = 0; i < n; i++) {
+        const result_t *r = &res[i];
+        char counts[128] = "\"allocs_per_frame\": null, \"mmaps_per_frame\": null, "
+                           "\"ioctls_per_frame\": null";
+        if (!isnan(r->allocs_per_frame))
+            snprintf(counts, sizeof(counts),
+                     "\"allocs_per_frame\": %.3f, \"mmaps_per_frame\": %.3f, "
+                     "\"ioctls_per_frame\": %.3f",
+                     r->allocs_per_frame, r->mmaps_per_frame, r->ioctls_per_frame);
+        char restart[32] = "null";
+        if (!isnan(r->restart_ttff_ms))
+            snprintf(restart, sizeof(restart), "%.3f", r->restart_ttff_ms);
+        fprintf(f,
+                "    {\"width\": %d, \"height\": %d, \"format\": \"%s\", \"queue_depth\": %d, "
+                "\"work_ms\": %d, \"ok\": %s, \"frames\": %llu, \"fps\": %.3f, "
+                "\"cpu_us_per_frame\": %.2f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, "
+                "\"p999_ms\": %.3f, \"max_ms\": %.3f, %s, "
+                "\"dropped_pipeline\": %llu, \"dropped_sensor\": %llu, "
+                "\"latency_from\": \"%s\", \"ttff_ms\": %.3f, \"restart_ttff_ms\": %s, "
+                "\"manager_ms\": %.3f, \"acquire_ms\": %.3f, \"configure_ms\": %.3f, "
+                "\"allocate_ms\": %.3f}%s\n",
+                r->width, r->height, r->format, r->depth, r->work_ms,
+                r->ok ? "true" : "false", (unsigned long long)r->frames, r->fps,
+                r->cpu_us_per_frame, r->p50_ms, r->p99_ms, r->p999_ms, r->max_ms,
+                counts, (unsigned long long)r->dropped_pipeline,
+                (unsigned long long)r->dropped_sensor,
+                r->from_exposure ? "exposure" : "timestamp", r->ttff_ms, restart,
+                r->startup.manager_ns / 1e6, r->startup.acquire_ns / 1e6,
+                r->startup.configure_ns / 1e6, r->startup.allocate_ns / 1e6,
+                i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+static int parse_ints(const char *arg, int *out)
+{
+    int n = 0;
+    char *copy = strdup(arg), *save = NULL;
+    for (char *t = strtok_r(copy, ",", &save); t && n < MAX_LIST; t = strtok_r(NULL, ",", &save))
+        out[n++] = atoi(t);
+    free(copy);
+    return n;
+}
+
+static int parse_sizes(const char *arg, int *w, int *h)
+{
+    int n = 0;
+    char *copy = strdup(arg), *save = NULL;
+    for (char *t = strtok_r(copy, ",", &save); t && n < MAX_LIST; t = strtok_r(NULL, ",", &save)) {
+        if (sscanf(t, "%dx%d", &w[n], &h[n]) == 2)
+            n++;
+        else
+            fprintf(stderr, "ignoring size '%s'\n", t);
+    }
+    free(copy);
+    return n;
+}
+
+static int parse_formats(const char *arg, const format_desc_t **out)
+{
+    int n = 0;
+    char *copy = strdup(arg), *save = NULL;
+    for (char *t = strtok_r(copy, ",", &save); t && n < MAX_LIST; t = strtok_r(NULL, ",", &save)) {
+        size_t i;
+        for (i = 0; i < sizeof(k_formats) / sizeof(k_formats[0]); i++) {
+            if (!strcasecmp(k_formats[i].name, t)) {
+                out[n++] = &k_formats[i];
+                break;
+            }
+        }
+        if (i == sizeof(k_formats) / sizeof(k_formats[0]))
+            fprintf(stderr, "ignoring format '%s'\n", t);
+    }
+    free(copy);
+    return n;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--sizes WxH,..] [--formats f,..] [--depths n,..] [--work ms,..]\n"
+            "          [--buffers n] [--seconds s] [--quick] [--csv file] [--json file]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    sweep_t sw = { .buffers = 0, .seconds = 3 };
+    const char *csv = NULL, *json = NULL;
+    sw.n_sizes = parse_sizes("640x480,1280x720,1920x1080", sw.width, sw.height);
+    sw.n_formats = parse_formats("yuv420,nv12,rgb888,mjpeg", sw.format);
+    sw.n_depths = parse_ints("1,4,8", sw.depth);
+    sw.n_work = parse_ints("0,20,50", sw.work_ms);
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--quick")) {
+            sw.n_sizes = parse_sizes("640x480", sw.width, sw.height);
+            sw.n_formats = parse_formats("yuv420,mjpeg", sw.format);
+            sw.n_depths = parse_ints("4", sw.depth);
+            sw.n_work = parse_ints("0", sw.work_ms);
+            continue;
+        }
+        if (!v) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (!strcmp(a, "--sizes"))
+            sw.n_sizes = parse_sizes(v, sw.width, sw.height);
+        else if (!strcmp(a, "--formats"))
+            sw.n_formats = parse_formats(v, sw.format);
+        else if (!strcmp(a, "--depths"))
+            sw.n_depths = parse_ints(v, sw.depth);
+        else if (!strcmp(a, "--work"))
+            sw.n_work = parse_ints(v, sw.work_ms);
+        else if (!strcmp(a, "--buffers"))
+            sw.buffers = atoi(v);
+        else if (!strcmp(a, "--seconds"))
+            sw.seconds = atoi(v);
+        else if (!strcmp(a, "--csv"))
+            csv = v;
+        else if (!strcmp(a, "--json"))
+            json = v;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (!sw.n_sizes || !sw.n_formats || !sw.n_depths || !sw.n_work || sw.seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    rpi_camera_prewarm();
+    char camera[128] = "none";
+    if (rpi_camera_count() <= 0 || rpi_camera_get_id(0, camera, sizeof(camera)) != 0) {
+        fprintf(stderr, "No camera found\n");
+        return 1;
+    }
+    const char *source = getenv("RPI_CAMERA_SOURCE") ? getenv("RPI_CAMERA_SOURCE") : "sensor";
+    if (strstr(camera, "synthetic") && !getenv("RPI_CAMERA_SOURCE"))
+        source = "pattern";
+
+    int runs = sw.n_sizes * sw.n_formats * sw.n_depths * sw.n_work;
+    result_t *res = calloc(runs, sizeof(*res));
+    uint64_t max_samples = (uint64_t)MAX_FPS * sw.seconds;
+    uint64_t *latency = malloc(max_samples * sizeof(uint64_t));
+    if (!res || !latency)
+        return 1;
+
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║  RPI Camera Benchmark                  ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+    printf("camera %s, source %s, %d run(s) of %d s\n\n", camera, source, runs, sw.seconds);
+    print_header();
+
+    int k = 0;
+    for (int s = 0; s < sw.n_sizes; s++) {
+        for (int f = 0; f < sw.n_formats; f++) {
+            for (int d = 0; d < sw.n_depths; d++) {
+                for (int w = 0; w < sw.n_work; w++, k++) {
+                    result_t *r = &res[k];
+                    r->width = sw.width[s];
+                    r->height = sw.height[s];
+                    r->format = sw.format[f]->name;
+                    r->depth = sw.depth[d];
+                    r->work_ms = sw.work_ms[w];
+                    r->allocs_per_frame = NAN;
+                    r->restart_ttff_ms = NAN;
+                    run_one(&sw, r, latency, max_samples);
+                    print_result(r);
+                }
+            }
+        }
+    }
+
+    int ret = 0;
+    if (csv && write_csv(csv, res, runs, camera, source) != 0) {
+        fprintf(stderr, "Cannot write %s: %s\n", csv, strerror(errno));
+        ret = 1;
+    }
+    if (json && write_json(json, res, runs, camera, source, sw.seconds) != 0) {
+        fprintf(stderr, "Cannot write %s: %s\n", json, strerror(errno));
+        ret = 1;
+    }
+    free(latency);
+    free(res);
+    rpi_camera_prewarm_release();
+    return ret;
+}
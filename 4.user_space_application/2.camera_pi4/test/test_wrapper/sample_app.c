@@ -88,21 +88,23 @@ static int create_output_dir(const char *path) {
     return 0;
 }
 
-// Calculate average brightness of YUV420 frame
-static unsigned char calculate_brightness(const void *data, size_t size) {
-    const unsigned char *y_plane = (const unsigned char *)data;
-    size_t y_size = size * 2 / 3;  // Y plane is 2/3 of total
+// Calculate average brightness of YUV420 frame from its Y plane
+static unsigned char calculate_brightness(const rpi_frame_t *frame) {
+    const rpi_plane_t *y = &frame->planes[0];
     
     unsigned long sum = 0;
     size_t samples = 0;
     
-    // Sample every 100th pixel
-    for (size_t i = 0; i < y_size; i += 100) {
-        sum += y_plane[i];
-        samples++;
+    // Sample every 10th pixel of every 10th row
+    for (int row = 0; row < frame->height; row += 10) {
+        const unsigned char *line = (const unsigned char *)y->data + (size_t)row * y->stride;
+        for (int col = 0; col < frame->width; col += 10) {
+            sum += line[col];
+            samples++;
+        }
     }
     
-    return (unsigned char)(sum / samples);
+    return samples ? (unsigned char)(sum / samples) : 0;
 }
 
 // Save frame to file
@@ -111,14 +113,26 @@ static int save_frame_to_file(const app_state_t *state,
     char filename[256];
     const char *format_ext;
     
-    // Determine file extension based on format
-    switch (state->format) {
+    // Determine file extension from what the frame actually holds
+    switch (frame->format) {
         case RPI_FMT_YUV420:
             format_ext = "yuv";
             break;
+        case RPI_FMT_NV12:
+            format_ext = "nv12";
+            break;
+        case RPI_FMT_YUYV:
+            format_ext = "yuyv";
+            break;
         case RPI_FMT_RGB888:
             format_ext = "rgb";
             break;
+        case RPI_FMT_BGRA:
+            format_ext = "bgra";
+            break;
+        case RPI_FMT_GRAY8:
+            format_ext = "gray";
+            break;
         case RPI_FMT_MJPEG:
             format_ext = "jpg";
             break;
@@ -203,7 +217,7 @@ static void frame_callback(rpi_frame_t *frame, void *userdata) {
         
         // Calculate brightness for YUV420
         if (state->format == RPI_FMT_YUV420) {
-            brightness = calculate_brightness(frame->data, frame->size);
+            brightness = calculate_brightness(frame);
         }
         
         printf("Frame %5d | FPS: %5.1f | Size: %7zu B | Avg: %7.0f B",
@@ -279,6 +293,16 @@ static void print_statistics(const app_state_t *state) {
     printf("║ Contrast:         %8.2f                               ║\n", state->contrast);
     printf("║ Exposure:         %8d µs                             ║\n", state->exposure);
     printf("║ Gain:             %8.2f                               ║\n", state->gain);
+
+    rpi_camera_startup_t t;
+    if (rpi_camera_get_startup(state->camera, &t) == 0) {
+        printf("╠═══════════════════════════════════════════════════════════╣\n");
+        printf("║ Startup manager:  %8.1f ms                             ║\n", t.manager_ns / 1e6);
+        printf("║         acquire:  %8.1f ms                             ║\n", t.acquire_ns / 1e6);
+        printf("║         configure:%8.1f ms                             ║\n", t.configure_ns / 1e6);
+        printf("║         allocate: %8.1f ms                             ║\n", t.allocate_ns / 1e6);
+        printf("║         1st frame:%8.1f ms                             ║\n", t.first_frame_ns / 1e6);
+    }
     printf("╚═══════════════════════════════════════════════════════════╝\n");
 }
 
@@ -302,6 +326,25 @@ static void print_menu() {
     fflush(stdout);
 }
 
+// ============================================================================
+// Capture Thread
+// ============================================================================
+static void* capture_thread(void *arg) {
+    app_state_t *state = (app_state_t *)arg;
+    rpi_frame_t frame;
+    
+    // get_frame converts/encodes to the requested format (RGB888, MJPEG)
+    while (state->running) {
+        if (rpi_camera_get_frame_timeout(state->camera, &frame, 100) != 0) {
+            continue;
+        }
+        frame_callback(&frame, state);
+        rpi_camera_release_frame(&frame);
+    }
+    
+    return NULL;
+}
+
 // ============================================================================
 // Interactive Control Thread
 // ============================================================================
@@ -418,6 +461,7 @@ static void* control_thread(void *arg) {
 int main(int argc, char *argv[]) {
     int ret;
     pthread_t ctrl_thread;
+    pthread_t cap_thread;
     
     // ========================================================================
     // 1. Print banner
@@ -427,6 +471,9 @@ int main(int argc, char *argv[]) {
     printf("║         RPI CAMERA WRAPPER - SAMPLE APPLICATION          ║\n");
     printf("╚═══════════════════════════════════════════════════════════╝\n");
     printf("\n");
+
+    /* Enumerate cameras and load the IPA while the rest of the setup runs */
+    rpi_camera_prewarm();
     
     // ========================================================================
     // 2. Initialize application state
@@ -553,12 +600,13 @@ int main(int argc, char *argv[]) {
     // 7. Start camera
     // ========================================================================
     printf("→ Starting camera capture\n");
-    ret = rpi_camera_start(state.camera, frame_callback, &state);
+    ret = rpi_camera_start(state.camera);
     if (ret != 0) {
         fprintf(stderr, "✗ Failed to start camera\n");
         rpi_camera_destroy(state.camera);
         return 1;
     }
+    pthread_create(&cap_thread, NULL, capture_thread, &state);
     printf("✓ Camera started, capturing frames...\n");
     
     // ========================================================================
@@ -578,6 +626,8 @@ int main(int argc, char *argv[]) {
     
     // Wait for user to quit or duration to elapse
     pthread_join(ctrl_thread, NULL);
+    state.running = false;
+    pthread_join(cap_thread, NULL);
     
     // ========================================================================
     // 10. Stop camera
@@ -602,6 +652,7 @@ int main(int argc, char *argv[]) {
     // ========================================================================
     printf("\n→ Cleaning up\n");
     rpi_camera_destroy(state.camera);
+    rpi_camera_prewarm_release();
     pthread_mutex_destroy(&state.stats_mutex);
     printf("✓ Cleanup complete\n");
     
@@ -626,13 +677,15 @@ int main(int argc, char *argv[]) {
                        state.width, state.height);
                 break;
             case RPI_FMT_RGB888:
-                printf("║   ffplay -f rawvideo -pixel_format rgb24             ║\n");
+                printf("║   ffplay -f rawvideo -pixel_format bgr24             ║\n");
                 printf("║          -video_size %dx%-4d frame_XXXX.rgb       ║\n",
                        state.width, state.height);
                 break;
             case RPI_FMT_MJPEG:
                 printf("║   Any image viewer (frame_XXXX.jpg)                   ║\n");
                 break;
+            default:
+                break;
         }
     }
     
@@ -1,10 +1,12 @@
 // test_controls.c - Test brightness, contrast, exposure, gain
 #include "rpi_camera.h"
+#include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
 #include <string.h>
+#include <errno.h>
 
 typedef struct {
     int frame_count;
@@ -15,18 +17,22 @@ typedef struct {
 // ============================================================================
 // Helper: Calculate average brightness of YUV frame
 // ============================================================================
-unsigned char calculate_brightness(void *data, size_t size) {
-    // Y component is first width*height bytes in YUV420
-    unsigned char *y_plane = (unsigned char *)data;
-    size_t y_size = size * 2 / 3;  // Y plane is 2/3 of total
+unsigned char calculate_brightness(const rpi_frame_t *frame) {
+    // Y component is plane 0 in YUV420, rows are 'stride' bytes apart
+    const rpi_plane_t *y = &frame->planes[0];
     
     unsigned long sum = 0;
-    // Sample every 100th pixel
-    for (size_t i = 0; i < y_size; i += 100) {
-        sum += y_plane[i];
+    unsigned long samples = 0;
+    // Sample every 10th pixel of every 10th row
+    for (int row = 0; row < frame->height; row += 10) {
+        const unsigned char *line = (const unsigned char *)y->data + (size_t)row * y->stride;
+        for (int col = 0; col < frame->width; col += 10) {
+            sum += line[col];
+            samples++;
+        }
     }
     
-    return (unsigned char)(sum / (y_size / 100));
+    return samples ? (unsigned char)(sum / samples) : 0;
 }
 
 // ============================================================================
@@ -60,7 +66,7 @@ void test_brightness() {
             if (rpi_camera_try_get_frame(cam, &frame) == 0) {
                 stats.frame_count++;
                 if (stats.sample_count < 10) {
-                    unsigned char b = calculate_brightness(frame.data, frame.size);
+                    unsigned char b = calculate_brightness(&frame);
                     stats.brightness_samples[stats.sample_count++] = b;
                 }
                 rpi_camera_release_frame(&frame);
@@ -177,7 +183,7 @@ void test_exposure() {
             if(rpi_camera_try_get_frame(cam, &frame) == 0) {
                 stats.frame_count++;
                 if(stats.sample_count < 10) {
-                    unsigned char b = calculate_brightness(frame.data, frame.size);
+                    unsigned char b = calculate_brightness(&frame);
                     stats.brightness_samples[stats.sample_count++] = b;
                 }
                 rpi_camera_release_frame(&frame);
@@ -406,6 +412,131 @@ void test_invalid_controls() {
     rpi_camera_destroy(cam);
 }
 
+// ============================================================================
+// TEST 8: Queued Controls Confirmed by Frame Metadata
+// ============================================================================
+void test_queued_controls() {
+    printf("\n=== TEST 8: Queued Controls ===\n");
+
+    rpi_camera_t *cam = rpi_camera_create(640, 480, RPI_FMT_YUV420);
+    assert(cam != NULL);
+
+    int ret = rpi_camera_start(cam);
+    assert(ret == 0);
+    WaitForFirstFrame(cam);
+
+    int exposure_times[] = {5000, 20000, 10000};
+    for (int i = 0; i < 3; i++) {
+        rpi_controls_t ctrls = {0};
+        ctrls.set = RPI_CTRL_AE_ENABLE | RPI_CTRL_EXPOSURE | RPI_CTRL_GAIN;
+        ctrls.ae_enable = 0;
+        ctrls.exposure_us = exposure_times[i];
+        ctrls.analogue_gain = 2.0f;
+
+        uint64_t ticket = 0;
+        ret = rpi_camera_queue_controls(cam, &ctrls, &ticket);
+        assert(ret == 0 && ticket > 0);
+
+        /* Frames until the metadata shows the new values, instead of a
+         * fixed settle time */
+        uint64_t start_ts = get_time_ns();
+        int frames = 0, carried = 0;
+        rpi_frame_t frame;
+        for (;;) {
+            ret = rpi_camera_get_frame_timeout(cam, &frame, 1000);
+            assert(ret == 0);
+            frames++;
+            if (frame.meta.control_ticket == ticket)
+                carried = frames;
+            if (frame.meta.applied_ticket >= ticket)
+                break;
+            rpi_camera_release_frame(&frame);
+            assert(get_time_ns() - start_ts < 2e9);
+        }
+
+        printf("8.%d. Exposure %dus: carried by frame %d, in effect at frame %d (%.0f ms)\n",
+               i + 1, exposure_times[i], carried, frames, (get_time_ns() - start_ts) / 1e6);
+        printf("      - Applied: exposure %dus, gain %.2f, %dK, %.0f lux\n",
+               frame.meta.exposure_us, frame.meta.analogue_gain,
+               frame.meta.colour_temperature, frame.meta.lux);
+        assert(frame.meta.valid & RPI_META_EXPOSURE);
+        assert(abs(frame.meta.exposure_us - exposure_times[i]) <= exposure_times[i] / 50 + 100);
+        rpi_camera_release_frame(&frame);
+    }
+    printf("    ✓ Every change confirmed by frame metadata\n");
+
+    ret = rpi_camera_stop(cam);
+    assert(ret == 0);
+    rpi_camera_destroy(cam);
+}
+
+// ============================================================================
+// TEST 9: Exposure Bracketing Burst
+// ============================================================================
+void test_burst() {
+    printf("\n=== TEST 9: Exposure Bracketing Burst ===\n");
+
+    rpi_camera_config_t cfg;
+    rpi_camera_config_init(&cfg, 640, 480, RPI_FMT_YUV420);
+    cfg.buffer_count = 8;
+    rpi_camera_t *cam = rpi_camera_create_ex(&cfg);
+    assert(cam != NULL);
+
+    enum { N = 5 };
+    const int exposures[N] = {2000, 4000, 8000, 16000, 32000};
+    const float gains[N] = {1.0f, 1.5f, 2.0f, 3.0f, 4.0f};
+    rpi_controls_t brackets[N];
+    rpi_frame_t frames[N];
+    memset(brackets, 0, sizeof(brackets));
+    for (int i = 0; i < N; i++) {
+        brackets[i].set = RPI_CTRL_AE_ENABLE | RPI_CTRL_EXPOSURE | RPI_CTRL_GAIN;
+        brackets[i].ae_enable = 0;
+        brackets[i].exposure_us = exposures[i];
+        brackets[i].analogue_gain = gains[i];
+    }
+
+    int ret = rpi_camera_capture_burst(cam, brackets, N, frames, 1000);
+    assert(ret == -EAGAIN);
+    ret = rpi_camera_capture_burst(cam, brackets, 7, frames, 1000);
+    assert(ret == -EINVAL);
+
+    /* Nothing queued for get/acquire yet: every other buffer circulates */
+    ret = rpi_camera_start(cam);
+    assert(ret == 0);
+    usleep(200000);
+
+    uint64_t start_ts = get_time_ns();
+    ret = rpi_camera_capture_burst(cam, brackets, N, frames, 2000);
+    assert(ret == 0);
+    printf("9.1. %d brackets in %.0f ms, sequences %u..%u\n", N,
+           (get_time_ns() - start_ts) / 1e6, frames[0].sequence, frames[N - 1].sequence);
+
+    for (int i = 0; i < N; i++) {
+        printf("      - #%u: exposure %dus, gain %.2f, brightness %d\n",
+               frames[i].sequence, frames[i].meta.exposure_us, frames[i].meta.analogue_gain,
+               calculate_brightness(&frames[i]));
+        assert(frames[i].meta.valid & RPI_META_EXPOSURE);
+        assert(abs(frames[i].meta.exposure_us - exposures[i]) <= exposures[i] / 50 + 100);
+        /* Back to back: the sensor lost no frame between brackets */
+        assert(i == 0 || frames[i].sequence == frames[i - 1].sequence + 1);
+    }
+    for (int i = 0; i < N; i++)
+        rpi_camera_release_frame(&frames[i]);
+    printf("    ✓ Every bracket on consecutive frames\n");
+
+    /* Released frames go back to the sensor; video carries on */
+    rpi_frame_t frame;
+    for (int i = 0; i < 10; i++) {
+        ret = rpi_camera_acquire_frame_timeout(cam, &frame, 1000);
+        assert(ret == 0);
+        rpi_camera_release_frame(&frame);
+    }
+
+    ret = rpi_camera_stop(cam);
+    assert(ret == 0);
+    rpi_camera_destroy(cam);
+}
+
 // ============================================================================
 // MAIN
 // ============================================================================
@@ -421,6 +552,8 @@ int main() {
     test_combined_controls();
     test_dynamic_controls();
     test_invalid_controls();
+    test_queued_controls();
+    test_burst();
     
     printf("\n╔════════════════════════════════════════╗\n");
     printf("║  ✓ ALL CONTROL TESTS PASSED            ║\n");
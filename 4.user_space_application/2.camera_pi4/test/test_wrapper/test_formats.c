@@ -1,5 +1,6 @@
 // test_formats.c - Test các format và resolution khác nhau
 #include "rpi_camera.h"
+#include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -209,11 +210,26 @@ void test_mjpeg() {
         stats.start_time = get_time_ns();
         stats.end_time = stats.start_time;
         stats.min_size = SIZE_MAX;
+        uint64_t encode_ns = 0;
+        uint32_t last_seq = 0;
         printf("[INFO]:    Capturing frames for 2 seconds...\n");
         while (get_time_ns() - stats.start_time < 4ULL * 1000 * 1000 * 1000) {
             rpi_frame_t frame;
 
             if (rpi_camera_try_get_frame(cam, &frame) == 0) {
+                /* A whole JPEG, handed out in capture order */
+                const uint8_t *jpg = frame.data;
+                assert(frame.format == RPI_FMT_MJPEG);
+                assert(jpg[0] == 0xff && jpg[1] == 0xd8);
+                assert(jpg[frame.size - 2] == 0xff && jpg[frame.size - 1] == 0xd9);
+                assert(stats.frame_count == 0 || frame.sequence > last_seq);
+                last_seq = frame.sequence;
+
+                rpi_jpeg_info_t info;
+                ret = rpi_frame_get_jpeg_info(&frame, &info);
+                assert(ret == 0);
+                encode_ns += info.encode_ns;
+
                 stats.frame_count++;
 
                 // Size statistics
@@ -252,6 +268,7 @@ void test_mjpeg() {
         printf("      - Min size: %zu bytes\n", stats.min_size);
         printf("      - Max size: %zu bytes\n", stats.max_size);
         printf("      - Expected: %zu bytes\n", test->expected_size_min);
+        printf("      - Avg encode: %.2f ms\n", encode_ns / 1e6 / stats.frame_count);
 
         // assert(stats.frame_count >= 40); // At least 40 frames in 2s 
         assert(stats.min_size >= test->expected_size_min * 0.95); 
@@ -419,7 +436,7 @@ int main() {
     
     test_yuv420();
     test_rgb888();
-    // test_mjpeg(); // MJPEG is not natively supported by libcamera on Raspberry Pi
+    test_mjpeg();
     test_resolution_limits();
     test_format_switching();
     
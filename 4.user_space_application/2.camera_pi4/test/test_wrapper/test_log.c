@@ -0,0 +1,176 @@
+// test_log.c - Shared logging library: levels, rate limits, overflow
+// Needs no camera: runs on the build host (x86) as well as on the Pi.
+#undef LOG_LEVEL_COMPILE
+#define LOG_LEVEL_COMPILE LOG_LEVEL_INFO /* DEBUG compiled out for TEST 1 */
+#include "log.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+static int g_evaluated;
+
+static int side_effect(void)
+{
+    return ++g_evaluated;
+}
+
+/* Send stdout to a temp file until capture_end(), which returns how many
+ * of its lines contain 'marker' */
+static int g_saved_stdout = -1;
+static char g_capture_path[] = "/tmp/test_log_XXXXXX";
+
+static void capture_begin(void)
+{
+    log_flush();
+    fflush(stdout);
+    int fd = mkstemp(g_capture_path);
+    assert(fd >= 0);
+    g_saved_stdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+}
+
+static int capture_end(const char *marker)
+{
+    log_flush();
+    fflush(stdout);
+    dup2(g_saved_stdout, STDOUT_FILENO);
+    close(g_saved_stdout);
+
+    FILE *f = fopen(g_capture_path, "r");
+    assert(f);
+    char line[512];
+    int n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strstr(line, marker))
+            n++;
+    }
+    fclose(f);
+    unlink(g_capture_path);
+    strcpy(g_capture_path, "/tmp/test_log_XXXXXX");
+    return n;
+}
+
+// ============================================================================
+// TEST 1: Compile-time and runtime levels
+// ============================================================================
+void test_levels()
+{
+    printf("\n=== TEST 1: Levels ===\n");
+
+    g_evaluated = 0;
+    capture_begin();
+    LOG_DEBUG("lvl-test %d", side_effect()); /* compiled out */
+    LOG_INFO("lvl-test %d", side_effect());
+    log_set_level(LOG_LEVEL_WARN);
+    LOG_INFO("lvl-test %d", side_effect());  /* filtered, args not evaluated */
+    LOG_WARN("lvl-test %d", side_effect());  /* stderr */
+    log_set_level(LOG_LEVEL_INFO);
+    int lines = capture_end("lvl-test");
+
+    assert(g_evaluated == 2);
+    assert(lines == 1);
+    printf("    ✓ Compiled-out and filtered levels cost nothing\n");
+}
+
+// ============================================================================
+// TEST 2: Rate-limited call site
+// ============================================================================
+void test_ratelimit()
+{
+    printf("\n=== TEST 2: Rate Limit ===\n");
+
+    capture_begin();
+    uint64_t t0 = get_time_ns();
+    int calls = 0;
+    while (get_time_ns() - t0 < 250000000ULL) { /* 250 ms */
+        LOG_INFO_RATELIMIT(100, "rl-test %d", calls);
+        calls++;
+        usleep(100);
+    }
+    int lines = capture_end("rl-test");
+
+    printf("    %d calls, %d lines\n", calls, lines);
+    assert(lines >= 2 && lines <= 4);
+    printf("    ✓ One line per 100 ms\n");
+}
+
+// ============================================================================
+// TEST 3: Full ring drops instead of blocking
+// ============================================================================
+#define BURST (LOG_RING_SIZE * 8)
+
+static void *burst_thread(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < BURST; i++)
+        LOG_INFO("burst-test %d", i);
+    return NULL;
+}
+
+void test_overflow()
+{
+    printf("\n=== TEST 3: Ring Overflow ===\n");
+
+    uint64_t dropped0 = log_dropped();
+    capture_begin();
+    pthread_t t;
+    int ret = pthread_create(&t, NULL, burst_thread, NULL);
+    assert(ret == 0);
+    pthread_join(t, NULL);
+    int lines = capture_end("burst-test");
+    uint64_t dropped = log_dropped() - dropped0;
+
+    printf("    %d written, %llu dropped\n", lines, (unsigned long long)dropped);
+    assert((uint64_t)lines + dropped == BURST);
+    assert(lines >= LOG_RING_SIZE);
+    printf("    ✓ Every line written or counted\n");
+}
+
+// ============================================================================
+// TEST 4: Cost per call on the logging thread
+// ============================================================================
+void test_cost()
+{
+    printf("\n=== TEST 4: Cost per Call ===\n");
+
+    const int iters = LOG_RING_SIZE / 2; /* stays within one ring */
+    capture_begin();
+    uint64_t t0 = get_time_ns();
+    for (int i = 0; i < iters; i++)
+        LOG_INFO("cost-test %d %s", i, "frame");
+    uint64_t t1 = get_time_ns();
+    for (int i = 0; i < iters; i++)
+        LOG_DEBUG("cost-test %d %s", i, "frame");
+    uint64_t t2 = get_time_ns();
+    int lines = capture_end("cost-test");
+
+    printf("    LOG_INFO %.0f ns, compiled-out LOG_DEBUG %.1f ns\n",
+           (double)(t1 - t0) / iters, (double)(t2 - t1) / iters);
+    assert(lines == iters);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+int main() {
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║  Logging Tests                         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+    fflush(stdout);
+
+    test_levels();
+    test_ratelimit();
+    test_overflow();
+    test_cost();
+
+    printf("\n╔════════════════════════════════════════╗\n");
+    printf("║  ✓ ALL LOGGING TESTS PASSED            ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    return 0;
+}
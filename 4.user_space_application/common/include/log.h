@@ -0,0 +1,116 @@
+// log.h - Asynchronous logging shared by the user-space apps
+//
+// A log call formats into a ring owned by the calling thread and returns;
+// a background thread writes the lines out. No lock or syscall sits on the
+// caller's path, so turning logs on does not change the timing being logged.
+//
+// Levels above LOG_LEVEL_COMPILE are removed by the preprocessor (their
+// arguments are never evaluated). Build with -DLOG_LEVEL_COMPILE=LOG_LEVEL_DEBUG
+// to keep debug logs; log_set_level() or the LOG_LEVEL environment variable
+// (error, warn, info, debug) filters what was compiled in.
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN  1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL_COMPILE
+#define LOG_LEVEL_COMPILE LOG_LEVEL_INFO
+#endif
+
+/* Records each thread can have queued; further ones are dropped and counted */
+#define LOG_RING_SIZE 256
+/* Longest message kept, prefix excluded; longer ones are truncated */
+#define LOG_MSG_MAX 232
+
+extern int log_runtime_level;
+
+void log_set_level(int level);
+/* Block until every line queued so far is written */
+void log_flush(void);
+/* Lines lost because a thread's ring was full */
+uint64_t log_dropped(void);
+
+/* 'suppressed': calls a rate limit swallowed since the last line, 0 = none */
+void log_write(int level, unsigned int suppressed, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+uint64_t log_now_ns(void);
+
+/* Keeps the format checked when a level is compiled out */
+static inline __attribute__((format(printf, 1, 2))) void log_discard(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#define LOG_ENABLED(level) \
+    ((level) <= LOG_LEVEL_COMPILE && (level) <= log_runtime_level)
+
+#define LOG_AT(level, ...)                                                  \
+    do {                                                                    \
+        if (LOG_ENABLED(level))                                             \
+            log_write(level, 0, __VA_ARGS__);                               \
+    } while (0)
+
+/* At most one line per 'interval_ms' from this call site; the next line
+ * says how many were skipped */
+#define LOG_AT_RATELIMIT(level, interval_ms, ...)                           \
+    do {                                                                    \
+        static uint64_t log_rl_next_;                                       \
+        static unsigned int log_rl_skipped_;                                \
+        if (LOG_ENABLED(level)) {                                           \
+            uint64_t log_rl_now_ = log_now_ns();                            \
+            uint64_t log_rl_due_ = __atomic_load_n(&log_rl_next_, __ATOMIC_RELAXED); \
+            if (log_rl_now_ >= log_rl_due_ &&                               \
+                __atomic_compare_exchange_n(&log_rl_next_, &log_rl_due_,    \
+                    log_rl_now_ + (uint64_t)(interval_ms) * 1000000ULL, 0,  \
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))                    \
+                log_write(level, __atomic_exchange_n(&log_rl_skipped_, 0,   \
+                                                     __ATOMIC_RELAXED),     \
+                          __VA_ARGS__);                                     \
+            else                                                            \
+                __atomic_fetch_add(&log_rl_skipped_, 1, __ATOMIC_RELAXED);  \
+        }                                                                   \
+    } while (0)
+
+#define LOG_OFF_(...) do { if (0) log_discard(__VA_ARGS__); } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_ERROR_RATELIMIT(ms, ...) LOG_AT_RATELIMIT(LOG_LEVEL_ERROR, ms, __VA_ARGS__)
+
+#if LOG_LEVEL_COMPILE >= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_WARN_RATELIMIT(ms, ...) LOG_AT_RATELIMIT(LOG_LEVEL_WARN, ms, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_OFF_(__VA_ARGS__)
+#define LOG_WARN_RATELIMIT(ms, ...) LOG_OFF_(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL_COMPILE >= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_INFO_RATELIMIT(ms, ...) LOG_AT_RATELIMIT(LOG_LEVEL_INFO, ms, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_OFF_(__VA_ARGS__)
+#define LOG_INFO_RATELIMIT(ms, ...) LOG_OFF_(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL_COMPILE >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_RATELIMIT(ms, ...) LOG_AT_RATELIMIT(LOG_LEVEL_DEBUG, ms, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_OFF_(__VA_ARGS__)
+#define LOG_DEBUG_RATELIMIT(ms, ...) LOG_OFF_(__VA_ARGS__)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,271 @@
+// log.c - Per-thread log rings and the writer thread behind log.h
+#define _GNU_SOURCE
+#include "log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* How long the writer sleeps when nobody asked it to hurry */
+#define LOG_WRITER_PERIOD_MS 20
+
+typedef struct {
+    uint64_t ts_ns;
+    uint8_t level;
+    uint16_t len;
+    char msg[LOG_MSG_MAX];
+} log_record_t;
+
+/* One producer (the owning thread), one consumer (the writer). Rings are
+ * never freed: a thread that exits leaves its ring for the writer to drain
+ * and for a later thread to take over. */
+typedef struct log_ring {
+    _Atomic uint64_t head; /* next record the writer reads */
+    char pad0[64 - sizeof(uint64_t)];
+    _Atomic uint64_t tail; /* next record the owner writes */
+    _Atomic uint64_t dropped;
+    _Atomic int in_use;
+    struct log_ring *next; /* registry, set once */
+    log_record_t rec[LOG_RING_SIZE];
+} log_ring_t;
+
+int log_runtime_level = LOG_LEVEL_COMPILE;
+
+static _Atomic(log_ring_t *) g_rings;
+static _Atomic uint64_t g_dropped_reported;
+static _Atomic uint64_t g_written; /* records the writer has consumed */
+static int g_efd = -1;
+static pthread_t g_writer;
+static _Atomic int g_stop;
+static int g_sync; /* no writer thread: lines are written by the caller */
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+static __thread log_ring_t *t_ring;
+
+static const char *const k_names[] = { "ERROR", "WARN", "INFO", "DEBUG" };
+
+uint64_t log_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void log_set_level(int level)
+{
+    __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
+}
+
+static void wake_writer(void)
+{
+    uint64_t one = 1;
+    if (g_efd >= 0 && write(g_efd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: the writer is already due */
+    }
+}
+
+/* Write out one line; errors and warnings go to stderr */
+static void emit(const log_record_t *r)
+{
+    char line[LOG_MSG_MAX + 48];
+    int n = snprintf(line, sizeof(line), "[%5llu.%06llu] [%s]: ",
+                     (unsigned long long)(r->ts_ns / 1000000000ULL),
+                     (unsigned long long)(r->ts_ns % 1000000000ULL / 1000),
+                     k_names[r->level]);
+    memcpy(line + n, r->msg, r->len);
+    n += r->len;
+    line[n++] = '\n';
+
+    int fd = r->level <= LOG_LEVEL_WARN ? STDERR_FILENO : STDOUT_FILENO;
+    for (int off = 0; off < n;) {
+        ssize_t w = write(fd, line + off, n - off);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            break;
+        off += w;
+    }
+}
+
+static void drain_ring(log_ring_t *ring)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    for (; head != tail; head++)
+        emit(&ring->rec[head % LOG_RING_SIZE]);
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+}
+
+static void drain_all(void)
+{
+    for (log_ring_t *r = atomic_load(&g_rings); r; r = r->next)
+        drain_ring(r);
+
+    uint64_t dropped = log_dropped();
+    uint64_t seen = atomic_exchange(&g_dropped_reported, dropped);
+    if (dropped > seen) {
+        log_record_t r = { log_now_ns(), LOG_LEVEL_WARN, 0, "" };
+        r.len = snprintf(r.msg, sizeof(r.msg), "log: %llu lines dropped, rings full",
+                         (unsigned long long)(dropped - seen));
+        emit(&r);
+    }
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    while (!atomic_load(&g_stop)) {
+        struct pollfd pfd = { g_efd, POLLIN, 0 };
+        if (poll(&pfd, 1, LOG_WRITER_PERIOD_MS) > 0) {
+            uint64_t v;
+            if (read(g_efd, &v, sizeof(v)) < 0) {
+                /* Spurious: nothing to clear */
+            }
+        }
+        drain_all();
+        atomic_fetch_add(&g_written, 1);
+    }
+    drain_all();
+    return NULL;
+}
+
+static void release_ring(void *p)
+{
+    atomic_store_explicit(&((log_ring_t *)p)->in_use, 0, memory_order_release);
+}
+
+static void log_shutdown(void)
+{
+    atomic_store(&g_stop, 1);
+    wake_writer();
+    pthread_join(g_writer, NULL);
+}
+
+static void log_init(void)
+{
+    const char *env = getenv("LOG_LEVEL");
+    if (env && *env) {
+        for (int i = 0; i < (int)(sizeof(k_names) / sizeof(k_names[0])); i++) {
+            if (!strncasecmp(env, k_names[i], strlen(env)))
+                log_set_level(i);
+        }
+    }
+
+    pthread_key_create(&g_key, release_ring);
+    g_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pthread_create(&g_writer, NULL, writer_main, NULL) == 0) {
+        pthread_setname_np(g_writer, "log-writer");
+        atexit(log_shutdown);
+    } else {
+        g_sync = 1;
+    }
+}
+
+/* The calling thread's ring: a drained one left by an exited thread, else
+ * a new one */
+static log_ring_t *thread_ring(void)
+{
+    if (t_ring)
+        return t_ring;
+
+    pthread_once(&g_once, log_init);
+
+    log_ring_t *ring = NULL;
+    for (log_ring_t *r = atomic_load(&g_rings); r; r = r->next) {
+        int free_ring = 0;
+        if (atomic_load(&r->head) == atomic_load(&r->tail) &&
+            atomic_compare_exchange_strong(&r->in_use, &free_ring, 1)) {
+            ring = r;
+            break;
+        }
+    }
+    if (!ring) {
+        ring = calloc(1, sizeof(*ring));
+        if (!ring)
+            return NULL;
+        atomic_store(&ring->in_use, 1);
+        log_ring_t *first = atomic_load(&g_rings);
+        do {
+            ring->next = first;
+        } while (!atomic_compare_exchange_weak(&g_rings, &first, ring));
+    }
+
+    pthread_setspecific(g_key, ring);
+    t_ring = ring;
+    return ring;
+}
+
+void log_write(int level, unsigned int suppressed, const char *fmt, ...)
+{
+    log_ring_t *ring = thread_ring();
+    if (!ring)
+        return;
+
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log_record_t *r = &ring->rec[tail % LOG_RING_SIZE];
+    r->ts_ns = log_now_ns();
+    r->level = (uint8_t)level;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(r->msg, sizeof(r->msg), fmt, ap);
+    va_end(ap);
+    if (n < 0)
+        n = 0;
+    if (n >= (int)sizeof(r->msg))
+        n = sizeof(r->msg) - 1;
+    /* Call sites written for printf end in a newline; the writer adds one */
+    while (n > 0 && r->msg[n - 1] == '\n')
+        n--;
+    if (suppressed && n < (int)sizeof(r->msg) - 1) {
+        int m = snprintf(r->msg + n, sizeof(r->msg) - n, " (%u suppressed)", suppressed);
+        n = m > 0 && n + m < (int)sizeof(r->msg) ? n + m : (int)sizeof(r->msg) - 1;
+    }
+    r->len = (uint16_t)n;
+
+    if (g_sync) {
+        emit(r);
+        return;
+    }
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    /* Errors go out now; otherwise only wake the writer before the ring
+     * can fill */
+    if (level == LOG_LEVEL_ERROR || tail + 1 - head == LOG_RING_SIZE / 2)
+        wake_writer();
+}
+
+void log_flush(void)
+{
+    pthread_once(&g_once, log_init);
+
+    /* Two full passes after this call means everything queued before it
+     * has been written */
+    uint64_t target = atomic_load(&g_written) + 2;
+    while (!g_sync && !atomic_load(&g_stop) && atomic_load(&g_written) < target) {
+        wake_writer();
+        usleep(1000);
+    }
+}
+
+uint64_t log_dropped(void)
+{
+    uint64_t n = 0;
+    for (log_ring_t *r = atomic_load(&g_rings); r; r = r->next)
+        n += atomic_load_explicit(&r->dropped, memory_order_relaxed);
+    return n;
+}